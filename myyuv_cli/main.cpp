@@ -1,12 +1,14 @@
 #include <myyuv.hpp>
+#include <myyuv_DCT/DCT.hpp>
 #include <iostream>
-#include <fstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <functional>
 #include <chrono>
+#include <algorithm>
+#include <cstdlib>
 
 class MyTimer {
 public:
@@ -45,16 +47,65 @@ inline static bool mapKeyExist(const std::unordered_map<T, U>& map, const T& key
   return map.find(key) != map.end();
 }
 
+// Fixed-point SIMD kernels may differ from the scalar float reference by this amount
+static constexpr const int bench_to_yuv_max_error = 4;
+// SIMD inverse DCT may round a sample differently than the scalar one
+static constexpr const int bench_dct_max_error = 1;
+
+// Same image with 32 bit pixels for 24 bit BMP and vice versa, both must convert to the same YUV
+static myyuv::BMP otherBitCountBMP(const myyuv::BMP& bmp) {
+  myyuv::BMP res;
+  res.header = bmp.header;
+  res.header.bit_count = (bmp.header.bit_count == 32) ? 24 : 32;
+  res.header.data_pos = sizeof(res.header) + ((res.header.bit_count == 32) ? sizeof(res.color_header) : 0);
+  res.header.file_size = res.header.data_pos + res.imageSize();
+  res.data = myyuv::allocateBuffer(res.imageSize());
+  const uint32_t src_bytes = bmp.header.bit_count / 8;
+  const uint32_t dst_bytes = res.header.bit_count / 8;
+  const uint64_t pixels = static_cast<uint64_t>(bmp.trueWidth()) * bmp.trueHeight();
+  for (uint64_t i = 0; i < pixels; i++) {
+    std::copy(bmp.data + i * src_bytes, bmp.data + i * src_bytes + 3, res.data + i * dst_bytes);
+    if (dst_bytes == 4) {
+      res.data[i * dst_bytes + 3] = 255;
+    }
+  }
+  return res;
+}
+
 static std::unordered_map<std::string, myyuv::YUV::FourccFormat> format_strings_map = {
   { "IYUV", myyuv::YUV::FourccFormats::IYUV },
+  { "NV12", myyuv::YUV::FourccFormats::NV12 },
+  { "NV21", myyuv::YUV::FourccFormats::NV21 },
+  { "I444", myyuv::YUV::FourccFormats::I444 },
+  { "I422", myyuv::YUV::FourccFormats::I422 },
+  { "YUY2", myyuv::YUV::FourccFormats::YUY2 },
+  { "UYVY", myyuv::YUV::FourccFormats::UYVY },
+  { "I010", myyuv::YUV::FourccFormats::I010 },
+  { "P010", myyuv::YUV::FourccFormats::P010 },
+  { "YV12", myyuv::YUV::FourccFormats::YV12 },
 };
 
+// Max difference of samples of two images of the same format in units of 8-bit samples, rounded up
+static int maxSampleError(const myyuv::YUV& yuv, const myyuv::YUV& reference) {
+  const auto sample_bits = myyuv::YUV::getSampleBits(yuv.getFourccFormat());
+  const uint32_t sample_bytes = myyuv::YUV::getBytesPerSample(yuv.getFourccFormat());
+  const auto sample = [&](const uint8_t* data, uint32_t i)->int {
+    return sample_bytes == 2 ? (data[i] | data[i + 1] << 8) >> sample_bits[1] : data[i];
+  };
+  int max_error = 0;
+  for (uint32_t i = 0; i + sample_bytes <= yuv.getDataSize(); i += sample_bytes) {
+    max_error = std::max(max_error, std::abs(sample(yuv.data, i) - sample(reference.data, i)));
+  }
+  const int scale = 1 << (sample_bits[0] - 8);
+  return (max_error + scale - 1) / scale;
+}
+
 static std::unordered_map<std::string, myyuv::YUV::Compression> compression_strings_map = {
   { "DCT", myyuv::YUV::Compressions::DCT },
 };
 
-static std::unordered_map<myyuv::YUV::Compression, std::function<myyuv::YUV(const myyuv::YUV&, const std::vector<std::string>&)>> compression_map = {
-  { myyuv::YUV::Compressions::DCT, [](const myyuv::YUV& yuv, const std::vector<std::string>& params)->myyuv::YUV {
+static std::unordered_map<myyuv::YUV::Compression, std::function<void(const myyuv::YUV&, const std::vector<std::string>&, const std::string&)>> compression_map = {
+  { myyuv::YUV::Compressions::DCT, [](const myyuv::YUV& yuv, const std::vector<std::string>& params, const std::string& path) {
     if (params.size() > 3) {
       throw std::runtime_error("Error. Too many compression parameters. Can't be more than 3 parameters.");
     }
@@ -73,7 +124,7 @@ static std::unordered_map<myyuv::YUV::Compression, std::function<myyuv::YUV(cons
     for (size_t i = params.size() - 1; i < 3; i++) {
       params_res[i] = params_res[params.size() - 1];
     }
-    return yuv.compress(myyuv::YUV::Compressions::DCT, params_res.data(), params_res.size());
+    yuv.compressTo(path, myyuv::YUV::Compressions::DCT, params_res.data(), params_res.size());
   }},
 };
 
@@ -83,7 +134,10 @@ static void print_usage() {
   << "`myyuv_cli /path/to/image -info` - prints info about BMP or YUV image `/path/to/image`\n"
   << "`myyuv_cli /path/to/image.bmp -to_yuv format -o /path/to/new_image.myyuv` - creates YUV image from BMP image `/path/to/image.bmp` with `format` format and saves at `/path/to/new_image.myyuv`\n"
   << "`myyuv_cli /path/to/image.myyuv -compress compression [params...] -o /path/to/new_image.myyuv` - compresses YUV image `/path/to/image.myyuv` with `compression` using `params...` and saves at `/path/to/new_image.myyuv`\n"
-  << "`myyuv_cli /path/to/image.myyuv -decompress -o /path/to/new_image.myyuv` - decompresses YUV image `/path/to/image.myyuv` and saves at `/path/to/new_image.myyuv`\n";
+  << "`myyuv_cli /path/to/image.myyuv -decompress -o /path/to/new_image.myyuv` - decompresses YUV image `/path/to/image.myyuv` and saves at `/path/to/new_image.myyuv`\n"
+  << "`myyuv_cli /path/to/image.myyuv -convert format -o /path/to/new_image.myyuv` - converts YUV image `/path/to/image.myyuv` to `format` format without going through RGB and saves at `/path/to/new_image.myyuv`, compressed image is decompressed first\n"
+  << "`myyuv_cli /path/to/image.bmp -bench_to_yuv format [runs]` - benchmarks BMP to YUV conversion with every supported SIMD level and threads count and checks the result against the scalar reference and against the same image with the other of 24 and 32 bit pixels\n"
+  << "`myyuv_cli /path/to/image.myyuv -bench_dct [runs]` - benchmarks Huffman decoding, DCT decompression and compression of DCT compressed YUV image `/path/to/image.myyuv` with every supported SIMD level and checks decompression against the scalar one\n";
   std::cout << "\nYUV formats:\n";
   for (const auto& it: format_strings_map) {
     std::cout << it.first << '\n';
@@ -97,18 +151,35 @@ static void print_usage() {
   << "myyuv_cli /path/to/image.myyuv -compress DCT 50 -o /path/to/new_image.myyuv\n";
 }
 
-static int process_bmp(const myyuv::BMP& bmp, size_t argi, const std::vector<std::string>& args) {
-  if (args[argi] == "-info") {
+static int print_info(const myyuv::ImageInfo& info) {
+  if (info.type == myyuv::ImageInfo::Type::BMP) {
+    const myyuv::BMPHeader& header = info.bmp_header;
     std::cout
-    << "Type: " << bmp.header.type[0] << bmp.header.type[1] << '\n'
-    << "File size: " << bmp.header.file_size << '\n'
-    << "Data size: " << bmp.header.width * bmp.header.height * bmp.header.bit_count / 8 << '\n'
-    << "Width: " << bmp.header.width << '\n'
-    << "Height: " << bmp.header.height << '\n'
-    << "Bit count: " << bmp.header.bit_count << '\n'
-    << "Valid: " << bmp.isValid() << '\n';
-    return 0;
-  } else if (args[argi] == "-to_yuv") {
+    << "Type: " << header.type[0] << header.type[1] << '\n'
+    << "File size: " << info.file_size << '\n'
+    << "Data size: " << info.width * info.height * header.bit_count / 8 << '\n'
+    << "Width: " << header.width << '\n'
+    << "Height: " << header.height << '\n'
+    << "Bit count: " << header.bit_count << '\n'
+    << "Valid: " << info.valid << '\n';
+  } else {
+    const myyuv::YUVHeader& header = info.yuv_header;
+    std::cout
+    << "Type: " << header.type[0] << header.type[1] << '\n'
+    << "FourCC Format: 0x" << std::hex << header.fourcc_format << std::dec << '\n'
+    << "File size: " << info.file_size << '\n'
+    << "Data size: " << header.data_size << '\n'
+    << "Compression: " << header.compression << '\n'
+    << "Compression params size: " << header.compression_params_size << '\n'
+    << "Width: " << header.width << '\n'
+    << "Height: " << header.height << '\n'
+    << "Valid: " << info.valid << '\n';
+  }
+  return 0;
+}
+
+static int process_bmp(const myyuv::BMP& bmp, size_t argi, const std::vector<std::string>& args) {
+  if (args[argi] == "-to_yuv") {
     if (args.size() != argi + 4) {
       std::cout << "Invalid arguments amount. " << (argi + 4) << " is required\n";
       print_usage();
@@ -128,6 +199,67 @@ static int process_bmp(const myyuv::BMP& bmp, size_t argi, const std::vector<std
     }), "BMP to YUV (" + args[argi + 1] + ")");
     yuv.dump(args[argi + 3]);
     return 0;
+  } else if (args[argi] == "-bench_to_yuv") {
+    if (args.size() != argi + 2 && args.size() != argi + 3) {
+      std::cout << "Invalid arguments amount. " << (argi + 2) << " or " << (argi + 3) << " is required\n";
+      print_usage();
+      return 1;
+    }
+    if (!mapKeyExist(format_strings_map, args[argi + 1])) {
+      throw std::runtime_error("Format is not registered: " + args[argi + 1]);
+    }
+    const myyuv::YUV::FourccFormat format = format_strings_map.at(args[argi + 1]);
+    const int runs = (args.size() == argi + 3) ? std::stoi(args[argi + 2]) : 10;
+    if (runs < 1) {
+      throw std::runtime_error("Error. Runs count must be at least 1.");
+    }
+    const myyuv::SimdLevel level_prev = myyuv::getSimdLevel();
+    const myyuv::SimdLevel level_max = myyuv::detectSimdLevel();
+    myyuv::setSimdLevel(myyuv::SimdLevel::SCALAR);
+    const myyuv::YUV reference(bmp, format);
+    const myyuv::BMP other_bmp = otherBitCountBMP(bmp);
+    int ret = 0;
+    for (uint8_t l = 0; l <= static_cast<uint8_t>(level_max); l++) {
+      const myyuv::SimdLevel level = static_cast<myyuv::SimdLevel>(l);
+      myyuv::setSimdLevel(level);
+      myyuv::YUV yuv;
+      const float time_ms = MyTimer::measureTimeMs([&](){
+        for (int i = 0; i < runs; i++) {
+          yuv = myyuv::YUV(bmp, format);
+        }
+      });
+      printTimeMeasurement(time_ms / runs, "BMP to YUV (" + args[argi + 1] + ", " + myyuv::getSimdLevelName(level) + ")");
+      const int max_error = maxSampleError(yuv, reference);
+      std::cout << "Max error against scalar: " << max_error << '\n';
+      if (max_error > bench_to_yuv_max_error) {
+        std::cout << "Error. Max error must not exceed " << bench_to_yuv_max_error << '\n';
+        ret = 1;
+      }
+      const myyuv::YUV other_yuv(other_bmp, format);
+      if (!std::equal(yuv.data, yuv.data + yuv.getDataSize(), other_yuv.data)) {
+        std::cout << "Error. " << other_bmp.header.bit_count << " bit BMP converts differently than " << bmp.header.bit_count << " bit one\n";
+        ret = 1;
+      }
+    }
+    myyuv::setSimdLevel(level_prev);
+    const uint32_t threads_prev = myyuv::getThreadsCount();
+    myyuv::setThreadsCount(0);
+    const uint32_t threads_max = myyuv::getThreadsCount();
+    for (uint32_t threads = 1; ; threads = std::min(threads * 2, threads_max)) {
+      myyuv::setThreadsCount(threads);
+      const float time_ms = MyTimer::measureTimeMs([&](){
+        for (int i = 0; i < runs; i++) {
+          myyuv::YUV yuv(bmp, format);
+        }
+      });
+      std::cout << "BMP to YUV (" << args[argi + 1] << ", " << threads << " threads) : " << time_ms / runs << " ms, "
+      << (time_ms > 0 ? static_cast<uint64_t>(bmp.trueHeight() * 1000.0 * runs / time_ms) : 0) << " rows/s\n";
+      if (threads == threads_max) {
+        break;
+      }
+    }
+    myyuv::setThreadsCount(threads_prev);
+    return ret;
   } else {
     std::cout << "Invalid command " << args[argi] << '\n';
     print_usage();
@@ -136,19 +268,7 @@ static int process_bmp(const myyuv::BMP& bmp, size_t argi, const std::vector<std
 }
 
 static int process_yuv(const myyuv::YUV& yuv, size_t argi, const std::vector<std::string>& args) {
-  if (args[argi] == "-info") {
-    std::cout
-    << "Type: " << yuv.header.type[0] << yuv.header.type[1] << '\n'
-    << "FourCC Format: 0x" << std::hex << yuv.header.fourcc_format << std::dec << '\n'
-    << "File size: " << (sizeof(yuv.header) + yuv.header.compression_params_size + yuv.header.data_size) << '\n'
-    << "Data size: " << yuv.header.data_size << '\n'
-    << "Compression: " << yuv.header.compression << '\n'
-    << "Compression params size: " << yuv.header.compression_params_size << '\n'
-    << "Width: " << yuv.header.width << '\n'
-    << "Height: " << yuv.header.height << '\n'
-    << "Valid: " << yuv.isValid() << '\n';
-    return 0;
-  } else if (args[argi] == "-compress") {
+  if (args[argi] == "-compress") {
     argi++;
     if (argi >= args.size()) {
       std::cout << "Invalid arguments. Specify compression algorithm, compression parameters and output.\n";
@@ -173,15 +293,13 @@ static int process_yuv(const myyuv::YUV& yuv, size_t argi, const std::vector<std
       print_usage();
       return 1;
     }
-    myyuv::YUV compressed_yuv;
     std::string params_as_string = " ";
     for (const auto& p : params) {
       params_as_string += p + " ";
     }
     printTimeMeasurement(MyTimer::measureTimeMs([&](){
-      compressed_yuv = compression_map.at(compression)(yuv, params);
+      compression_map.at(compression)(yuv, params, args[argi]);
     }), "YUV DCT compression (" + params_as_string + ")");
-    compressed_yuv.dump(args[argi]);
     return 0;
   } else if (args[argi] == "-decompress") {
     if (!yuv.isCompressed()) {
@@ -205,6 +323,105 @@ static int process_yuv(const myyuv::YUV& yuv, size_t argi, const std::vector<std
     }), "YUV DCT decompression");
     decompressed_yuv.dump(args[argi + 1]);
     return 0;
+  } else if (args[argi] == "-convert") {
+    if (args.size() != argi + 4) {
+      std::cout << "Invalid arguments amount. " << (argi + 4) << " is required\n";
+      print_usage();
+      return 1;
+    }
+    if (!mapKeyExist(format_strings_map, args[argi + 1])) {
+      throw std::runtime_error("Format is not registered: " + args[argi + 1]);
+    }
+    if (args[argi + 2] != "-o") {
+      std::cout << (argi + 2) << " argument must be `-o` instead of " << args[argi + 2] << '\n';
+      print_usage();
+      return 1;
+    }
+    myyuv::YUV converted_yuv;
+    printTimeMeasurement(MyTimer::measureTimeMs([&](){
+      converted_yuv = yuv.isCompressed() ? yuv.decompress().convert(format_strings_map.at(args[argi + 1])) : yuv.convert(format_strings_map.at(args[argi + 1]));
+    }), "YUV conversion (" + args[argi + 1] + ")");
+    converted_yuv.dump(args[argi + 3]);
+    return 0;
+  } else if (args[argi] == "-bench_dct") {
+    if (yuv.getCompression() != myyuv::YUV::Compressions::DCT) {
+      std::cout << "Image must be compressed with DCT\n";
+      return 1;
+    }
+    if (args.size() != argi + 1 && args.size() != argi + 2) {
+      std::cout << "Invalid arguments amount. " << (argi + 1) << " or " << (argi + 2) << " is required\n";
+      print_usage();
+      return 1;
+    }
+    const int runs = (args.size() == argi + 2) ? std::stoi(args[argi + 1]) : 10;
+    if (runs < 1) {
+      throw std::runtime_error("Error. Runs count must be at least 1.");
+    }
+    uint64_t blocks = 0;
+    for (uint8_t i = 0; i < 3; i++) {
+      auto width_height = yuv.getWidthHeightChannel(i);
+      blocks += width_height[0] * width_height[1] / 64;
+    }
+    const auto blocks_per_second = [blocks, runs](float time_ms)->uint64_t {
+      return time_ms > 0 ? static_cast<uint64_t>(blocks * 1000.0 * runs / time_ms) : 0;
+    };
+    for (const bool reference_decoder : { true, false }) {
+      uint32_t decoded_blocks = 0;
+      const float time_ms = MyTimer::measureTimeMs([&](){
+        for (int i = 0; i < runs; i++) {
+          decoded_blocks = myyuvDCT::huffman_decode_DCT_planar(yuv, reference_decoder);
+        }
+      });
+      if (decoded_blocks != blocks) {
+        throw std::runtime_error("Error. Decoded " + std::to_string(decoded_blocks) + " blocks instead of " + std::to_string(blocks));
+      }
+      std::cout << "Huffman decoding (" << (reference_decoder ? "bit by bit" : "table") << ") : " << time_ms / runs << " ms, " << blocks_per_second(time_ms) << " blocks/s\n";
+    }
+    const myyuv::SimdLevel level_prev = myyuv::getSimdLevel();
+    const myyuv::SimdLevel level_max = myyuv::detectSimdLevel();
+    myyuv::setSimdLevel(myyuv::SimdLevel::SCALAR);
+    const myyuv::YUV reference = yuv.decompress();
+    myyuvDCT::reset_idct_path_counters();
+    myyuvDCT::reset_flat_blocks_counter();
+    int ret = 0;
+    for (uint8_t l = 0; l <= static_cast<uint8_t>(level_max); l++) {
+      const myyuv::SimdLevel level = static_cast<myyuv::SimdLevel>(l);
+      const std::string level_name = myyuv::getSimdLevelName(level);
+      myyuv::setSimdLevel(level);
+      myyuv::YUV decompressed_yuv;
+      float time_ms = MyTimer::measureTimeMs([&](){
+        for (int i = 0; i < runs; i++) {
+          decompressed_yuv = yuv.decompress();
+        }
+      });
+      const int max_error = maxSampleError(decompressed_yuv, reference);
+      std::cout << "YUV DCT decompression (" << level_name << ") : " << time_ms / runs << " ms, " << blocks_per_second(time_ms) << " blocks/s, max error against scalar: " << max_error << '\n';
+      if (max_error > bench_dct_max_error) {
+        std::cout << "Error. Max error must not exceed " << bench_dct_max_error << '\n';
+        ret = 1;
+      }
+      if (l == 0) {
+        const myyuvDCT::IDCTPathCounters counters = myyuvDCT::get_idct_path_counters();
+        const uint64_t total = counters.dc_only + counters.sparse + counters.full;
+        const auto percent = [total](uint64_t count)->float {
+          return total > 0 ? count * 100.0f / total : 0.0f;
+        };
+        std::cout << "Inverse DCT paths: DC only " << percent(counters.dc_only) << "%, 4x4 " << percent(counters.sparse) << "%, full " << percent(counters.full) << "%\n";
+      }
+      time_ms = MyTimer::measureTimeMs([&](){
+        for (int i = 0; i < runs; i++) {
+          myyuv::YUV compressed_yuv = reference.compress(myyuv::YUV::Compressions::DCT, yuv.compression_params, yuv.header.compression_params_size);
+        }
+      });
+      std::cout << "YUV DCT compression (" << level_name << ") : " << time_ms / runs << " ms, " << blocks_per_second(time_ms) << " blocks/s\n";
+      if (l == 0) {
+        std::cout << "Flat blocks: " << (blocks > 0 ? myyuvDCT::get_flat_blocks_counter() * 100.0f / (blocks * runs) : 0.0f) << "%\n";
+      }
+    }
+    myyuv::setSimdLevel(level_prev);
+    const myyuv::AllocatorStats stats = myyuv::getAllocator().getStats();
+    std::cout << "Allocator: " << stats.allocations << " allocations, " << (stats.allocations > 0 ? stats.pool_hits * 100.0f / stats.allocations : 0.0f) << "% reused, peak " << stats.peak_bytes_in_use / (1 << 20) << " MiB, huge page buffers " << stats.huge_page_buffers << '\n';
+    return ret;
   } else {
     std::cout << "Invalid command " << args[argi] << '\n';
     print_usage();
@@ -218,24 +435,18 @@ static int _main(int argc, char* argv[]) {
     return 0;
   }
   std::vector<std::string> args(argv, argv + argc);
-  myyuv::BMPHeader bmp_header;
-  myyuv::YUVHeader yuv_header;
-  const uint32_t magic_size = std::max(sizeof(bmp_header.type), sizeof(yuv_header.type));
-  uint8_t magic[magic_size];
   const std::string path = args[1];
-  std::ifstream f(path, std::ios::binary);
-  if (!f) {
-    throw std::runtime_error("Error opening file to read " + path);
-  }
-  f.read(reinterpret_cast<char*>(magic), sizeof(magic));
-  f.close();
+  const myyuv::ImageInfo info = myyuv::probe(path);
   int ret = 0;
-  if (std::equal(bmp_header.type, bmp_header.type + sizeof(bmp_header.type), magic)) {
+  if (info.type == myyuv::ImageInfo::Type::UNKNOWN) {
+    throw std::runtime_error("Unknown image format (magic) " + path);
+  } else if (args[2] == "-info") {
+    // Only the headers are needed
+    ret = print_info(info);
+  } else if (info.type == myyuv::ImageInfo::Type::BMP) {
     ret = process_bmp(myyuv::BMP(path), 2, args);
-  } else if (std::equal(yuv_header.type, yuv_header.type + sizeof(yuv_header.type), magic)) {
-    ret = process_yuv(myyuv::YUV(path), 2, args);
   } else {
-    throw std::runtime_error("Unknown image format (magic) " + path);
+    ret = process_yuv(myyuv::YUV(path, myyuv::YUV::LoadMode::MAP_SEQUENTIAL), 2, args);
   }
   if (ret == 0) {
     std::cout << "Success!\n";
@@ -1,4 +1,8 @@
 #pragma once
 
+#include "myyuv_cpu.hpp"
+#include "myyuv_thread_pool.hpp"
+#include "myyuv_allocator.hpp"
 #include "myyuv_bmp.hpp"
 #include "myyuv_yuv.hpp"
+#include "myyuv_probe.hpp"
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <cassert>
+
+namespace myyuvDCT {
+
+/**
+* @brief Writes LSB first bit stream into a byte buffer.
+* @details Bits are collected in a 64-bit accumulator and only whole bytes are stored, the last partial byte is stored by `finish`.
+*/
+class BitWriter {
+public:
+  /**
+  * @brief Constructor.
+  * @param data Destination buffer.
+  * @param capacity Destination buffer size in bytes.
+  */
+  BitWriter(uint8_t* data, uint32_t capacity) noexcept : data(data), capacity(capacity) {}
+
+  /**
+  * @brief Appends `count` lowest bits of `bits`, lowest bit first.
+  * @param bits Bits to append, bits above `count` must be 0.
+  * @param count Amount of bits, 32 at most.
+  */
+  inline void put(uint32_t bits, uint8_t count) noexcept {
+    assert(count <= 32);
+    assert(count == 32 || (bits >> count) == 0);
+    acc |= static_cast<uint64_t>(bits) << acc_bits;
+    acc_bits += count;
+    if (acc_bits >= 32) {
+      flushBytes();
+    }
+  }
+
+  /**
+  * @brief Stores the remaining bits, the last byte is padded with zeroes.
+  * @return Amount of written bytes.
+  */
+  inline uint32_t finish() noexcept {
+    flushBytes();
+    if (acc_bits > 0) {
+      assert(pos < capacity);
+      data[pos++] = static_cast<uint8_t>(acc);
+      acc = 0;
+      bits_written += acc_bits;
+      acc_bits = 0;
+    }
+    return pos;
+  }
+
+  /**
+  * @brief Get amount of appended bits.
+  */
+  inline uint32_t bits() const noexcept {
+    return bits_written + acc_bits;
+  }
+private:
+  inline void flushBytes() noexcept {
+    while (acc_bits >= 8) {
+      assert(pos < capacity);
+      data[pos++] = static_cast<uint8_t>(acc);
+      acc >>= 8;
+      acc_bits -= 8;
+      bits_written += 8;
+    }
+  }
+
+  uint8_t* data;
+  uint32_t capacity;
+  uint32_t pos = 0;
+  uint32_t bits_written = 0;
+  uint64_t acc = 0;
+  uint8_t acc_bits = 0;
+};
+
+/**
+* @brief Reads LSB first bit stream from a byte buffer.
+* @details A 64-bit accumulator is refilled a byte at a time, so up to 57 bits can be peeked at once. Bits past the end of the buffer read as 0.
+*/
+class BitReader {
+public:
+  /**
+  * @brief Constructor.
+  * @param data Source buffer.
+  * @param size Source buffer size in bytes.
+  */
+  BitReader(const uint8_t* data, uint32_t size) noexcept : data(data), size(size) {}
+
+  /**
+  * @brief Get next `count` bits without consuming them, the first bit is the lowest.
+  * @param count Amount of bits, 32 at most.
+  */
+  inline uint32_t peek(uint8_t count) noexcept {
+    assert(count <= 32);
+    if (acc_bits < count) {
+      refill();
+    }
+    return static_cast<uint32_t>(acc & ((uint64_t(1) << count) - 1));
+  }
+
+  /**
+  * @brief Consumes `count` bits, they must be peeked before.
+  */
+  inline void skip(uint8_t count) noexcept {
+    assert(count <= acc_bits || pos == size);
+    acc >>= count;
+    acc_bits -= (count < acc_bits) ? count : acc_bits;
+  }
+
+  /**
+  * @brief Reads next `count` bits, the first bit is the lowest.
+  * @param count Amount of bits, 32 at most.
+  */
+  inline uint32_t read(uint8_t count) noexcept {
+    const uint32_t res = peek(count);
+    skip(count);
+    return res;
+  }
+private:
+  inline void refill() noexcept {
+    while (acc_bits <= 56 && pos < size) {
+      acc |= static_cast<uint64_t>(data[pos++]) << acc_bits;
+      acc_bits += 8;
+    }
+  }
+
+  const uint8_t* data;
+  uint32_t size;
+  uint32_t pos = 0;
+  uint64_t acc = 0;
+  uint8_t acc_bits = 0;
+};
+
+} // myyuvDCT
@@ -1,41 +1,62 @@
 #include "DCT.hpp"
 
 #include "Huffman.hpp"
+#include "DCTKernels.hpp"
+#include "myyuv_parallel.hpp"
+#include "myyuv_convert/Convert.hpp"
 #include <stdexcept>
 #include <cassert>
 #include <cmath>
+#include <cstring>
 #include <algorithm>
 #include <vector>
-#ifdef MYYUV_USE_OPENMP
-#include <exception>
-#include <omp.h>
-#endif
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <type_traits>
 
 namespace {
 
 struct DCTYUVPlane {
   uint32_t chunks_sizes_size;
   uint32_t content_size;
-  uint8_t* chunks_sizes = nullptr;
-  uint8_t* content = nullptr;
-  std::vector<uint32_t> getContentPos() const {
-    assert(chunks_sizes_size > 0);
-    //assert(content_size > 0);
+  // Views into the compressed image data, see `load`
+  const uint8_t* chunks_sizes = nullptr;
+  const uint8_t* content = nullptr;
+  /**
+  * Sums sizes of blocks in rows `[rows_begin, rows_end)` of `row_blocks` blocks, the size of row `j` goes to `rows_pos[j + 1]`.
+  * Rows are independent, so it can run in parallel before `rowsSizesToPos`.
+  */
+  void getRowsSizes(uint32_t row_blocks, uint32_t rows_begin, uint32_t rows_end, uint32_t* rows_pos) const noexcept {
     assert(chunks_sizes);
-    //assert(content);
-    std::vector<uint32_t> res(chunks_sizes_size);
-    res[0] = 0;
-    for (uint32_t i = 1; i < chunks_sizes_size; i++) {
-      res[i] = res[i - 1] + chunks_sizes[i - 1];
+    assert(rows_end * row_blocks <= chunks_sizes_size);
+    for (uint32_t j = rows_begin; j < rows_end; j++) {
+      const uint8_t* sizes = chunks_sizes + j * row_blocks;
+      uint32_t row_size = 0;
+      for (uint32_t i = 0; i < row_blocks; i++) {
+        row_size += sizes[i];
+      }
+      rows_pos[j + 1] = row_size;
+    }
+  }
+  /**
+  * Turns sizes of rows from `getRowsSizes` into offsets of rows in `content`, the last element becomes the size of all rows.
+  */
+  static void rowsSizesToPos(std::vector<uint32_t>& rows_pos) noexcept {
+    assert(!rows_pos.empty());
+    rows_pos[0] = 0;
+    for (uint32_t j = 1; j < rows_pos.size(); j++) {
+      rows_pos[j] += rows_pos[j - 1];
     }
-    //assert(res[chunks_sizes_size - 1] + chunks_sizes[chunks_sizes_size - 1] == content_size);
-    return res;
   }
   uint32_t totalSize() const noexcept {
     assert(chunks_sizes_size > 0);
     assert(content_size > 0);
     return 2 * sizeof(uint32_t) + chunks_sizes_size + content_size;
   }
+  /**
+  * Makes a view of a plane in `data`, nothing is copied, so `data` must outlive the result.
+  */
   static DCTYUVPlane load(const uint8_t* data, uint32_t size) {
     uint32_t offset = 2 * sizeof(uint32_t);
     if (size <= offset) {
@@ -50,42 +71,14 @@ struct DCTYUVPlane {
     if (res.content_size <= 0) {
       throw std::runtime_error("DCTYUVPlane load content_size bad size");
     }
-    if (size < res.totalSize()) {
+    if (size < static_cast<uint64_t>(2 * sizeof(uint32_t)) + res.chunks_sizes_size + res.content_size) {
       throw std::runtime_error("DCTYUVPlane load bad size");
     }
-    res.chunks_sizes = new uint8_t[res.chunks_sizes_size];
-    std::copy(data + offset, data + offset + res.chunks_sizes_size, res.chunks_sizes);
+    res.chunks_sizes = data + offset;
     offset += res.chunks_sizes_size;
-    res.content = new uint8_t[res.content_size];
-    std::copy(data + offset, data + offset + res.content_size, res.content);
+    res.content = data + offset;
     return res;
   }
-  void dumpTo(uint8_t* data, uint32_t size) const {
-    assert(totalSize() <= size);
-    assert(chunks_sizes_size > 0);
-    assert(content_size > 0);
-    assert(chunks_sizes);
-    assert(content);
-    std::copy(reinterpret_cast<const uint8_t*>(&chunks_sizes_size), reinterpret_cast<const uint8_t*>(&chunks_sizes_size) + sizeof(chunks_sizes_size), data);
-    std::copy(reinterpret_cast<const uint8_t*>(&content_size), reinterpret_cast<const uint8_t*>(&content_size) + sizeof(content_size), data + sizeof(chunks_sizes_size));
-    std::copy(chunks_sizes, chunks_sizes + chunks_sizes_size, data + 2 * sizeof(uint32_t));
-    std::copy(content, content + content_size, data + totalSize() - content_size);
-  }
-  DCTYUVPlane() {}
-  ~DCTYUVPlane() {
-    delete[] chunks_sizes;
-    delete[] content;
-  }
-  DCTYUVPlane(DCTYUVPlane&& dct_plane) {
-    operator=(std::move(dct_plane));
-  }
-  DCTYUVPlane& operator=(DCTYUVPlane&& dct_plane) {
-    std::swap(chunks_sizes_size, dct_plane.chunks_sizes_size);
-    std::swap(content_size, dct_plane.content_size);
-    std::swap(chunks_sizes, dct_plane.chunks_sizes);
-    std::swap(content, dct_plane.content);
-    return *this;
-  }
   bool operator==(const DCTYUVPlane& dct_plane) const noexcept {
     if (chunks_sizes == nullptr || dct_plane.chunks_sizes == nullptr || content == nullptr || dct_plane.content == nullptr) {
       return chunks_sizes == dct_plane.chunks_sizes && content == dct_plane.content;
@@ -127,16 +120,18 @@ struct DCTYUV {
     }
     return res;
   }
+  /**
+  * Makes views of planes in `data`, nothing is copied, so `data` must outlive the result.
+  */
   static DCTYUV load(const uint8_t* data, uint32_t size) {
     uint32_t offset = sizeof(planes_sizes);
     if (size <= offset) {
       throw std::runtime_error("DCTYUV load bad size");
     }
     DCTYUV res;
-    const uint32_t* _data = reinterpret_cast<const uint32_t*>(data);
-    std::copy(_data, _data + sizeof(planes_sizes) / sizeof(*planes_sizes), res.planes_sizes);
+    std::memcpy(res.planes_sizes, data, sizeof(planes_sizes));
     {
-      uint32_t sz = offset;
+      uint64_t sz = offset;
       for (uint32_t i = 0; i < 3; i++) {
         sz += res.planes_sizes[i];
       }
@@ -157,29 +152,6 @@ struct DCTYUV {
     }
     return res;
   }
-  uint8_t* dump() const {
-    uint32_t sz = totalSize();
-    uint8_t* res = new uint8_t[sz];
-    std::copy(planes_sizes, planes_sizes + sizeof(planes_sizes) / sizeof(*planes_sizes), reinterpret_cast<uint32_t*>(res));
-    uint32_t offset = sizeof(planes_sizes);
-    for (uint32_t i = 0; i < 3; i++) {
-      if (planes_sizes[i] != 0) {
-        assert(planes_sizes[i] == planes[i].totalSize());
-        planes[i].dumpTo(res + offset, planes_sizes[i]);
-        offset += planes_sizes[i];
-      }
-    }
-    return res;
-  }
-  DCTYUV() {}
-  DCTYUV(DCTYUV&& dct) {
-    operator=(std::move(dct));
-  }
-  DCTYUV& operator=(DCTYUV&& dct) {
-    std::swap(planes_sizes, dct.planes_sizes);
-    std::swap(planes, dct.planes);
-    return *this;
-  }
   bool operator==(const DCTYUV& dct) const noexcept {
     if (!std::equal(planes_sizes, planes_sizes + sizeof(planes_sizes) / sizeof(*planes_sizes), dct.planes_sizes)) {
       return false;
@@ -218,6 +190,7 @@ static constexpr const float chroma_q_table[64] = {
   99, 99, 99, 99, 99, 99, 99, 99,
 };
 
+#ifdef MYYUV_DCT_REFERENCE
 static constexpr const float DCT_matrix8[64] = {
   0.3535533845424652f, 0.3535533845424652f, 0.3535533845424652f, 0.3535533845424652f, 0.3535533845424652f, 0.3535533845424652f, 0.3535533845424652f, 0.3535533845424652f, 
   0.4903925955295563f, 0.4157347679138184f, 0.277785062789917f, 0.09754510968923569f, -0.09754515439271927f, -0.2777851521968842f, -0.4157347977161407f, -0.4903926253318787f, 
@@ -265,173 +238,765 @@ static void squareMatrixMulT2(const float aT[size * size], const float b[size *
   }
 }
 
+// Reference transform: 2 full 8x8 matrix products (1024 multiply-adds)
 // data_block will be lost!
-static void applyDCTBlock(float data_block[64], int16_t res[64], const float q_table[64]) noexcept {
+static void applyDCTBlockMatrix(float data_block[64], int16_t res[64], const float q_table[64], [[maybe_unused]] int16_t max_coeff) noexcept {
   float data_block_2[64];
   squareMatrixMul<8>(DCT_matrix8, data_block, data_block_2);
   squareMatrixMulT<8>(data_block_2, DCT_matrix8, data_block);
   for (int i = 0; i < 64; i++) {
     res[i] = static_cast<int16_t>(std::round(data_block[i] / q_table[i]));
-    assert(res[i] <= 1023 && res[i] >= -1024);
+    assert(res[i] <= max_coeff && res[i] >= -max_coeff - 1);
+  }
+}
+
+static void restoreDCTBlockMatrix(float block_res[64], const int16_t coeffs[64], const float q_table[64]) noexcept {
+  float data_block[64];
+  for (uint32_t i = 0; i < 64; i++) {
+    block_res[i] = static_cast<float>(coeffs[i]) * q_table[i];
+  }
+  squareMatrixMulT2<8>(DCT_matrix8, block_res, data_block);
+  squareMatrixMul<8>(data_block, DCT_matrix8, block_res);
+}
+#endif // MYYUV_DCT_REFERENCE
+
+/**
+* Sample format of a plane: samples of `bits` bits are stored shifted left by `shift`, in 1 byte for 8 bits and in 2 bytes otherwise.
+* Quantized coefficients of `bits` bit samples take `symbol_bits` bits in Huffman trees.
+*/
+struct DCTSampleFormat {
+  uint8_t bits;
+  uint8_t shift;
+  uint8_t symbol_bits;
+  explicit DCTSampleFormat(myyuv::YUV::FourccFormat fourcc_format) noexcept {
+    const auto sample_bits = myyuv::YUV::getSampleBits(fourcc_format);
+    bits = sample_bits[0];
+    shift = sample_bits[1];
+    // every extra bit of samples is an extra bit of coefficients
+    symbol_bits = myyuvDCT::Huffman::default_symbol_bits + bits - 8;
+    assert(symbol_bits <= myyuvDCT::Huffman::max_symbol_bits);
   }
+  int16_t maxCoeff() const noexcept {
+    return static_cast<int16_t>((1 << (symbol_bits - 1)) - 1);
+  }
+};
+
+#ifndef MYYUV_DCT_REFERENCE
+// Kernels of both sample types
+
+static void fdctQuantize(myyuv::SimdLevel level, const uint8_t* src, uint32_t stride, const DCTSampleFormat&, const float fdct_scale[64], int16_t res[64]) noexcept {
+  myyuvDCT::fdct_quantize(level, src, stride, fdct_scale, res);
 }
 
-static void applyDCTPlane(DCTYUVPlane& res, const uint8_t* data, uint32_t width, uint32_t height, float q, const float q_50_table[64]) {
+static void fdctQuantize(myyuv::SimdLevel level, const uint16_t* src, uint32_t stride, const DCTSampleFormat& format, const float fdct_scale[64], int16_t res[64]) noexcept {
+  myyuvDCT::fdct_quantize(level, src, stride, format.bits, format.shift, fdct_scale, res);
+}
+
+static bool flatDC(myyuv::SimdLevel level, const uint8_t* src, uint32_t stride, const DCTSampleFormat&, uint8_t max_range, float dc_scale, int16_t& dc) noexcept {
+  return myyuvDCT::flat_dc(level, src, stride, max_range, dc_scale, dc);
+}
+
+static bool flatDC(myyuv::SimdLevel level, const uint16_t* src, uint32_t stride, const DCTSampleFormat& format, uint8_t max_range, float dc_scale, int16_t& dc) noexcept {
+  return myyuvDCT::flat_dc(level, src, stride, format.bits, format.shift, max_range, dc_scale, dc);
+}
+
+static void idctStore(myyuv::SimdLevel level, const float coeffs[64], uint8_t* dst, uint32_t stride, const DCTSampleFormat&) noexcept {
+  myyuvDCT::idct_store(level, coeffs, dst, stride);
+}
+
+static void idctStore(myyuv::SimdLevel level, const float coeffs[64], uint16_t* dst, uint32_t stride, const DCTSampleFormat& format) noexcept {
+  myyuvDCT::idct_store(level, coeffs, dst, stride, format.bits, format.shift);
+}
+
+static void idctStore4x4(myyuv::SimdLevel level, const float coeffs[64], uint8_t* dst, uint32_t stride, const DCTSampleFormat&) noexcept {
+  myyuvDCT::idct_store_4x4(level, coeffs, dst, stride);
+}
+
+static void idctStore4x4(myyuv::SimdLevel level, const float coeffs[64], uint16_t* dst, uint32_t stride, const DCTSampleFormat& format) noexcept {
+  myyuvDCT::idct_store_4x4(level, coeffs, dst, stride, format.bits, format.shift);
+}
+
+static void idctStoreDC(myyuv::SimdLevel level, float dc, uint8_t* dst, uint32_t stride, const DCTSampleFormat&) noexcept {
+  myyuvDCT::idct_store_dc(level, dc, dst, stride);
+}
+
+static void idctStoreDC(myyuv::SimdLevel level, float dc, uint16_t* dst, uint32_t stride, const DCTSampleFormat& format) noexcept {
+  myyuvDCT::idct_store_dc(level, dc, dst, stride, format.bits, format.shift);
+}
+#endif // !MYYUV_DCT_REFERENCE
+
+/**
+* Quantization tables for a plane.
+* `fdct_scale` and `idct_scale` have AAN scale factors folded in.
+* `flat_max_range` is the largest range of samples in a block for which every AC coefficient is quantized to 0.
+* Tables of high bit depth samples are scaled by `2^(bits - 8)`, so a quality loses the same share of the sample range,
+* but they go down to 1 and quality 100 keeps every bit.
+*/
+struct DCTQuantization {
+  float q_table[64];
+  float fdct_scale[64];
+  float idct_scale[64];
+  uint8_t flat_max_range;
+  DCTQuantization(float q, const float q_50_table[64], uint8_t bits) noexcept {
+    const float q_table_mul = (q >= 50.5f) ? (100.0f - q) / 50.0f : 50.0f / q;
+    const float bits_mul = static_cast<float>(1u << (bits - 8));
+    for (uint32_t i = 0; i < 64; i++) {
+      q_table[i] = std::clamp(std::round(q_50_table[i] * q_table_mul * bits_mul), 1.0f, 255.0f * bits_mul);
+      const float aan = myyuvDCT::aan_scale_factors[i / 8] * myyuvDCT::aan_scale_factors[i % 8];
+      fdct_scale[i] = 1.0f / (q_table[i] * aan * 8.0f);
+      idct_scale[i] = q_table[i] * aan / 8.0f;
+    }
+    // AC basis functions sum to 0, so for samples within `range` of each other
+    // |F(u, v)| <= range / 2 * basis_abs_sum[u] * basis_abs_sum[v] / 4, where basis_abs_sum[u] = C(u) * sum(|cos((2x + 1) * u * pi / 16)|).
+    // 0.45 instead of 0.5 leaves room for float rounding in the fast DCT.
+    float basis_abs_sum[8];
+    for (uint32_t u = 0; u < 8; u++) {
+      float sum = 0.0f;
+      for (uint32_t x = 0; x < 8; x++) {
+        sum += std::abs(std::cos((2.0f * x + 1.0f) * u * 3.14159265f / 16.0f));
+      }
+      basis_abs_sum[u] = (u == 0) ? sum * 0.707106781f : sum;
+    }
+    float max_ac_per_range = 0.0f;
+    for (uint32_t i = 1; i < 64; i++) {
+      max_ac_per_range = std::max(max_ac_per_range, basis_abs_sum[i / 8] * basis_abs_sum[i % 8] / 8.0f / q_table[i]);
+    }
+    flat_max_range = static_cast<uint8_t>(std::min(std::floor(0.45f / max_ac_per_range), 255.0f));
+  }
+};
+
+template <typename S>
+static void applyDCTBlock(const S* data, uint32_t stride, int16_t res[64], const DCTQuantization& quant, const DCTSampleFormat& format, [[maybe_unused]] myyuv::SimdLevel level) noexcept {
+#ifdef MYYUV_DCT_REFERENCE
+  float data_block[64];
+  for (uint32_t jj = 0; jj < 8; jj++) {
+    for (uint32_t ii = 0; ii < 8; ii++) {
+      data_block[ii + jj * 8] = static_cast<float>(data[ii + jj * stride] >> format.shift) - static_cast<float>(1u << (format.bits - 1));
+    }
+  }
+  applyDCTBlockMatrix(data_block, res, quant.q_table, format.maxCoeff());
+#else
+  fdctQuantize(level, data, stride, format, quant.fdct_scale, res);
+  assert(std::all_of(res, res + 64, [max = format.maxCoeff()](int16_t c) { return c <= max && c >= -max - 1; }));
+#endif
+}
+
+template <typename S>
+static bool applyDCTFlatBlock([[maybe_unused]] const S* data, [[maybe_unused]] uint32_t stride, [[maybe_unused]] int16_t& dc, [[maybe_unused]] const DCTQuantization& quant, [[maybe_unused]] const DCTSampleFormat& format, [[maybe_unused]] myyuv::SimdLevel level) noexcept {
+#ifdef MYYUV_DCT_REFERENCE
+  return false;
+#else
+  return flatDC(level, data, stride, format, quant.flat_max_range, quant.fdct_scale[0], dc);
+#endif
+}
+
+// Amount of blocks encoded as flat, see `get_flat_blocks_counter`
+static std::atomic<uint64_t> dct_flat_blocks(0);
+
+/**
+* Runs `f(plane, rows_begin, rows_end)` in parallel for block rows of all 3 planes.
+* Planes x block rows are one task space, so small chroma planes don't leave threads idle.
+*/
+template <typename F>
+static void parallelForPlanesRows(const std::array<uint32_t, 3>& rows, F f) {
+  const uint32_t rows_begin[4] = { 0, rows[0], rows[0] + rows[1], rows[0] + rows[1] + rows[2] };
+  // A few chunks per thread to balance planes of different cost
+  const uint32_t chunk = std::max<uint32_t>(1, rows_begin[3] / (myyuv::getThreadsCount() * 4));
+  myyuvParallel::parallel_for_chunks(rows_begin[3], chunk, [&](uint32_t begin, uint32_t end) {
+    for (uint8_t p = 0; p < 3; p++) {
+      const uint32_t plane_begin = std::max(begin, rows_begin[p]);
+      const uint32_t plane_end = std::min(end, rows_begin[p + 1]);
+      if (plane_begin < plane_end) {
+        f(p, plane_begin - rows_begin[p], plane_end - rows_begin[p]);
+      }
+    }
+  });
+}
+
+static void checkDCTPlaneSize(uint32_t width, uint32_t height) {
   if (width % 8 != 0) {
     throw std::runtime_error("Error. width % 8 must be 0");
   }
   if (height % 8 != 0) {
     throw std::runtime_error("Error. height % 8 must be 0");
   }
-  float q_table[64];
-  const float q_table_mul = (q >= 50.5f) ? (100.0f - q) / 50.0f : 50.0f / q;
-  for (uint32_t i = 0; i < 64; i++) {
-    q_table[i] = std::clamp(std::round(q_50_table[i] * q_table_mul), 1.0f, 255.0f);
+}
+
+/// How samples of a plane are laid out in memory.
+enum class DCTSamples : uint8_t {
+  CONTIGUOUS, /// Samples are contiguous in rows.
+  PAIRS, /// Chroma of semi-planar formats, rows of interleaved pairs.
+  PACKED_422, /// Rows of packed 4:2:2 macropixels.
+};
+
+/**
+* Memory of a plane of a view.
+* Rows of interleaved samples start at `data` and are `stride` bytes apart. For `DCTSamples::PAIRS` the channel is `index` in every pair,
+* for `DCTSamples::PACKED_422` it's output `index` of `unpack_yuv422_row` (luma, first chroma, second chroma).
+*/
+template <typename T>
+struct DCTPlaneLayout {
+  T* data;
+  uint32_t stride;
+  DCTSamples samples;
+  uint8_t index;
+  bool chroma_first;
+};
+
+/**
+* Gets memory layouts of the 3 planes of a view.
+* @throws std::runtime_error if samples of a planar format are not contiguous, chroma of a semi-planar format is not interleaved pairs
+* or samples of a packed format are not macropixels.
+*/
+template <typename T>
+static std::array<DCTPlaneLayout<T>, 3> getDCTPlaneLayouts(const myyuv::BasicYUVView<T>& view) {
+  std::array<DCTPlaneLayout<T>, 3> res;
+  const uint32_t sample_bytes = myyuv::YUV::getBytesPerSample(view.fourcc_format);
+  for (uint8_t i = 0; i < 3; i++) {
+    if (view.strides[i] % sample_bytes != 0 || reinterpret_cast<uintptr_t>(view.planes[i]) % sample_bytes != 0) {
+      throw std::runtime_error("Error. Samples of YUV must be aligned to their size");
+    }
+    res[i] = { view.planes[i], view.strides[i], DCTSamples::CONTIGUOUS, 0, false };
   }
-  res.chunks_sizes_size = width * height / 64;
-  res.chunks_sizes = new uint8_t[res.chunks_sizes_size];
-  uint8_t** contents = new uint8_t*[res.chunks_sizes_size];
-#ifdef MYYUV_USE_OPENMP
-  #pragma omp parallel for schedule(dynamic, 1) collapse(2)
-#endif
-  for (uint32_t j = 0; j < height; j += 8) {
+  const myyuv::YUV::FormatGroup format_group = myyuv::YUV::getFormatGroup(view.fourcc_format);
+  if (format_group == myyuv::YUV::FormatGroup::PACKED) {
+    // Macropixels are Y C0 Y C1 or C0 Y C1 Y
+    T* const base = std::min({ view.planes[0], view.planes[1], view.planes[2] });
+    const bool chroma_first = view.planes[0] != base;
+    T* const c0 = chroma_first ? base : base + 1;
+    if (view.pixel_strides[0] != 2 || view.pixel_strides[1] != 4 || view.pixel_strides[2] != 4 ||
+      view.strides[0] != view.strides[1] || view.strides[0] != view.strides[2] ||
+      view.planes[0] != (chroma_first ? base + 1 : base) || std::min(view.planes[1], view.planes[2]) != c0 || std::max(view.planes[1], view.planes[2]) != c0 + 2) {
+      throw std::runtime_error("Error. Samples of packed YUV must be interleaved macropixels");
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+      const uint8_t index = i == 0 ? 0 : (view.planes[i] == c0 ? 1 : 2);
+      res[i] = { base, view.strides[i], DCTSamples::PACKED_422, index, chroma_first };
+    }
+    return res;
+  }
+  if (format_group != myyuv::YUV::FormatGroup::SEMI_PLANAR) {
+    if (view.pixel_strides[0] != sample_bytes || view.pixel_strides[1] != sample_bytes || view.pixel_strides[2] != sample_bytes) {
+      throw std::runtime_error("Error. Samples of planar YUV must be contiguous");
+    }
+    return res;
+  }
+  T* const pairs = std::min(view.planes[1], view.planes[2]);
+  if (view.pixel_strides[0] != sample_bytes || view.pixel_strides[1] != 2 * sample_bytes || view.pixel_strides[2] != 2 * sample_bytes ||
+    view.strides[1] != view.strides[2] || std::max(view.planes[1], view.planes[2]) != pairs + sample_bytes) {
+    throw std::runtime_error("Error. Chroma of semi-planar YUV must be interleaved pairs");
+  }
+  for (uint8_t i = 1; i < 3; i++) {
+    res[i] = { pairs, view.strides[i], DCTSamples::PAIRS, static_cast<uint8_t>((view.planes[i] - pairs) / sample_bytes), false };
+  }
+  return res;
+}
+
+/**
+* Bump pointer arena for block dumps of one task, dumps of consecutive blocks are contiguous.
+* It grows by doubling, so block dumps are addressed by offsets until the task is finished.
+*/
+class DCTDumpArena {
+public:
+  explicit DCTDumpArena(uint32_t capacity) : data(myyuv::allocateBuffer(capacity)), capacity(capacity) {}
+  /// Get space for the next block dump of at most `max_dump_size` bytes.
+  uint8_t* reserve() {
+    if (size + myyuvDCT::Huffman::max_dump_size > capacity) {
+      capacity = std::max(capacity * 2, size + myyuvDCT::Huffman::max_dump_size);
+      myyuv::BufferPtr new_data(myyuv::allocateBuffer(capacity));
+      std::copy(data.get(), data.get() + size, new_data.get());
+      data = std::move(new_data);
+    }
+    return data.get() + size;
+  }
+  /// Keeps `dump_size` bytes of the space from `reserve`.
+  void commit(uint8_t dump_size) noexcept {
+    assert(size + dump_size <= capacity);
+    size += dump_size;
+  }
+  uint32_t getSize() const noexcept {
+    return size;
+  }
+  myyuv::BufferPtr release() noexcept {
+    return std::move(data);
+  }
+private:
+  myyuv::BufferPtr data;
+  uint32_t capacity;
+  uint32_t size = 0;
+};
+
+/**
+* Compresses block rows `[rows_begin, rows_end)` of a plane into an arena owned by `rows_arenas[rows_begin]`.
+* Dump of row `j` starts at `rows_data[j]` and its size goes to `rows_pos[j + 1]`.
+* Blocks of interleaved samples are deinterleaved into temporary blocks, the rest of the plane is never copied.
+* The loop is specialized on `Samples` of the plane and on the sample type `S`, so plain planes have no per-block layout checks.
+*/
+template <DCTSamples Samples, typename S>
+static void applyDCTRows(uint8_t* chunks_sizes, myyuv::BufferPtr* rows_arenas, const uint8_t** rows_data, uint32_t* rows_pos, const DCTPlaneLayout<const uint8_t>& plane, uint32_t width, uint32_t rows_begin, uint32_t rows_end, const DCTQuantization& quant, const DCTSampleFormat& format, myyuv::SimdLevel level) {
+  assert(plane.samples == Samples);
+  static_assert(Samples != DCTSamples::PACKED_422 || std::is_same<S, uint8_t>::value, "Packed formats have only 8-bit samples");
+  // Most blocks take well under 32 bytes
+  DCTDumpArena arena((rows_end - rows_begin) * width / 8 * 32);
+  uint64_t flat_blocks = 0;
+  alignas(32) S blocks[3][128];
+  const S* const data = reinterpret_cast<const S*>(plane.data);
+  const uint32_t plane_stride = plane.stride / sizeof(S);
+  for (uint32_t j = rows_begin * 8; j < rows_end * 8; j += 8) {
+    const uint32_t row_begin = arena.getSize();
     for (uint32_t i = 0; i < width; i += 8) {
-      int16_t block_res[64];
-      float data_block[64];
-      for (uint32_t jj = 0; jj < 8; jj++) {
-        for (uint32_t ii = 0; ii < 8; ii++) {
-          data_block[ii + jj * 8] = static_cast<float>(data[(i + ii) + (j + jj) * width]) - 128.0f;
+      const uint32_t k = (i + j * width / 8) / 8;
+      uint8_t* dump_data = arena.reserve();
+      int16_t dc;
+      const S* block = data + i + static_cast<size_t>(j) * plane_stride;
+      uint32_t stride = plane_stride;
+      if constexpr (Samples == DCTSamples::PAIRS) {
+        const S* pairs = data + 2 * i + static_cast<size_t>(j) * plane_stride;
+        for (uint32_t jj = 0; jj < 8; jj++) {
+          myyuvConvert::deinterleave_uv_row(level, pairs + jj * plane_stride, blocks[0] + jj * 8, blocks[1] + jj * 8, 8);
         }
+        block = blocks[plane.index];
+        stride = 8;
+      } else if constexpr (Samples == DCTSamples::PACKED_422) {
+        // A luma block takes 4 macropixels of a row, a chroma block takes 8
+        const uint32_t pixels = plane.index == 0 ? 8 : 16;
+        const uint8_t* macropixels = data + 2 * (plane.index == 0 ? i : 2 * i) + static_cast<size_t>(j) * plane_stride;
+        for (uint32_t jj = 0; jj < 8; jj++) {
+          myyuvConvert::unpack_yuv422_row(level, macropixels + jj * plane_stride, blocks[0] + jj * pixels, blocks[1] + jj * 8, blocks[2] + jj * 8, pixels, plane.chroma_first);
+        }
+        block = blocks[plane.index];
+        stride = 8;
       }
-      applyDCTBlock(data_block, block_res, q_table);
-      myyuvDCT::Huffman huffman = myyuvDCT::Huffman::fromData(block_res);
-      const uint32_t k = (i + j * width / 8) / 8;
-      assert(k < res.chunks_sizes_size);
-      huffman.dump(contents[k], res.chunks_sizes[k]);
-      assert(res.chunks_sizes[k]);
+      if (applyDCTFlatBlock(block, stride, dc, quant, format, level)) {
+        chunks_sizes[k] = myyuvDCT::Huffman::dumpDC(dc, dump_data, format.symbol_bits);
+        flat_blocks++;
+      } else {
+        int16_t block_res[64];
+        applyDCTBlock(block, stride, block_res, quant, format, level);
+        chunks_sizes[k] = myyuvDCT::Huffman::fromData(block_res, format.symbol_bits).dumpTo(dump_data);
+      }
+      assert(chunks_sizes[k]);
+      arena.commit(chunks_sizes[k]);
     }
+    rows_pos[j / 8 + 1] = arena.getSize() - row_begin;
   }
-  std::vector<uint32_t> content_pos = res.getContentPos();
-  res.content_size = content_pos[res.chunks_sizes_size - 1] + res.chunks_sizes[res.chunks_sizes_size - 1];
-  assert(res.content_size > 0);
-  res.content = new uint8_t[res.content_size];
-  for (uint32_t i = 0; i < res.chunks_sizes_size; i++) {
-    std::copy(contents[i], contents[i] + res.chunks_sizes[i], res.content + content_pos[i]);
-    delete[] contents[i];
+  rows_arenas[rows_begin] = arena.release();
+  // rows are contiguous in the arena
+  const uint8_t* row_data = rows_arenas[rows_begin].get();
+  for (uint32_t j = rows_begin; j < rows_end; j++) {
+    rows_data[j] = row_data;
+    row_data += rows_pos[j + 1];
   }
-  delete[] contents;
+  dct_flat_blocks.fetch_add(flat_blocks, std::memory_order_relaxed);
 }
 
-static void restoreDCTBlock(float block_res[64], const uint8_t* huffman_data, uint8_t huffman_size, const float q_table[64]) {
-  const myyuvDCT::Huffman huffman = myyuvDCT::Huffman::fromDump(huffman_data, huffman_size);
-  float data_block[64];
-  int16_t huffman_block_data[64];
-  huffman.getData(huffman_block_data);
-  for (uint32_t i = 0; i < 64; i++) {
-    block_res[i] = static_cast<float>(huffman_block_data[i]) * q_table[i];
+/// Inverse DCT path of a block.
+enum class IDCTPath : uint8_t {
+  DC_ONLY,
+  SPARSE,
+  FULL,
+};
+
+// Amounts of blocks restored by each inverse DCT path, see `get_idct_path_counters`
+static std::atomic<uint64_t> idct_dc_only_blocks(0);
+static std::atomic<uint64_t> idct_sparse_blocks(0);
+static std::atomic<uint64_t> idct_full_blocks(0);
+
+/**
+* Amounts of blocks of one task restored by each inverse DCT path, added to the shared counters at once.
+*/
+struct IDCTPathCount {
+  uint64_t dc_only = 0;
+  uint64_t sparse = 0;
+  uint64_t full = 0;
+  void add(IDCTPath path) noexcept {
+    switch (path) {
+      case IDCTPath::DC_ONLY:
+        dc_only++;
+        break;
+      case IDCTPath::SPARSE:
+        sparse++;
+        break;
+      case IDCTPath::FULL:
+        full++;
+        break;
+    }
   }
-  squareMatrixMulT2<8>(DCT_matrix8, block_res, data_block);
-  squareMatrixMul<8>(data_block, DCT_matrix8, block_res);
-}
+  void flush() const noexcept {
+    idct_dc_only_blocks.fetch_add(dc_only, std::memory_order_relaxed);
+    idct_sparse_blocks.fetch_add(sparse, std::memory_order_relaxed);
+    idct_full_blocks.fetch_add(full, std::memory_order_relaxed);
+  }
+};
 
-static void restoreDCTPlane(uint8_t* res, const DCTYUVPlane& dct, uint32_t width, uint32_t height, float q, const float q_50_table[64]) {
-  if (width % 8 != 0) {
-    throw std::runtime_error("Error. width % 8 must be 0");
+template <typename S>
+static IDCTPath restoreDCTBlock(S* res, uint32_t stride, const uint8_t* huffman_data, uint8_t huffman_size, const DCTQuantization& quant, const DCTSampleFormat& format, [[maybe_unused]] myyuv::SimdLevel level) {
+#ifdef MYYUV_DCT_REFERENCE
+  const myyuvDCT::Huffman huffman = myyuvDCT::Huffman::fromDump(huffman_data, huffman_size, format.symbol_bits);
+  int16_t huffman_block_data[64];
+  huffman.getData(huffman_block_data);
+  float block_res[64];
+  restoreDCTBlockMatrix(block_res, huffman_block_data, quant.q_table);
+  for (uint32_t jj = 0; jj < 8; jj++) {
+    for (uint32_t ii = 0; ii < 8; ii++) {
+      res[ii + jj * stride] = static_cast<S>(std::clamp(static_cast<int>(std::round(block_res[ii + jj * 8])) + (1 << (format.bits - 1)), 0, (1 << format.bits) - 1) << format.shift);
+    }
   }
-  if (height % 8 != 0) {
-    throw std::runtime_error("Error. height % 8 must be 0");
+  return IDCTPath::FULL;
+#else
+  alignas(32) float coeffs[64];
+  bool in_4x4;
+  const uint8_t last_nonzero = myyuvDCT::Huffman::decodeDump(huffman_data, huffman_size, quant.idct_scale, coeffs, in_4x4, format.symbol_bits);
+  if (last_nonzero == 0) {
+    idctStoreDC(level, coeffs[0], res, stride, format);
+    return IDCTPath::DC_ONLY;
   }
-  float q_table[64];
-  const float q_table_mul = (q >= 50.5f) ? (100.0f - q) / 50.0f : 50.0f / q;
-  for (uint32_t i = 0; i < 64; i++) {
-    q_table[i] = std::clamp(std::round(q_50_table[i] * q_table_mul), 1.0f, 255.0f);
+  if (in_4x4) {
+    idctStore4x4(level, coeffs, res, stride, format);
+    return IDCTPath::SPARSE;
   }
-  std::vector<uint32_t> contents = dct.getContentPos();
-#ifdef MYYUV_USE_OPENMP
-  #pragma omp parallel for schedule(dynamic, 1) collapse(2)
+  idctStore(level, coeffs, res, stride, format);
+  return IDCTPath::FULL;
 #endif
-  for (uint32_t j = 0; j < height; j += 8) {
+}
+
+/**
+* Restores block rows `[rows_begin, rows_end)` of a plane whose rows are `stride` samples apart.
+*/
+template <typename S>
+static void restoreDCTRows(S* res, const DCTYUVPlane& dct, const uint32_t* rows_pos, uint32_t width, uint32_t stride, uint32_t rows_begin, uint32_t rows_end, const DCTQuantization& quant, const DCTSampleFormat& format, myyuv::SimdLevel level) {
+  IDCTPathCount count;
+  for (uint32_t j = rows_begin * 8; j < rows_end * 8; j += 8) {
+    const uint8_t* content = dct.content + rows_pos[j / 8];
+    for (uint32_t i = 0; i < width; i += 8) {
+      const uint32_t k = (i + j * width / 8) / 8;
+      const uint8_t* huffman_data = content;
+      content += dct.chunks_sizes[k];
+      count.add(restoreDCTBlock(res + i + static_cast<size_t>(j) * stride, stride, huffman_data, dct.chunks_sizes[k], quant, format, level));
+    }
+  }
+  count.flush();
+}
+
+/**
+* Restores block rows `[rows_begin, rows_end)` of both chroma planes into interleaved rows of pairs that are `stride` samples apart.
+* Blocks of the two planes are restored into temporary blocks and interleaved together, so tasks never write the same pairs.
+* `dct[c]`, `rows_pos[c]` and `quant[c]` belong to the channel at offset `c` in a pair.
+*/
+template <typename S>
+static void restoreDCTRowsInterleaved(S* res, const std::array<const DCTYUVPlane*, 2>& dct, const std::array<const uint32_t*, 2>& rows_pos, uint32_t width, uint32_t stride, uint32_t rows_begin, uint32_t rows_end, const std::array<const DCTQuantization*, 2>& quant, const DCTSampleFormat& format, myyuv::SimdLevel level) {
+  IDCTPathCount count;
+  alignas(32) S blocks[2][64];
+  for (uint32_t j = rows_begin * 8; j < rows_end * 8; j += 8) {
+    const uint8_t* content[2] = { dct[0]->content + rows_pos[0][j / 8], dct[1]->content + rows_pos[1][j / 8] };
     for (uint32_t i = 0; i < width; i += 8) {
       const uint32_t k = (i + j * width / 8) / 8;
-      float block_res[64];
-      restoreDCTBlock(block_res, dct.content + contents[k], dct.chunks_sizes[k], q_table);
+      for (uint8_t c = 0; c < 2; c++) {
+        count.add(restoreDCTBlock(blocks[c], 8, content[c], dct[c]->chunks_sizes[k], *quant[c], format, level));
+        content[c] += dct[c]->chunks_sizes[k];
+      }
+      S* pairs = res + 2 * i + static_cast<size_t>(j) * stride;
       for (uint32_t jj = 0; jj < 8; jj++) {
-        for (uint32_t ii = 0; ii < 8; ii++) {
-          res[(i + ii) + (j + jj) * width] = std::clamp(static_cast<int>(std::round(block_res[ii + jj * 8])) + 128, 0, UINT8_MAX);
-        }
+        myyuvConvert::interleave_uv_row(level, blocks[0] + jj * 8, blocks[1] + jj * 8, pairs + jj * stride, 8);
       }
     }
   }
+  count.flush();
 }
 
-} // namespace
+/**
+* Restores block rows `[rows_begin, rows_end)` of all planes into rows of packed 4:2:2 macropixels that are `stride` bytes apart.
+* Every 16 pixels of a block row are 2 luma blocks and a block of each chroma, they are restored into temporary blocks and packed together,
+* so tasks never write the same macropixels.
+* `dct[c]`, `rows_pos[c]` and `quant[c]` belong to output `c` of `unpack_yuv422_row`, `width` is the luma width.
+*/
+static void restoreDCTRowsPacked(uint8_t* res, const std::array<const DCTYUVPlane*, 3>& dct, const std::array<const uint32_t*, 3>& rows_pos, uint32_t width, uint32_t stride, bool chroma_first, uint32_t rows_begin, uint32_t rows_end, const std::array<const DCTQuantization*, 3>& quant, const DCTSampleFormat& format, myyuv::SimdLevel level) {
+  IDCTPathCount count;
+  alignas(32) uint8_t luma_blocks[128];
+  alignas(32) uint8_t chroma_blocks[2][64];
+  for (uint32_t j = rows_begin * 8; j < rows_end * 8; j += 8) {
+    const uint8_t* content[3] = { dct[0]->content + rows_pos[0][j / 8], dct[1]->content + rows_pos[1][j / 8], dct[2]->content + rows_pos[2][j / 8] };
+    for (uint32_t i = 0; i < width; i += 16) {
+      for (uint32_t ii = 0; ii < 16; ii += 8) {
+        const uint32_t k = (i + ii + j * width / 8) / 8;
+        count.add(restoreDCTBlock(luma_blocks + ii, 16, content[0], dct[0]->chunks_sizes[k], *quant[0], format, level));
+        content[0] += dct[0]->chunks_sizes[k];
+      }
+      const uint32_t k = (i / 2 + j * width / 16) / 8;
+      for (uint8_t c = 0; c < 2; c++) {
+        count.add(restoreDCTBlock(chroma_blocks[c], 8, content[c + 1], dct[c + 1]->chunks_sizes[k], *quant[c + 1], format, level));
+        content[c + 1] += dct[c + 1]->chunks_sizes[k];
+      }
+      uint8_t* macropixels = res + 2 * i + static_cast<size_t>(j) * stride;
+      for (uint32_t jj = 0; jj < 8; jj++) {
+        myyuvConvert::pack_yuv422_row(level, luma_blocks + jj * 16, chroma_blocks[0] + jj * 8, chroma_blocks[1] + jj * 8, macropixels + jj * stride, 16, chroma_first);
+      }
+    }
+  }
+  count.flush();
+}
 
-namespace myyuvDCT {
+/**
+* Block dumps of all planes, written out by `writeDCTPlanes` in the layout of `DCTYUV`.
+*/
+struct DCTEncodedPlanes {
+  std::array<uint32_t, 3> widths;
+  std::array<uint32_t, 3> rows;
+  myyuv::BufferPtr chunks_sizes[3];
+  std::vector<myyuv::BufferPtr> rows_arenas[3];
+  std::vector<const uint8_t*> rows_data[3];
+  std::vector<uint32_t> rows_pos[3];
+  uint32_t blocksCount(uint8_t i) const noexcept {
+    return widths[i] / 8 * rows[i];
+  }
+  /// The same as `DCTYUVPlane::totalSize`.
+  uint32_t planeSize(uint8_t i) const noexcept {
+    return 2 * sizeof(uint32_t) + blocksCount(i) + rows_pos[i].back();
+  }
+  /// The same as `DCTYUV::totalSize`.
+  uint32_t totalSize() const noexcept {
+    return 3 * sizeof(uint32_t) + planeSize(0) + planeSize(1) + planeSize(2);
+  }
+};
+
+/**
+* Compresses block rows `[rows_begin, rows_end)` of plane `i` of samples of type `S` into `res`.
+*/
+template <typename S>
+static void applyDCTPlaneRows(DCTEncodedPlanes& res, uint8_t i, const DCTPlaneLayout<const uint8_t>& layout, uint32_t rows_begin, uint32_t rows_end, const DCTQuantization& quant, const DCTSampleFormat& format, myyuv::SimdLevel level) {
+  switch (layout.samples) {
+    case DCTSamples::CONTIGUOUS:
+      applyDCTRows<DCTSamples::CONTIGUOUS, S>(res.chunks_sizes[i].get(), res.rows_arenas[i].data(), res.rows_data[i].data(), res.rows_pos[i].data(), layout, res.widths[i], rows_begin, rows_end, quant, format, level);
+      break;
+    case DCTSamples::PAIRS:
+      applyDCTRows<DCTSamples::PAIRS, S>(res.chunks_sizes[i].get(), res.rows_arenas[i].data(), res.rows_data[i].data(), res.rows_pos[i].data(), layout, res.widths[i], rows_begin, rows_end, quant, format, level);
+      break;
+    case DCTSamples::PACKED_422:
+      if constexpr (std::is_same<S, uint8_t>::value) {
+        applyDCTRows<DCTSamples::PACKED_422, S>(res.chunks_sizes[i].get(), res.rows_arenas[i].data(), res.rows_data[i].data(), res.rows_pos[i].data(), layout, res.widths[i], rows_begin, rows_end, quant, format, level);
+      } else {
+        assert(false); // Packed formats have only 8-bit samples
+      }
+      break;
+  }
+}
 
-myyuv::YUV compress_DCT_planar(const myyuv::YUV& yuv, const std::array<uint8_t, 3>& params) {
-  if (yuv.getFormatGroup() != myyuv::YUV::FormatGroup::PLANAR) {
-    throw std::runtime_error("Error compressing: YUV must be planar");
+/**
+* Compresses all planes of `src` into block dumps and fills `header` of the compressed image.
+*/
+static DCTEncodedPlanes encodeDCTPlanes(const myyuv::ConstYUVView& src, const std::array<uint8_t, 3>& params, myyuv::YUVHeader& header) {
+  const myyuv::YUV::FormatGroup format_group = myyuv::YUV::getFormatGroup(src.fourcc_format);
+  if (format_group != myyuv::YUV::FormatGroup::PLANAR && format_group != myyuv::YUV::FormatGroup::SEMI_PLANAR && format_group != myyuv::YUV::FormatGroup::PACKED) {
+    throw std::runtime_error("Error compressing: YUV must be planar, semi-planar or packed");
   }
-  if (yuv.getCompression() != myyuv::YUV::Compressions::NONE) {
-    throw std::runtime_error("Error compressing: can't compress uncompressed YUV");
+  if (!src.isValid()) {
+    throw std::runtime_error("Error compressing: YUV view is invalid");
   }
   for (uint32_t i = 0; i < 3; i++) {
     if (params[i] < 1 || params[i] > 100) {
       throw std::runtime_error("Level of quality must be between 1 and 100");
     }
   }
-  auto fractions = yuv.getResolutionFraction();
-  assert(yuv.header.width % (8 * fractions[0]) == 0);
-  assert(yuv.header.height % (8 * fractions[1]) == 0);
-  auto planes = yuv.getYUVPlanes();
+  [[maybe_unused]] const auto& planes = src.planes;
   assert(myyuv::YUV::max_planes == 3 || myyuv::YUV::max_planes > 3 && planes[3] == nullptr); // Transparency is not supported
   assert(planes[0] != nullptr && planes[1] != nullptr && planes[2] != nullptr); // not ready to handle when one plane is missing
-  myyuv::YUV res;
-  res.header = yuv.header;
-  res.header.compression = static_cast<uint16_t>(myyuv::YUV::Compressions::DCT);
-  res.header.compression_params_size = 3;
-  res.header.compression_params_pos = sizeof(res.header);
-  res.header.data_pos = sizeof(res.header) + 3;
-  res.compression_params = new uint8_t[3];
-  std::copy(params.data(), params.data() + 3, res.compression_params);
+  const auto layouts = getDCTPlaneLayouts(src);
+  const DCTSampleFormat format(src.fourcc_format);
   static constexpr const float* tables[3] = { lum_q_table, chroma_q_table, chroma_q_table };
-  DCTYUV dct;
-#ifdef MYYUV_USE_OPENMP
-  int omp_nested_prev = omp_get_nested();
-  std::exception_ptr omp_exception;
-  omp_set_nested(1);
-  #pragma omp parallel for
-#endif
+  const DCTQuantization quants[3] = { { static_cast<float>(params[0]), tables[0], format.bits }, { static_cast<float>(params[1]), tables[1], format.bits }, { static_cast<float>(params[2]), tables[2], format.bits } };
+  const myyuv::SimdLevel level = myyuv::getSimdLevel();
+  DCTEncodedPlanes res;
   for (uint8_t i = 0; i < 3; i++) {
-#ifdef MYYUV_USE_OPENMP
-    try {
-#endif
-    auto width_height = yuv.getWidthHeightChannel(i);
-    applyDCTPlane(dct.planes[i], planes[i], width_height[0], width_height[1], params[i], tables[i]);
-    dct.planes_sizes[i] = dct.planes[i].totalSize();
-#ifdef MYYUV_USE_OPENMP
-    } catch (...) {
-      #pragma omp critical
-      if (!omp_exception) {
-        omp_exception = std::current_exception();
-      }
+    auto width_height = src.getWidthHeightChannel(i);
+    checkDCTPlaneSize(width_height[0], width_height[1]);
+    res.widths[i] = width_height[0];
+    res.rows[i] = width_height[1] / 8;
+    res.chunks_sizes[i].reset(myyuv::allocateBuffer(res.blocksCount(i)));
+    res.rows_arenas[i].resize(res.rows[i]);
+    res.rows_data[i].resize(res.rows[i]);
+    res.rows_pos[i].resize(res.rows[i] + 1);
+  }
+  parallelForPlanesRows(res.rows, [&](uint8_t i, uint32_t rows_begin, uint32_t rows_end) {
+    if (format.bits > 8) {
+      applyDCTPlaneRows<uint16_t>(res, i, layouts[i], rows_begin, rows_end, quants[i], format, level);
+    } else {
+      applyDCTPlaneRows<uint8_t>(res, i, layouts[i], rows_begin, rows_end, quants[i], format, level);
     }
-#endif
+  });
+  for (uint8_t i = 0; i < 3; i++) {
+    DCTYUVPlane::rowsSizesToPos(res.rows_pos[i]);
+    assert(res.rows_pos[i].back() > 0);
   }
-#ifdef MYYUV_USE_OPENMP
-  omp_set_nested(omp_nested_prev);
-  if (omp_exception) {
-    std::rethrow_exception(omp_exception);
+  header = myyuv::YUVHeader();
+  header.fourcc_format = src.fourcc_format;
+  header.width = src.width;
+  header.height = src.height;
+  header.compression = static_cast<uint16_t>(myyuv::YUV::Compressions::DCT);
+  header.compression_params_size = 3;
+  header.compression_params_pos = sizeof(header);
+  header.data_pos = sizeof(header) + 3;
+  header.data_size = res.totalSize();
+  return res;
+}
+
+/**
+* Writes blocks count and content size of a plane, the same as `DCTYUVPlane::load` reads.
+*/
+static void writeDCTPlaneHeader(const DCTEncodedPlanes& encoded, uint8_t i, uint8_t* dst) noexcept {
+  const uint32_t sizes[2] = { encoded.blocksCount(i), encoded.rows_pos[i].back() };
+  std::copy(reinterpret_cast<const uint8_t*>(sizes), reinterpret_cast<const uint8_t*>(sizes) + sizeof(sizes), dst);
+}
+
+/**
+* Writes compressed planes straight into `dst` of `encoded.totalSize()` bytes, block rows are copied in parallel.
+* Sizes of planes go first, then every plane has its header, sizes of blocks and the content.
+* @see DCTYUV::load
+*/
+static void writeDCTPlanes(const DCTEncodedPlanes& encoded, uint8_t* dst) {
+  const uint32_t planes_sizes[3] = { encoded.planeSize(0), encoded.planeSize(1), encoded.planeSize(2) };
+  std::copy(reinterpret_cast<const uint8_t*>(planes_sizes), reinterpret_cast<const uint8_t*>(planes_sizes) + sizeof(planes_sizes), dst);
+  uint8_t* contents[3];
+  uint8_t* plane = dst + sizeof(planes_sizes);
+  for (uint8_t i = 0; i < 3; i++) {
+    writeDCTPlaneHeader(encoded, i, plane);
+    std::copy(encoded.chunks_sizes[i].get(), encoded.chunks_sizes[i].get() + encoded.blocksCount(i), plane + 2 * sizeof(uint32_t));
+    contents[i] = plane + 2 * sizeof(uint32_t) + encoded.blocksCount(i);
+    plane += planes_sizes[i];
   }
-#endif
-  res.header.data_size = dct.totalSize();
-  res.data = dct.dump();
+  assert(plane == dst + encoded.totalSize());
+  parallelForPlanesRows(encoded.rows, [&](uint8_t i, uint32_t rows_begin, uint32_t rows_end) {
+    const std::vector<uint32_t>& rows_pos = encoded.rows_pos[i];
+    for (uint32_t j = rows_begin; j < rows_end; j++) {
+      std::copy(encoded.rows_data[i][j], encoded.rows_data[i][j] + rows_pos[j + 1] - rows_pos[j], contents[i] + rows_pos[j]);
+    }
+  });
+}
+
+/**
+* Writes compressed planes to `out` in the same layout as `writeDCTPlanes`.
+*/
+static void writeDCTPlanes(const DCTEncodedPlanes& encoded, std::ostream& out) {
+  const uint32_t planes_sizes[3] = { encoded.planeSize(0), encoded.planeSize(1), encoded.planeSize(2) };
+  out.write(reinterpret_cast<const char*>(planes_sizes), sizeof(planes_sizes));
+  for (uint8_t i = 0; i < 3; i++) {
+    uint8_t plane_header[2 * sizeof(uint32_t)];
+    writeDCTPlaneHeader(encoded, i, plane_header);
+    out.write(reinterpret_cast<const char*>(plane_header), sizeof(plane_header));
+    out.write(reinterpret_cast<const char*>(encoded.chunks_sizes[i].get()), encoded.blocksCount(i));
+    // rows of one arena are contiguous, so they are written at once
+    const std::vector<uint32_t>& rows_pos = encoded.rows_pos[i];
+    uint32_t j = 0;
+    while (j < encoded.rows[i]) {
+      const uint8_t* data = encoded.rows_data[i][j];
+      uint32_t size = 0;
+      do {
+        size += rows_pos[j + 1] - rows_pos[j];
+        j++;
+      } while (j < encoded.rows[i] && encoded.rows_data[i][j] == data + size);
+      out.write(reinterpret_cast<const char*>(data), size);
+    }
+  }
+}
+
+/**
+* Restores all planes of `dct` into `dst` of samples of type `S`, block rows of every plane are restored in parallel.
+*/
+template <typename S>
+static void restoreDCTPlanes(const myyuv::YUVView& dst, const std::array<DCTPlaneLayout<uint8_t>, 3>& layouts, const DCTYUV& dct, const std::vector<uint32_t> (&rows_pos)[3],
+  const std::array<uint32_t, 3>& widths, const std::array<uint32_t, 3>& rows, const DCTQuantization (&quants)[3], const DCTSampleFormat& format, myyuv::SimdLevel level) {
+  if (layouts[0].samples == DCTSamples::PACKED_422) {
+    if constexpr (!std::is_same<S, uint8_t>::value) {
+      throw std::runtime_error("Error decompressing: packed YUV must have 8-bit samples");
+    }
+    // All planes are restored by tasks of plane 0, so chroma planes have no rows of their own
+    std::array<const DCTYUVPlane*, 3> packed_dct;
+    std::array<const uint32_t*, 3> packed_rows_pos;
+    std::array<const DCTQuantization*, 3> packed_quants;
+    for (uint8_t c = 0; c < 3; c++) {
+      packed_dct[layouts[c].index] = &dct.planes[c];
+      packed_rows_pos[layouts[c].index] = rows_pos[c].data();
+      packed_quants[layouts[c].index] = &quants[c];
+    }
+    parallelForPlanesRows({ rows[0], 0, 0 }, [&](uint8_t, uint32_t rows_begin, uint32_t rows_end) {
+      if constexpr (std::is_same<S, uint8_t>::value) {
+        restoreDCTRowsPacked(layouts[0].data, packed_dct, packed_rows_pos, widths[0], layouts[0].stride, layouts[0].chroma_first, rows_begin, rows_end, packed_quants, format, level);
+      }
+    });
+    return;
+  }
+  if (layouts[1].samples != DCTSamples::PAIRS) {
+    parallelForPlanesRows(rows, [&](uint8_t i, uint32_t rows_begin, uint32_t rows_end) {
+      restoreDCTRows(reinterpret_cast<S*>(dst.planes[i]), dct.planes[i], rows_pos[i].data(), widths[i], dst.strides[i] / sizeof(S), rows_begin, rows_end, quants[i], format, level);
+    });
+    return;
+  }
+  // Both chroma planes are restored by tasks of plane 1, so plane 2 has no rows of its own
+  const uint8_t offsets[2] = { layouts[1].index, layouts[2].index };
+  std::array<const DCTYUVPlane*, 2> pair_dct;
+  std::array<const uint32_t*, 2> pair_rows_pos;
+  std::array<const DCTQuantization*, 2> pair_quants;
+  for (uint8_t c = 0; c < 2; c++) {
+    pair_dct[offsets[c]] = &dct.planes[c + 1];
+    pair_rows_pos[offsets[c]] = rows_pos[c + 1].data();
+    pair_quants[offsets[c]] = &quants[c + 1];
+  }
+  parallelForPlanesRows({ rows[0], rows[1], 0 }, [&](uint8_t i, uint32_t rows_begin, uint32_t rows_end) {
+    if (i == 0) {
+      restoreDCTRows(reinterpret_cast<S*>(dst.planes[0]), dct.planes[0], rows_pos[0].data(), widths[0], dst.strides[0] / sizeof(S), rows_begin, rows_end, quants[0], format, level);
+    } else {
+      restoreDCTRowsInterleaved(reinterpret_cast<S*>(layouts[1].data), pair_dct, pair_rows_pos, widths[1], layouts[1].stride / sizeof(S), rows_begin, rows_end, pair_quants, format, level);
+    }
+  });
+}
+
+} // namespace
+
+namespace myyuvDCT {
+
+myyuv::YUV compress_DCT_planar(const myyuv::ConstYUVView& src, const std::array<uint8_t, 3>& params) {
+  myyuv::YUV res;
+  const DCTEncodedPlanes encoded = encodeDCTPlanes(src, params, res.header);
+  res.compression_params = new uint8_t[3];
+  std::copy(params.data(), params.data() + 3, res.compression_params);
+  res.data = myyuv::allocateBuffer(res.header.data_size);
+  writeDCTPlanes(encoded, res.data);
   return res;
 }
 
+void compress_DCT_planar(const myyuv::ConstYUVView& src, const std::array<uint8_t, 3>& params, std::ostream& out) {
+  myyuv::YUVHeader header;
+  const DCTEncodedPlanes encoded = encodeDCTPlanes(src, params, header);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(params.data()), 3);
+  writeDCTPlanes(encoded, out);
+  if (!out) {
+    throw std::runtime_error("Error compressing: can't write compressed image");
+  }
+}
+
 myyuv::YUV decompress_DCT_planar(const myyuv::YUV& yuv, const std::array<uint8_t, 3>& params) {
-  if (yuv.getFormatGroup() != myyuv::YUV::FormatGroup::PLANAR) {
-    throw std::runtime_error("Error decompressing: YUV must be planar");
+  if (yuv.getFormatGroup() != myyuv::YUV::FormatGroup::PLANAR && yuv.getFormatGroup() != myyuv::YUV::FormatGroup::SEMI_PLANAR && yuv.getFormatGroup() != myyuv::YUV::FormatGroup::PACKED) {
+    throw std::runtime_error("Error decompressing: YUV must be planar, semi-planar or packed");
+  }
+  myyuv::YUV res;
+  res.header = yuv.header;
+  res.header.compression = static_cast<uint16_t>(myyuv::YUV::Compressions::NONE);
+  res.header.compression_params_size = 0;
+  res.header.compression_params_pos = 0;
+  res.header.data_pos = sizeof(yuv.header);
+  res.compression_params = nullptr;
+  res.header.data_size = yuv.getImageSize();
+  res.data = myyuv::allocateBuffer(res.header.data_size);
+  decompress_DCT_planar(yuv, params, res.view());
+  return res;
+}
+
+void decompress_DCT_planar(const myyuv::YUV& yuv, const std::array<uint8_t, 3>& params, const myyuv::YUVView& dst) {
+  if (yuv.getFormatGroup() != myyuv::YUV::FormatGroup::PLANAR && yuv.getFormatGroup() != myyuv::YUV::FormatGroup::SEMI_PLANAR && yuv.getFormatGroup() != myyuv::YUV::FormatGroup::PACKED) {
+    throw std::runtime_error("Error decompressing: YUV must be planar, semi-planar or packed");
+  }
+  if (!dst.isValid() || dst.fourcc_format != yuv.getFourccFormat() || dst.width != yuv.getWidth() || dst.height != yuv.getHeight()) {
+    throw std::runtime_error("Error decompressing: YUV view does not match the image");
   }
   assert(yuv.header.compression_params_size == 3);
   assert(yuv.compression_params);
@@ -443,48 +1008,91 @@ myyuv::YUV decompress_DCT_planar(const myyuv::YUV& yuv, const std::array<uint8_t
   auto fractions = yuv.getResolutionFraction();
   assert(yuv.header.width % (8 * fractions[0]) == 0);
   assert(yuv.header.height % (8 * fractions[1]) == 0);
-  myyuv::YUV res;
-  res.header = yuv.header;
-  res.header.compression = static_cast<uint16_t>(myyuv::YUV::Compressions::NONE);
-  res.header.compression_params_size = 0;
-  res.header.compression_params_pos = 0;
-  res.header.data_pos = sizeof(yuv.header);
-  res.compression_params = nullptr;
-  res.header.data_size = yuv.getImageSize();
   DCTYUV dct = DCTYUV::load(yuv.data, yuv.header.data_size);
-  res.data = new uint8_t[res.header.data_size];
-  auto planes = res.getYUVPlanes();
+  [[maybe_unused]] const auto& planes = dst.planes;
   assert(myyuv::YUV::max_planes == 3 || myyuv::YUV::max_planes > 3 && planes[3] == nullptr); // Transparency is not supported
   assert(planes[0] != nullptr && planes[1] != nullptr && planes[2] != nullptr); // not ready to handle when one plane is missing
+  const auto layouts = getDCTPlaneLayouts(dst);
+  const DCTSampleFormat format(dst.fourcc_format);
   static constexpr const float* tables[3] = { lum_q_table, chroma_q_table, chroma_q_table };
-#ifdef MYYUV_USE_OPENMP
-  int omp_nested_prev = omp_get_nested();
-  std::exception_ptr omp_exception;
-  omp_set_nested(1);
-  #pragma omp parallel for
-#endif
+  const DCTQuantization quants[3] = { { static_cast<float>(params[0]), tables[0], format.bits }, { static_cast<float>(params[1]), tables[1], format.bits }, { static_cast<float>(params[2]), tables[2], format.bits } };
+  const myyuv::SimdLevel level = myyuv::getSimdLevel();
+  std::array<uint32_t, 3> widths;
+  std::array<uint32_t, 3> rows;
+  std::vector<uint32_t> rows_pos[3];
   for (uint8_t i = 0; i < 3; i++) {
-#ifdef MYYUV_USE_OPENMP
-    try {
-#endif
     auto width_height = yuv.getWidthHeightChannel(i);
-    restoreDCTPlane(planes[i], dct.planes[i], width_height[0], width_height[1], params[i], tables[i]);
-#ifdef MYYUV_USE_OPENMP
-    } catch (...) {
-      #pragma omp critical
-      if (!omp_exception) {
-        omp_exception = std::current_exception();
-      }
+    checkDCTPlaneSize(width_height[0], width_height[1]);
+    if (dct.planes[i].chunks_sizes_size != width_height[0] * width_height[1] / 64) {
+      throw std::runtime_error("Error decompressing: blocks count does not match the image size");
+    }
+    widths[i] = width_height[0];
+    rows[i] = width_height[1] / 8;
+    rows_pos[i].resize(rows[i] + 1);
+  }
+  // Offsets of block rows let every task start at its own rows
+  parallelForPlanesRows(rows, [&](uint8_t i, uint32_t rows_begin, uint32_t rows_end) {
+    dct.planes[i].getRowsSizes(widths[i] / 8, rows_begin, rows_end, rows_pos[i].data());
+  });
+  for (uint8_t i = 0; i < 3; i++) {
+    DCTYUVPlane::rowsSizesToPos(rows_pos[i]);
+    if (rows_pos[i].back() > dct.planes[i].content_size) {
+      throw std::runtime_error("Error decompressing: blocks sizes exceed the content size");
     }
-#endif
   }
-#ifdef MYYUV_USE_OPENMP
-  omp_set_nested(omp_nested_prev);
-  if (omp_exception) {
-    std::rethrow_exception(omp_exception);
+  if (format.bits > 8) {
+    restoreDCTPlanes<uint16_t>(dst, layouts, dct, rows_pos, widths, rows, quants, format, level);
+  } else {
+    restoreDCTPlanes<uint8_t>(dst, layouts, dct, rows_pos, widths, rows, quants, format, level);
   }
-#endif
+}
+
+uint32_t huffman_decode_DCT_planar(const myyuv::YUV& yuv, bool reference) {
+  if (yuv.getFormatGroup() != myyuv::YUV::FormatGroup::PLANAR && yuv.getFormatGroup() != myyuv::YUV::FormatGroup::SEMI_PLANAR && yuv.getFormatGroup() != myyuv::YUV::FormatGroup::PACKED) {
+    throw std::runtime_error("Error decoding: YUV must be planar, semi-planar or packed");
+  }
+  if (yuv.getCompression() != myyuv::YUV::Compressions::DCT) {
+    throw std::runtime_error("Error decoding: YUV must be compressed with DCT");
+  }
+  const DCTYUV dct = DCTYUV::load(yuv.data, yuv.header.data_size);
+  const uint8_t symbol_bits = DCTSampleFormat(yuv.getFourccFormat()).symbol_bits;
+  uint32_t blocks = 0;
+  for (uint32_t i = 0; i < 3; i++) {
+    if (dct.planes_sizes[i] == 0) {
+      continue;
+    }
+    const DCTYUVPlane& plane = dct.planes[i];
+    const uint8_t* content = plane.content;
+    for (uint32_t k = 0; k < plane.chunks_sizes_size; k++) {
+      const uint8_t* huffman_data = content;
+      content += plane.chunks_sizes[k];
+      [[maybe_unused]] const myyuvDCT::Huffman huffman = reference ? myyuvDCT::Huffman::fromDumpReference(huffman_data, plane.chunks_sizes[k], symbol_bits) : myyuvDCT::Huffman::fromDump(huffman_data, plane.chunks_sizes[k], symbol_bits);
+      blocks++;
+    }
+  }
+  return blocks;
+}
+
+IDCTPathCounters get_idct_path_counters() noexcept {
+  IDCTPathCounters res;
+  res.dc_only = idct_dc_only_blocks;
+  res.sparse = idct_sparse_blocks;
+  res.full = idct_full_blocks;
   return res;
 }
 
+uint64_t get_flat_blocks_counter() noexcept {
+  return dct_flat_blocks;
+}
+
+void reset_flat_blocks_counter() noexcept {
+  dct_flat_blocks = 0;
+}
+
+void reset_idct_path_counters() noexcept {
+  idct_dc_only_blocks = 0;
+  idct_sparse_blocks = 0;
+  idct_full_blocks = 0;
+}
+
 } // myyuvDCT
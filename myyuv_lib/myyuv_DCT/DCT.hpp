@@ -2,21 +2,32 @@
 
 #include <array>
 #include <cstdint>
+#include <ostream>
 #include "myyuv_yuv.hpp"
 
 namespace myyuvDCT {
 
 /**
-* @brief DCT compression for YUV in planar format.
+* @brief DCT compression for YUV in planar, semi-planar or packed format.
+* @details Interleaved chroma of semi-planar formats and macropixels of packed formats are compressed as three separate planes, the compressed layout is the same as for planar formats.
 * @note The higher quality is, the less effective compression will be, but more details will be preserved.
-* @param yuv YUV image to compress
+* @param src View of YUV image to compress, rows of planes may be padded.
 * @param params Parameters for DCT compression: the quality that ranges from 1 to 100.
 * @return New compressed image.
 */
-myyuv::YUV compress_DCT_planar(const myyuv::YUV& yuv, const std::array<uint8_t, 3>& params);
+myyuv::YUV compress_DCT_planar(const myyuv::ConstYUVView& src, const std::array<uint8_t, 3>& params);
 
 /**
-* @brief DCT decompression for YUV in planar format.
+* @brief DCT compression for YUV in planar, semi-planar or packed format that writes the compressed image file straight to a stream.
+* @note Compressed planes are not gathered into a buffer, so peak memory is about the input and the compressed output.
+* @param src View of YUV image to compress, rows of planes may be padded.
+* @param params Parameters for DCT compression: the quality that ranges from 1 to 100.
+* @param out Stream to write the compressed image file to, the same as `myyuv::YUV::dump` writes.
+*/
+void compress_DCT_planar(const myyuv::ConstYUVView& src, const std::array<uint8_t, 3>& params, std::ostream& out);
+
+/**
+* @brief DCT decompression for YUV in planar, semi-planar or packed format.
 * @warning The parameters should be exactly the same as used in compression. The function does not check if parameters match with `compression_params`
 * @param yuv YUV image to decompress.
 * @param params Parameters for DCT compression: the quality that ranges from 1 to 100.
@@ -24,4 +35,55 @@ myyuv::YUV compress_DCT_planar(const myyuv::YUV& yuv, const std::array<uint8_t,
 */
 myyuv::YUV decompress_DCT_planar(const myyuv::YUV& yuv, const std::array<uint8_t, 3>& params);
 
+/**
+* @brief DCT decompression for YUV in planar, semi-planar or packed format into planes of a view.
+* @warning The parameters should be exactly the same as used in compression. The function does not check if parameters match with `compression_params`
+* @param yuv YUV image to decompress.
+* @param params Parameters for DCT compression: the quality that ranges from 1 to 100.
+* @param dst View with the same format, width and height as the image, rows of planes may be padded.
+*/
+void decompress_DCT_planar(const myyuv::YUV& yuv, const std::array<uint8_t, 3>& params, const myyuv::YUVView& dst);
+
+/**
+* @brief Huffman decodes every 8x8 block of DCT compressed YUV in planar, semi-planar or packed format without restoring the image.
+* @note Useful in benchmarks.
+* @param yuv DCT compressed YUV image.
+* @param reference Use the reference bit by bit decoder instead of the table driven one.
+* @return Amount of decoded blocks.
+*/
+uint32_t huffman_decode_DCT_planar(const myyuv::YUV& yuv, bool reference);
+
+/**
+* @brief Amounts of blocks restored by each inverse DCT path.
+*/
+struct IDCTPathCounters {
+  uint64_t dc_only = 0; /// Blocks with only DC coefficient, filled with one value.
+  uint64_t sparse = 0; /// Blocks with all nonzero coefficients in the top-left 4x4, restored with reduced inverse DCT.
+  uint64_t full = 0; /// Blocks restored with full inverse DCT.
+};
+
+/**
+* @brief Get amounts of blocks restored by each inverse DCT path in `decompress_DCT_planar` since the last reset.
+* @note Counters are shared by all threads and are updated once per plane.
+* @return Counters.
+*/
+IDCTPathCounters get_idct_path_counters() noexcept;
+
+/**
+* @brief Resets counters of `get_idct_path_counters`.
+*/
+void reset_idct_path_counters() noexcept;
+
+/**
+* @brief Get amount of flat blocks that `compress_DCT_planar` encoded with only DC coefficient, without forward DCT and Huffman tree, since the last reset.
+* @note The counter is shared by all threads and is updated once per plane.
+* @return Amount of flat blocks.
+*/
+uint64_t get_flat_blocks_counter() noexcept;
+
+/**
+* @brief Resets counter of `get_flat_blocks_counter`.
+*/
+void reset_flat_blocks_counter() noexcept;
+
 } // myyuvDCT
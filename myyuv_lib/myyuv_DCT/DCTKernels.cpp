@@ -0,0 +1,917 @@
+#include "DCTKernels.hpp"
+
+#include "myyuv_simd.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <type_traits>
+
+namespace {
+
+// AAN fast DCT, see libjpeg jfdctflt.c and jidctflt.c.
+// Both directions take 5 multiplications and 29 additions per 8 samples.
+
+static inline void fdct8(float* d, uint32_t stride) noexcept {
+  const float tmp0 = d[0 * stride] + d[7 * stride];
+  const float tmp7 = d[0 * stride] - d[7 * stride];
+  const float tmp1 = d[1 * stride] + d[6 * stride];
+  const float tmp6 = d[1 * stride] - d[6 * stride];
+  const float tmp2 = d[2 * stride] + d[5 * stride];
+  const float tmp5 = d[2 * stride] - d[5 * stride];
+  const float tmp3 = d[3 * stride] + d[4 * stride];
+  const float tmp4 = d[3 * stride] - d[4 * stride];
+  // even part
+  const float tmp10 = tmp0 + tmp3;
+  const float tmp13 = tmp0 - tmp3;
+  const float tmp11 = tmp1 + tmp2;
+  const float tmp12 = tmp1 - tmp2;
+  d[0 * stride] = tmp10 + tmp11;
+  d[4 * stride] = tmp10 - tmp11;
+  const float z1 = (tmp12 + tmp13) * 0.707106781f;
+  d[2 * stride] = tmp13 + z1;
+  d[6 * stride] = tmp13 - z1;
+  // odd part
+  const float o10 = tmp4 + tmp5;
+  const float o11 = tmp5 + tmp6;
+  const float o12 = tmp6 + tmp7;
+  const float z5 = (o10 - o12) * 0.382683433f;
+  const float z2 = 0.541196100f * o10 + z5;
+  const float z4 = 1.306562965f * o12 + z5;
+  const float z3 = o11 * 0.707106781f;
+  const float z11 = tmp7 + z3;
+  const float z13 = tmp7 - z3;
+  d[5 * stride] = z13 + z2;
+  d[3 * stride] = z13 - z2;
+  d[1 * stride] = z11 + z4;
+  d[7 * stride] = z11 - z4;
+}
+
+static inline void idct8(float* d, uint32_t stride) noexcept {
+  // even part
+  const float tmp10 = d[0 * stride] + d[4 * stride];
+  const float tmp11 = d[0 * stride] - d[4 * stride];
+  const float tmp13 = d[2 * stride] + d[6 * stride];
+  const float tmp12 = (d[2 * stride] - d[6 * stride]) * 1.414213562f - tmp13;
+  const float e0 = tmp10 + tmp13;
+  const float e3 = tmp10 - tmp13;
+  const float e1 = tmp11 + tmp12;
+  const float e2 = tmp11 - tmp12;
+  // odd part
+  const float z13 = d[5 * stride] + d[3 * stride];
+  const float z10 = d[5 * stride] - d[3 * stride];
+  const float z11 = d[1 * stride] + d[7 * stride];
+  const float z12 = d[1 * stride] - d[7 * stride];
+  const float o7 = z11 + z13;
+  const float o11 = (z11 - z13) * 1.414213562f;
+  const float z5 = (z10 + z12) * 1.847759065f;
+  const float o10 = 1.082392200f * z12 - z5;
+  const float o12 = -2.613125930f * z10 + z5;
+  const float o6 = o12 - o7;
+  const float o5 = o11 - o6;
+  const float o4 = o10 + o5;
+  d[0 * stride] = e0 + o7;
+  d[7 * stride] = e0 - o7;
+  d[1 * stride] = e1 + o6;
+  d[6 * stride] = e1 - o6;
+  d[2 * stride] = e2 + o5;
+  d[5 * stride] = e2 - o5;
+  d[4 * stride] = e3 + o4;
+  d[3 * stride] = e3 - o4;
+}
+
+// `idct8` for the case when inputs 4..7 are zero, the results are the same.
+static inline void idct8_4(float* d, uint32_t stride) noexcept {
+  // even part
+  const float tmp13 = d[2 * stride];
+  const float tmp12 = d[2 * stride] * 1.414213562f - tmp13;
+  const float e0 = d[0 * stride] + tmp13;
+  const float e3 = d[0 * stride] - tmp13;
+  const float e1 = d[0 * stride] + tmp12;
+  const float e2 = d[0 * stride] - tmp12;
+  // odd part
+  const float z13 = d[3 * stride];
+  const float z10 = -d[3 * stride];
+  const float z11 = d[1 * stride];
+  const float z12 = d[1 * stride];
+  const float o7 = z11 + z13;
+  const float o11 = (z11 - z13) * 1.414213562f;
+  const float z5 = (z10 + z12) * 1.847759065f;
+  const float o10 = 1.082392200f * z12 - z5;
+  const float o12 = -2.613125930f * z10 + z5;
+  const float o6 = o12 - o7;
+  const float o5 = o11 - o6;
+  const float o4 = o10 + o5;
+  d[0 * stride] = e0 + o7;
+  d[7 * stride] = e0 - o7;
+  d[1 * stride] = e1 + o6;
+  d[6 * stride] = e1 - o6;
+  d[2 * stride] = e2 + o5;
+  d[5 * stride] = e2 - o5;
+  d[4 * stride] = e3 + o4;
+  d[3 * stride] = e3 - o4;
+}
+
+// Scalar kernels are the reference for both 8-bit and high bit depth samples:
+// a sample is `bits` bits after shifting it right by `shift`, 8-bit samples are never shifted.
+
+template <typename T>
+static void fdct_quantize_scalar(const T* src, uint32_t stride, uint32_t bits, uint32_t shift, const float fdct_scale[64], int16_t res[64]) noexcept {
+  const float bias = static_cast<float>(1u << (bits - 1));
+  float block[64];
+  for (uint32_t jj = 0; jj < 8; jj++) {
+    for (uint32_t ii = 0; ii < 8; ii++) {
+      block[ii + jj * 8] = static_cast<float>(src[ii + jj * stride] >> shift) - bias;
+    }
+  }
+  for (uint32_t i = 0; i < 8; i++) {
+    fdct8(block + i * 8, 1);
+  }
+  for (uint32_t i = 0; i < 8; i++) {
+    fdct8(block + i, 8);
+  }
+  for (uint32_t i = 0; i < 64; i++) {
+    res[i] = static_cast<int16_t>(std::round(block[i] * fdct_scale[i]));
+  }
+}
+
+template <typename T>
+static bool flat_dc_scalar(const T* src, uint32_t stride, uint32_t bits, uint32_t shift, uint8_t max_range, float dc_scale, int16_t& dc) noexcept {
+  uint32_t min = src[0] >> shift;
+  uint32_t max = min;
+  int32_t sum = 0;
+  for (uint32_t jj = 0; jj < 8; jj++) {
+    for (uint32_t ii = 0; ii < 8; ii++) {
+      const uint32_t sample = src[ii + jj * stride] >> shift;
+      min = std::min(min, sample);
+      max = std::max(max, sample);
+      sum += sample;
+    }
+  }
+  if (max - min > max_range) {
+    return false;
+  }
+  // DC of the forward DCT is the exact sum of level shifted samples
+  dc = static_cast<int16_t>(std::round(static_cast<float>(sum - 64 * (1 << (bits - 1))) * dc_scale));
+  return true;
+}
+
+template <typename T>
+static void store_scalar(const float block[64], T* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept {
+  const int bias = 1 << (bits - 1);
+  const int max = (1 << bits) - 1;
+  for (uint32_t jj = 0; jj < 8; jj++) {
+    for (uint32_t ii = 0; ii < 8; ii++) {
+      dst[ii + jj * stride] = static_cast<T>(std::clamp(static_cast<int>(std::round(block[ii + jj * 8])) + bias, 0, max) << shift);
+    }
+  }
+}
+
+template <typename T>
+static void idct_store_scalar(const float coeffs[64], T* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept {
+  float block[64];
+  std::copy(coeffs, coeffs + 64, block);
+  for (uint32_t i = 0; i < 8; i++) {
+    idct8(block + i, 8);
+  }
+  for (uint32_t i = 0; i < 8; i++) {
+    idct8(block + i * 8, 1);
+  }
+  store_scalar(block, dst, stride, bits, shift);
+}
+
+template <typename T>
+static void idct_store_4x4_scalar(const float coeffs[64], T* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept {
+  float block[64];
+  std::copy(coeffs, coeffs + 64, block);
+  // columns 4..7 are zero and stay zero
+  for (uint32_t i = 0; i < 4; i++) {
+    idct8_4(block + i, 8);
+  }
+  for (uint32_t i = 0; i < 8; i++) {
+    idct8_4(block + i * 8, 1);
+  }
+  store_scalar(block, dst, stride, bits, shift);
+}
+
+#ifdef MYYUV_X86
+
+// SSE2: a row of the block is 2 vectors (columns 0..3 and 4..7), so each 1D pass runs twice.
+// Quantization and rounding use packed conversion (round half to even), which differs from
+// `std::round` only on exact halves.
+
+MYYUV_TARGET("sse2")
+static inline void fdct8_sse2(__m128 d[8]) noexcept {
+  const __m128 tmp0 = _mm_add_ps(d[0], d[7]);
+  const __m128 tmp7 = _mm_sub_ps(d[0], d[7]);
+  const __m128 tmp1 = _mm_add_ps(d[1], d[6]);
+  const __m128 tmp6 = _mm_sub_ps(d[1], d[6]);
+  const __m128 tmp2 = _mm_add_ps(d[2], d[5]);
+  const __m128 tmp5 = _mm_sub_ps(d[2], d[5]);
+  const __m128 tmp3 = _mm_add_ps(d[3], d[4]);
+  const __m128 tmp4 = _mm_sub_ps(d[3], d[4]);
+  const __m128 tmp10 = _mm_add_ps(tmp0, tmp3);
+  const __m128 tmp13 = _mm_sub_ps(tmp0, tmp3);
+  const __m128 tmp11 = _mm_add_ps(tmp1, tmp2);
+  const __m128 tmp12 = _mm_sub_ps(tmp1, tmp2);
+  d[0] = _mm_add_ps(tmp10, tmp11);
+  d[4] = _mm_sub_ps(tmp10, tmp11);
+  const __m128 z1 = _mm_mul_ps(_mm_add_ps(tmp12, tmp13), _mm_set1_ps(0.707106781f));
+  d[2] = _mm_add_ps(tmp13, z1);
+  d[6] = _mm_sub_ps(tmp13, z1);
+  const __m128 o10 = _mm_add_ps(tmp4, tmp5);
+  const __m128 o11 = _mm_add_ps(tmp5, tmp6);
+  const __m128 o12 = _mm_add_ps(tmp6, tmp7);
+  const __m128 z5 = _mm_mul_ps(_mm_sub_ps(o10, o12), _mm_set1_ps(0.382683433f));
+  const __m128 z2 = _mm_add_ps(_mm_mul_ps(o10, _mm_set1_ps(0.541196100f)), z5);
+  const __m128 z4 = _mm_add_ps(_mm_mul_ps(o12, _mm_set1_ps(1.306562965f)), z5);
+  const __m128 z3 = _mm_mul_ps(o11, _mm_set1_ps(0.707106781f));
+  const __m128 z11 = _mm_add_ps(tmp7, z3);
+  const __m128 z13 = _mm_sub_ps(tmp7, z3);
+  d[5] = _mm_add_ps(z13, z2);
+  d[3] = _mm_sub_ps(z13, z2);
+  d[1] = _mm_add_ps(z11, z4);
+  d[7] = _mm_sub_ps(z11, z4);
+}
+
+MYYUV_TARGET("sse2")
+static inline void idct8_sse2(__m128 d[8]) noexcept {
+  const __m128 tmp10 = _mm_add_ps(d[0], d[4]);
+  const __m128 tmp11 = _mm_sub_ps(d[0], d[4]);
+  const __m128 tmp13 = _mm_add_ps(d[2], d[6]);
+  const __m128 tmp12 = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(d[2], d[6]), _mm_set1_ps(1.414213562f)), tmp13);
+  const __m128 e0 = _mm_add_ps(tmp10, tmp13);
+  const __m128 e3 = _mm_sub_ps(tmp10, tmp13);
+  const __m128 e1 = _mm_add_ps(tmp11, tmp12);
+  const __m128 e2 = _mm_sub_ps(tmp11, tmp12);
+  const __m128 z13 = _mm_add_ps(d[5], d[3]);
+  const __m128 z10 = _mm_sub_ps(d[5], d[3]);
+  const __m128 z11 = _mm_add_ps(d[1], d[7]);
+  const __m128 z12 = _mm_sub_ps(d[1], d[7]);
+  const __m128 o7 = _mm_add_ps(z11, z13);
+  const __m128 o11 = _mm_mul_ps(_mm_sub_ps(z11, z13), _mm_set1_ps(1.414213562f));
+  const __m128 z5 = _mm_mul_ps(_mm_add_ps(z10, z12), _mm_set1_ps(1.847759065f));
+  const __m128 o10 = _mm_sub_ps(_mm_mul_ps(z12, _mm_set1_ps(1.082392200f)), z5);
+  const __m128 o12 = _mm_add_ps(_mm_mul_ps(z10, _mm_set1_ps(-2.613125930f)), z5);
+  const __m128 o6 = _mm_sub_ps(o12, o7);
+  const __m128 o5 = _mm_sub_ps(o11, o6);
+  const __m128 o4 = _mm_add_ps(o10, o5);
+  d[0] = _mm_add_ps(e0, o7);
+  d[7] = _mm_sub_ps(e0, o7);
+  d[1] = _mm_add_ps(e1, o6);
+  d[6] = _mm_sub_ps(e1, o6);
+  d[2] = _mm_add_ps(e2, o5);
+  d[5] = _mm_sub_ps(e2, o5);
+  d[4] = _mm_add_ps(e3, o4);
+  d[3] = _mm_sub_ps(e3, o4);
+}
+
+MYYUV_TARGET("sse2")
+static inline void idct8_4_sse2(__m128 d[8]) noexcept {
+  const __m128 tmp13 = d[2];
+  const __m128 tmp12 = _mm_sub_ps(_mm_mul_ps(d[2], _mm_set1_ps(1.414213562f)), tmp13);
+  const __m128 e0 = _mm_add_ps(d[0], tmp13);
+  const __m128 e3 = _mm_sub_ps(d[0], tmp13);
+  const __m128 e1 = _mm_add_ps(d[0], tmp12);
+  const __m128 e2 = _mm_sub_ps(d[0], tmp12);
+  const __m128 z13 = d[3];
+  const __m128 z10 = _mm_sub_ps(_mm_setzero_ps(), d[3]);
+  const __m128 z11 = d[1];
+  const __m128 z12 = d[1];
+  const __m128 o7 = _mm_add_ps(z11, z13);
+  const __m128 o11 = _mm_mul_ps(_mm_sub_ps(z11, z13), _mm_set1_ps(1.414213562f));
+  const __m128 z5 = _mm_mul_ps(_mm_add_ps(z10, z12), _mm_set1_ps(1.847759065f));
+  const __m128 o10 = _mm_sub_ps(_mm_mul_ps(z12, _mm_set1_ps(1.082392200f)), z5);
+  const __m128 o12 = _mm_add_ps(_mm_mul_ps(z10, _mm_set1_ps(-2.613125930f)), z5);
+  const __m128 o6 = _mm_sub_ps(o12, o7);
+  const __m128 o5 = _mm_sub_ps(o11, o6);
+  const __m128 o4 = _mm_add_ps(o10, o5);
+  d[0] = _mm_add_ps(e0, o7);
+  d[7] = _mm_sub_ps(e0, o7);
+  d[1] = _mm_add_ps(e1, o6);
+  d[6] = _mm_sub_ps(e1, o6);
+  d[2] = _mm_add_ps(e2, o5);
+  d[5] = _mm_sub_ps(e2, o5);
+  d[4] = _mm_add_ps(e3, o4);
+  d[3] = _mm_sub_ps(e3, o4);
+}
+
+// Transposes 8x8 block made of 4x4 quarters
+MYYUV_TARGET("sse2")
+static inline void transpose8_sse2(__m128 lo[8], __m128 hi[8]) noexcept {
+  _MM_TRANSPOSE4_PS(lo[0], lo[1], lo[2], lo[3]);
+  _MM_TRANSPOSE4_PS(hi[0], hi[1], hi[2], hi[3]);
+  _MM_TRANSPOSE4_PS(lo[4], lo[5], lo[6], lo[7]);
+  _MM_TRANSPOSE4_PS(hi[4], hi[5], hi[6], hi[7]);
+  for (uint32_t i = 0; i < 4; i++) {
+    std::swap(hi[i], lo[i + 4]);
+  }
+}
+
+// Forward DCT and quantization of level shifted block
+MYYUV_TARGET("sse2")
+static inline void fdct_quantize_block_sse2(__m128 lo[8], __m128 hi[8], const float fdct_scale[64], int16_t res[64]) noexcept {
+  fdct8_sse2(lo);
+  fdct8_sse2(hi);
+  transpose8_sse2(lo, hi);
+  fdct8_sse2(lo);
+  fdct8_sse2(hi);
+  transpose8_sse2(lo, hi);
+  for (uint32_t j = 0; j < 8; j++) {
+    const __m128i a = _mm_cvtps_epi32(_mm_mul_ps(lo[j], _mm_loadu_ps(fdct_scale + j * 8)));
+    const __m128i b = _mm_cvtps_epi32(_mm_mul_ps(hi[j], _mm_loadu_ps(fdct_scale + j * 8 + 4)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(res + j * 8), _mm_packs_epi32(a, b));
+  }
+}
+
+MYYUV_TARGET("sse2")
+static void fdct_quantize_sse2(const uint8_t* src, uint32_t stride, const float fdct_scale[64], int16_t res[64]) noexcept {
+  __m128 lo[8], hi[8];
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 bias = _mm_set1_ps(128.0f);
+  for (uint32_t j = 0; j < 8; j++) {
+    const __m128i row = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + j * stride)), zero);
+    lo[j] = _mm_sub_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(row, zero)), bias);
+    hi[j] = _mm_sub_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(row, zero)), bias);
+  }
+  fdct_quantize_block_sse2(lo, hi, fdct_scale, res);
+}
+
+MYYUV_TARGET("sse2")
+static void fdct_quantize_sse2(const uint16_t* src, uint32_t stride, uint32_t bits, uint32_t shift, const float fdct_scale[64], int16_t res[64]) noexcept {
+  __m128 lo[8], hi[8];
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i count = _mm_cvtsi32_si128(static_cast<int>(shift));
+  const __m128 bias = _mm_set1_ps(static_cast<float>(1u << (bits - 1)));
+  for (uint32_t j = 0; j < 8; j++) {
+    const __m128i row = _mm_srl_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + j * stride)), count);
+    lo[j] = _mm_sub_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(row, zero)), bias);
+    hi[j] = _mm_sub_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(row, zero)), bias);
+  }
+  fdct_quantize_block_sse2(lo, hi, fdct_scale, res);
+}
+
+MYYUV_TARGET("sse2")
+static bool flat_dc_sse2(const uint8_t* src, uint32_t stride, uint8_t max_range, float dc_scale, int16_t& dc) noexcept {
+  __m128i rows[4];
+  for (uint32_t j = 0; j < 4; j++) {
+    const __m128i a = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + 2 * j * stride));
+    const __m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + (2 * j + 1) * stride));
+    rows[j] = _mm_unpacklo_epi64(a, b);
+  }
+  __m128i min = _mm_min_epu8(_mm_min_epu8(rows[0], rows[1]), _mm_min_epu8(rows[2], rows[3]));
+  __m128i max = _mm_max_epu8(_mm_max_epu8(rows[0], rows[1]), _mm_max_epu8(rows[2], rows[3]));
+  // horizontal min and max into the lowest byte
+  min = _mm_min_epu8(min, _mm_srli_si128(min, 8));
+  max = _mm_max_epu8(max, _mm_srli_si128(max, 8));
+  min = _mm_min_epu8(min, _mm_srli_si128(min, 4));
+  max = _mm_max_epu8(max, _mm_srli_si128(max, 4));
+  min = _mm_min_epu8(min, _mm_srli_si128(min, 2));
+  max = _mm_max_epu8(max, _mm_srli_si128(max, 2));
+  min = _mm_min_epu8(min, _mm_srli_si128(min, 1));
+  max = _mm_max_epu8(max, _mm_srli_si128(max, 1));
+  const int range = (_mm_cvtsi128_si32(max) & 0xFF) - (_mm_cvtsi128_si32(min) & 0xFF);
+  if (range > max_range) {
+    return false;
+  }
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sums = _mm_add_epi64(_mm_add_epi64(_mm_sad_epu8(rows[0], zero), _mm_sad_epu8(rows[1], zero)), _mm_add_epi64(_mm_sad_epu8(rows[2], zero), _mm_sad_epu8(rows[3], zero)));
+  sums = _mm_add_epi64(sums, _mm_srli_si128(sums, 8));
+  const int32_t sum = _mm_cvtsi128_si32(sums);
+  // DC of the forward DCT is the exact sum of level shifted samples, rounded like `_mm_cvtps_epi32`
+  dc = static_cast<int16_t>(_mm_cvtss_si32(_mm_set_ss(static_cast<float>(sum - 64 * 128) * dc_scale)));
+  return true;
+}
+
+MYYUV_TARGET("sse2")
+static bool flat_dc_sse2(const uint16_t* src, uint32_t stride, uint32_t bits, uint32_t shift, uint8_t max_range, float dc_scale, int16_t& dc) noexcept {
+  // samples of at most 15 bits compare right as signed
+  const __m128i count = _mm_cvtsi32_si128(static_cast<int>(shift));
+  __m128i rows[8];
+  for (uint32_t j = 0; j < 8; j++) {
+    rows[j] = _mm_srl_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + j * stride)), count);
+  }
+  __m128i min = rows[0];
+  __m128i max = rows[0];
+  for (uint32_t j = 1; j < 8; j++) {
+    min = _mm_min_epi16(min, rows[j]);
+    max = _mm_max_epi16(max, rows[j]);
+  }
+  // horizontal min and max into the lowest sample
+  min = _mm_min_epi16(min, _mm_srli_si128(min, 8));
+  max = _mm_max_epi16(max, _mm_srli_si128(max, 8));
+  min = _mm_min_epi16(min, _mm_srli_si128(min, 4));
+  max = _mm_max_epi16(max, _mm_srli_si128(max, 4));
+  min = _mm_min_epi16(min, _mm_srli_si128(min, 2));
+  max = _mm_max_epi16(max, _mm_srli_si128(max, 2));
+  const int range = (_mm_cvtsi128_si32(max) & 0xFFFF) - (_mm_cvtsi128_si32(min) & 0xFFFF);
+  if (range > max_range) {
+    return false;
+  }
+  const __m128i ones = _mm_set1_epi16(1);
+  __m128i sums = _mm_setzero_si128();
+  for (uint32_t j = 0; j < 8; j++) {
+    sums = _mm_add_epi32(sums, _mm_madd_epi16(rows[j], ones));
+  }
+  sums = _mm_add_epi32(sums, _mm_srli_si128(sums, 8));
+  sums = _mm_add_epi32(sums, _mm_srli_si128(sums, 4));
+  const int32_t sum = _mm_cvtsi128_si32(sums);
+  dc = static_cast<int16_t>(_mm_cvtss_si32(_mm_set_ss(static_cast<float>(sum - 64 * (1 << (bits - 1))) * dc_scale)));
+  return true;
+}
+
+MYYUV_TARGET("sse2")
+static inline void store_sse2(const __m128 lo[8], const __m128 hi[8], uint8_t* dst, uint32_t stride) noexcept {
+  const __m128 bias = _mm_set1_ps(128.0f);
+  for (uint32_t j = 0; j < 8; j++) {
+    const __m128i a = _mm_cvtps_epi32(_mm_add_ps(lo[j], bias));
+    const __m128i b = _mm_cvtps_epi32(_mm_add_ps(hi[j], bias));
+    const __m128i row = _mm_packs_epi32(a, b);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + j * stride), _mm_packus_epi16(row, row));
+  }
+}
+
+MYYUV_TARGET("sse2")
+static inline void store_sse2(const __m128 lo[8], const __m128 hi[8], uint16_t* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept {
+  const __m128 bias = _mm_set1_ps(static_cast<float>(1u << (bits - 1)));
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i max = _mm_set1_epi16(static_cast<int16_t>((1u << bits) - 1));
+  const __m128i count = _mm_cvtsi32_si128(static_cast<int>(shift));
+  for (uint32_t j = 0; j < 8; j++) {
+    const __m128i a = _mm_cvtps_epi32(_mm_add_ps(lo[j], bias));
+    const __m128i b = _mm_cvtps_epi32(_mm_add_ps(hi[j], bias));
+    const __m128i row = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(a, b), zero), max);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + j * stride), _mm_sll_epi16(row, count));
+  }
+}
+
+MYYUV_TARGET("sse2")
+static inline void idct_sse2(const float coeffs[64], __m128 lo[8], __m128 hi[8]) noexcept {
+  for (uint32_t j = 0; j < 8; j++) {
+    lo[j] = _mm_loadu_ps(coeffs + j * 8);
+    hi[j] = _mm_loadu_ps(coeffs + j * 8 + 4);
+  }
+  idct8_sse2(lo);
+  idct8_sse2(hi);
+  transpose8_sse2(lo, hi);
+  idct8_sse2(lo);
+  idct8_sse2(hi);
+  transpose8_sse2(lo, hi);
+}
+
+MYYUV_TARGET("sse2")
+static inline void idct_4x4_sse2(const float coeffs[64], __m128 lo[8], __m128 hi[8]) noexcept {
+  // rows 4..7 and columns 4..7 are zero, so `hi` is zero in the first pass and rows 4..7 are zero after the transpose
+  for (uint32_t j = 0; j < 8; j++) {
+    lo[j] = (j < 4) ? _mm_loadu_ps(coeffs + j * 8) : _mm_setzero_ps();
+    hi[j] = _mm_setzero_ps();
+  }
+  idct8_4_sse2(lo);
+  transpose8_sse2(lo, hi);
+  idct8_4_sse2(lo);
+  idct8_4_sse2(hi);
+  transpose8_sse2(lo, hi);
+}
+
+MYYUV_TARGET("sse2")
+static void idct_store_sse2(const float coeffs[64], uint8_t* dst, uint32_t stride) noexcept {
+  __m128 lo[8], hi[8];
+  idct_sse2(coeffs, lo, hi);
+  store_sse2(lo, hi, dst, stride);
+}
+
+MYYUV_TARGET("sse2")
+static void idct_store_sse2(const float coeffs[64], uint16_t* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept {
+  __m128 lo[8], hi[8];
+  idct_sse2(coeffs, lo, hi);
+  store_sse2(lo, hi, dst, stride, bits, shift);
+}
+
+MYYUV_TARGET("sse2")
+static void idct_store_4x4_sse2(const float coeffs[64], uint8_t* dst, uint32_t stride) noexcept {
+  __m128 lo[8], hi[8];
+  idct_4x4_sse2(coeffs, lo, hi);
+  store_sse2(lo, hi, dst, stride);
+}
+
+MYYUV_TARGET("sse2")
+static void idct_store_4x4_sse2(const float coeffs[64], uint16_t* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept {
+  __m128 lo[8], hi[8];
+  idct_4x4_sse2(coeffs, lo, hi);
+  store_sse2(lo, hi, dst, stride, bits, shift);
+}
+
+// AVX2: a row of the block is exactly one vector, so 1D pass over the vectors transforms all 8 columns at once.
+
+MYYUV_TARGET("avx2")
+static inline void fdct8_avx2(__m256 d[8]) noexcept {
+  const __m256 tmp0 = _mm256_add_ps(d[0], d[7]);
+  const __m256 tmp7 = _mm256_sub_ps(d[0], d[7]);
+  const __m256 tmp1 = _mm256_add_ps(d[1], d[6]);
+  const __m256 tmp6 = _mm256_sub_ps(d[1], d[6]);
+  const __m256 tmp2 = _mm256_add_ps(d[2], d[5]);
+  const __m256 tmp5 = _mm256_sub_ps(d[2], d[5]);
+  const __m256 tmp3 = _mm256_add_ps(d[3], d[4]);
+  const __m256 tmp4 = _mm256_sub_ps(d[3], d[4]);
+  const __m256 tmp10 = _mm256_add_ps(tmp0, tmp3);
+  const __m256 tmp13 = _mm256_sub_ps(tmp0, tmp3);
+  const __m256 tmp11 = _mm256_add_ps(tmp1, tmp2);
+  const __m256 tmp12 = _mm256_sub_ps(tmp1, tmp2);
+  d[0] = _mm256_add_ps(tmp10, tmp11);
+  d[4] = _mm256_sub_ps(tmp10, tmp11);
+  const __m256 z1 = _mm256_mul_ps(_mm256_add_ps(tmp12, tmp13), _mm256_set1_ps(0.707106781f));
+  d[2] = _mm256_add_ps(tmp13, z1);
+  d[6] = _mm256_sub_ps(tmp13, z1);
+  const __m256 o10 = _mm256_add_ps(tmp4, tmp5);
+  const __m256 o11 = _mm256_add_ps(tmp5, tmp6);
+  const __m256 o12 = _mm256_add_ps(tmp6, tmp7);
+  const __m256 z5 = _mm256_mul_ps(_mm256_sub_ps(o10, o12), _mm256_set1_ps(0.382683433f));
+  const __m256 z2 = _mm256_add_ps(_mm256_mul_ps(o10, _mm256_set1_ps(0.541196100f)), z5);
+  const __m256 z4 = _mm256_add_ps(_mm256_mul_ps(o12, _mm256_set1_ps(1.306562965f)), z5);
+  const __m256 z3 = _mm256_mul_ps(o11, _mm256_set1_ps(0.707106781f));
+  const __m256 z11 = _mm256_add_ps(tmp7, z3);
+  const __m256 z13 = _mm256_sub_ps(tmp7, z3);
+  d[5] = _mm256_add_ps(z13, z2);
+  d[3] = _mm256_sub_ps(z13, z2);
+  d[1] = _mm256_add_ps(z11, z4);
+  d[7] = _mm256_sub_ps(z11, z4);
+}
+
+MYYUV_TARGET("avx2")
+static inline void idct8_avx2(__m256 d[8]) noexcept {
+  const __m256 tmp10 = _mm256_add_ps(d[0], d[4]);
+  const __m256 tmp11 = _mm256_sub_ps(d[0], d[4]);
+  const __m256 tmp13 = _mm256_add_ps(d[2], d[6]);
+  const __m256 tmp12 = _mm256_sub_ps(_mm256_mul_ps(_mm256_sub_ps(d[2], d[6]), _mm256_set1_ps(1.414213562f)), tmp13);
+  const __m256 e0 = _mm256_add_ps(tmp10, tmp13);
+  const __m256 e3 = _mm256_sub_ps(tmp10, tmp13);
+  const __m256 e1 = _mm256_add_ps(tmp11, tmp12);
+  const __m256 e2 = _mm256_sub_ps(tmp11, tmp12);
+  const __m256 z13 = _mm256_add_ps(d[5], d[3]);
+  const __m256 z10 = _mm256_sub_ps(d[5], d[3]);
+  const __m256 z11 = _mm256_add_ps(d[1], d[7]);
+  const __m256 z12 = _mm256_sub_ps(d[1], d[7]);
+  const __m256 o7 = _mm256_add_ps(z11, z13);
+  const __m256 o11 = _mm256_mul_ps(_mm256_sub_ps(z11, z13), _mm256_set1_ps(1.414213562f));
+  const __m256 z5 = _mm256_mul_ps(_mm256_add_ps(z10, z12), _mm256_set1_ps(1.847759065f));
+  const __m256 o10 = _mm256_sub_ps(_mm256_mul_ps(z12, _mm256_set1_ps(1.082392200f)), z5);
+  const __m256 o12 = _mm256_add_ps(_mm256_mul_ps(z10, _mm256_set1_ps(-2.613125930f)), z5);
+  const __m256 o6 = _mm256_sub_ps(o12, o7);
+  const __m256 o5 = _mm256_sub_ps(o11, o6);
+  const __m256 o4 = _mm256_add_ps(o10, o5);
+  d[0] = _mm256_add_ps(e0, o7);
+  d[7] = _mm256_sub_ps(e0, o7);
+  d[1] = _mm256_add_ps(e1, o6);
+  d[6] = _mm256_sub_ps(e1, o6);
+  d[2] = _mm256_add_ps(e2, o5);
+  d[5] = _mm256_sub_ps(e2, o5);
+  d[4] = _mm256_add_ps(e3, o4);
+  d[3] = _mm256_sub_ps(e3, o4);
+}
+
+MYYUV_TARGET("avx2")
+static inline void idct8_4_avx2(__m256 d[8]) noexcept {
+  const __m256 tmp13 = d[2];
+  const __m256 tmp12 = _mm256_sub_ps(_mm256_mul_ps(d[2], _mm256_set1_ps(1.414213562f)), tmp13);
+  const __m256 e0 = _mm256_add_ps(d[0], tmp13);
+  const __m256 e3 = _mm256_sub_ps(d[0], tmp13);
+  const __m256 e1 = _mm256_add_ps(d[0], tmp12);
+  const __m256 e2 = _mm256_sub_ps(d[0], tmp12);
+  const __m256 z13 = d[3];
+  const __m256 z10 = _mm256_sub_ps(_mm256_setzero_ps(), d[3]);
+  const __m256 z11 = d[1];
+  const __m256 z12 = d[1];
+  const __m256 o7 = _mm256_add_ps(z11, z13);
+  const __m256 o11 = _mm256_mul_ps(_mm256_sub_ps(z11, z13), _mm256_set1_ps(1.414213562f));
+  const __m256 z5 = _mm256_mul_ps(_mm256_add_ps(z10, z12), _mm256_set1_ps(1.847759065f));
+  const __m256 o10 = _mm256_sub_ps(_mm256_mul_ps(z12, _mm256_set1_ps(1.082392200f)), z5);
+  const __m256 o12 = _mm256_add_ps(_mm256_mul_ps(z10, _mm256_set1_ps(-2.613125930f)), z5);
+  const __m256 o6 = _mm256_sub_ps(o12, o7);
+  const __m256 o5 = _mm256_sub_ps(o11, o6);
+  const __m256 o4 = _mm256_add_ps(o10, o5);
+  d[0] = _mm256_add_ps(e0, o7);
+  d[7] = _mm256_sub_ps(e0, o7);
+  d[1] = _mm256_add_ps(e1, o6);
+  d[6] = _mm256_sub_ps(e1, o6);
+  d[2] = _mm256_add_ps(e2, o5);
+  d[5] = _mm256_sub_ps(e2, o5);
+  d[4] = _mm256_add_ps(e3, o4);
+  d[3] = _mm256_sub_ps(e3, o4);
+}
+
+MYYUV_TARGET("avx2")
+static inline void transpose8_avx2(__m256 r[8]) noexcept {
+  const __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+  const __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+  const __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+  const __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+  const __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+  const __m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+  const __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+  const __m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+  const __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+  const __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+  const __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+  const __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+  const __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+  const __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+  const __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+  const __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+  r[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+  r[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+  r[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+  r[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+  r[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+  r[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+  r[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+  r[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+}
+
+// Forward DCT and quantization of level shifted block
+MYYUV_TARGET("avx2")
+static inline void fdct_quantize_block_avx2(__m256 r[8], const float fdct_scale[64], int16_t res[64]) noexcept {
+  fdct8_avx2(r);
+  transpose8_avx2(r);
+  fdct8_avx2(r);
+  transpose8_avx2(r);
+  for (uint32_t j = 0; j < 8; j += 2) {
+    const __m256i a = _mm256_cvtps_epi32(_mm256_mul_ps(r[j], _mm256_loadu_ps(fdct_scale + j * 8)));
+    const __m256i b = _mm256_cvtps_epi32(_mm256_mul_ps(r[j + 1], _mm256_loadu_ps(fdct_scale + j * 8 + 8)));
+    // packs works within 128-bit lanes, fix the order with 64-bit permute
+    const __m256i rows = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(res + j * 8), rows);
+  }
+}
+
+MYYUV_TARGET("avx2")
+static void fdct_quantize_avx2(const uint8_t* src, uint32_t stride, const float fdct_scale[64], int16_t res[64]) noexcept {
+  __m256 r[8];
+  const __m256 bias = _mm256_set1_ps(128.0f);
+  for (uint32_t j = 0; j < 8; j++) {
+    const __m256i row = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + j * stride)));
+    r[j] = _mm256_sub_ps(_mm256_cvtepi32_ps(row), bias);
+  }
+  fdct_quantize_block_avx2(r, fdct_scale, res);
+}
+
+MYYUV_TARGET("avx2")
+static void fdct_quantize_avx2(const uint16_t* src, uint32_t stride, uint32_t bits, uint32_t shift, const float fdct_scale[64], int16_t res[64]) noexcept {
+  __m256 r[8];
+  const __m128i count = _mm_cvtsi32_si128(static_cast<int>(shift));
+  const __m256 bias = _mm256_set1_ps(static_cast<float>(1u << (bits - 1)));
+  for (uint32_t j = 0; j < 8; j++) {
+    const __m256i row = _mm256_srl_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + j * stride))), count);
+    r[j] = _mm256_sub_ps(_mm256_cvtepi32_ps(row), bias);
+  }
+  fdct_quantize_block_avx2(r, fdct_scale, res);
+}
+
+MYYUV_TARGET("avx2")
+static inline void store_avx2(const __m256 r[8], uint8_t* dst, uint32_t stride) noexcept {
+  const __m256 bias = _mm256_set1_ps(128.0f);
+  for (uint32_t j = 0; j < 8; j += 2) {
+    const __m256i a = _mm256_cvtps_epi32(_mm256_add_ps(r[j], bias));
+    const __m256i b = _mm256_cvtps_epi32(_mm256_add_ps(r[j + 1], bias));
+    const __m256i rows16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+    const __m128i rows8 = _mm_packus_epi16(_mm256_castsi256_si128(rows16), _mm256_extracti128_si256(rows16, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + j * stride), rows8);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + (j + 1) * stride), _mm_srli_si128(rows8, 8));
+  }
+}
+
+MYYUV_TARGET("avx2")
+static inline void store_avx2(const __m256 r[8], uint16_t* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept {
+  const __m256 bias = _mm256_set1_ps(static_cast<float>(1u << (bits - 1)));
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i max = _mm256_set1_epi16(static_cast<int16_t>((1u << bits) - 1));
+  const __m128i count = _mm_cvtsi32_si128(static_cast<int>(shift));
+  for (uint32_t j = 0; j < 8; j += 2) {
+    const __m256i a = _mm256_cvtps_epi32(_mm256_add_ps(r[j], bias));
+    const __m256i b = _mm256_cvtps_epi32(_mm256_add_ps(r[j + 1], bias));
+    __m256i rows16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+    rows16 = _mm256_sll_epi16(_mm256_min_epi16(_mm256_max_epi16(rows16, zero), max), count);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + j * stride), _mm256_castsi256_si128(rows16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (j + 1) * stride), _mm256_extracti128_si256(rows16, 1));
+  }
+}
+
+MYYUV_TARGET("avx2")
+static inline void idct_avx2(const float coeffs[64], __m256 r[8]) noexcept {
+  for (uint32_t j = 0; j < 8; j++) {
+    r[j] = _mm256_loadu_ps(coeffs + j * 8);
+  }
+  idct8_avx2(r);
+  transpose8_avx2(r);
+  idct8_avx2(r);
+  transpose8_avx2(r);
+}
+
+MYYUV_TARGET("avx2")
+static inline void idct_4x4_avx2(const float coeffs[64], __m256 r[8]) noexcept {
+  // rows 4..7 are zero in both passes, the second pass gets columns 4..7 of the first pass that are zero
+  for (uint32_t j = 0; j < 8; j++) {
+    r[j] = (j < 4) ? _mm256_loadu_ps(coeffs + j * 8) : _mm256_setzero_ps();
+  }
+  idct8_4_avx2(r);
+  transpose8_avx2(r);
+  idct8_4_avx2(r);
+  transpose8_avx2(r);
+}
+
+MYYUV_TARGET("avx2")
+static void idct_store_avx2(const float coeffs[64], uint8_t* dst, uint32_t stride) noexcept {
+  __m256 r[8];
+  idct_avx2(coeffs, r);
+  store_avx2(r, dst, stride);
+}
+
+MYYUV_TARGET("avx2")
+static void idct_store_avx2(const float coeffs[64], uint16_t* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept {
+  __m256 r[8];
+  idct_avx2(coeffs, r);
+  store_avx2(r, dst, stride, bits, shift);
+}
+
+MYYUV_TARGET("avx2")
+static void idct_store_4x4_avx2(const float coeffs[64], uint8_t* dst, uint32_t stride) noexcept {
+  __m256 r[8];
+  idct_4x4_avx2(coeffs, r);
+  store_avx2(r, dst, stride);
+}
+
+MYYUV_TARGET("avx2")
+static void idct_store_4x4_avx2(const float coeffs[64], uint16_t* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept {
+  __m256 r[8];
+  idct_4x4_avx2(coeffs, r);
+  store_avx2(r, dst, stride, bits, shift);
+}
+
+#endif // MYYUV_X86
+
+} // namespace
+
+namespace {
+
+// Dispatch of both sample types, `bits` and `shift` are fixed to 8 and 0 for 8-bit samples
+
+template <typename T>
+static void fdct_quantize_dispatch(myyuv::SimdLevel level, const T* src, uint32_t stride, uint32_t bits, uint32_t shift, const float fdct_scale[64], int16_t res[64]) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      if constexpr (std::is_same<T, uint8_t>::value) {
+        fdct_quantize_avx2(src, stride, fdct_scale, res);
+      } else {
+        fdct_quantize_avx2(src, stride, bits, shift, fdct_scale, res);
+      }
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      if constexpr (std::is_same<T, uint8_t>::value) {
+        fdct_quantize_sse2(src, stride, fdct_scale, res);
+      } else {
+        fdct_quantize_sse2(src, stride, bits, shift, fdct_scale, res);
+      }
+      break;
+#endif
+    default:
+      fdct_quantize_scalar(src, stride, bits, shift, fdct_scale, res);
+      break;
+  }
+}
+
+template <typename T>
+static bool flat_dc_dispatch(myyuv::SimdLevel level, const T* src, uint32_t stride, uint32_t bits, uint32_t shift, uint8_t max_range, float dc_scale, int16_t& dc) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      if constexpr (std::is_same<T, uint8_t>::value) {
+        return flat_dc_sse2(src, stride, max_range, dc_scale, dc);
+      } else {
+        return flat_dc_sse2(src, stride, bits, shift, max_range, dc_scale, dc);
+      }
+#endif
+    default:
+      return flat_dc_scalar(src, stride, bits, shift, max_range, dc_scale, dc);
+  }
+}
+
+template <typename T>
+static void idct_store_dispatch(myyuv::SimdLevel level, const float coeffs[64], T* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      if constexpr (std::is_same<T, uint8_t>::value) {
+        idct_store_avx2(coeffs, dst, stride);
+      } else {
+        idct_store_avx2(coeffs, dst, stride, bits, shift);
+      }
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      if constexpr (std::is_same<T, uint8_t>::value) {
+        idct_store_sse2(coeffs, dst, stride);
+      } else {
+        idct_store_sse2(coeffs, dst, stride, bits, shift);
+      }
+      break;
+#endif
+    default:
+      idct_store_scalar(coeffs, dst, stride, bits, shift);
+      break;
+  }
+}
+
+template <typename T>
+static void idct_store_4x4_dispatch(myyuv::SimdLevel level, const float coeffs[64], T* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      if constexpr (std::is_same<T, uint8_t>::value) {
+        idct_store_4x4_avx2(coeffs, dst, stride);
+      } else {
+        idct_store_4x4_avx2(coeffs, dst, stride, bits, shift);
+      }
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      if constexpr (std::is_same<T, uint8_t>::value) {
+        idct_store_4x4_sse2(coeffs, dst, stride);
+      } else {
+        idct_store_4x4_sse2(coeffs, dst, stride, bits, shift);
+      }
+      break;
+#endif
+    default:
+      idct_store_4x4_scalar(coeffs, dst, stride, bits, shift);
+      break;
+  }
+}
+
+template <typename T>
+static void idct_store_dc_dispatch(myyuv::SimdLevel level, float dc, T* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  // inverse DCT of DC only block is `dc` in every sample, rounding matches `idct_store` kernel of the same level
+  const int bias = 1 << (bits - 1);
+  const int value = (level == myyuv::SimdLevel::SCALAR) ? static_cast<int>(std::round(dc)) + bias : static_cast<int>(std::nearbyint(dc + static_cast<float>(bias)));
+  const T sample = static_cast<T>(std::clamp(value, 0, (1 << bits) - 1) << shift);
+  for (uint32_t j = 0; j < 8; j++) {
+    std::fill(dst + j * stride, dst + j * stride + 8, sample);
+  }
+}
+
+} // namespace
+
+namespace myyuvDCT {
+
+void fdct_quantize(myyuv::SimdLevel level, const uint8_t* src, uint32_t stride, const float fdct_scale[64], int16_t res[64]) noexcept {
+  fdct_quantize_dispatch(level, src, stride, 8, 0, fdct_scale, res);
+}
+
+void fdct_quantize(myyuv::SimdLevel level, const uint16_t* src, uint32_t stride, uint32_t bits, uint32_t shift, const float fdct_scale[64], int16_t res[64]) noexcept {
+  assert(bits > 8 && bits <= 12 && bits + shift <= 16);
+  fdct_quantize_dispatch(level, src, stride, bits, shift, fdct_scale, res);
+}
+
+bool flat_dc(myyuv::SimdLevel level, const uint8_t* src, uint32_t stride, uint8_t max_range, float dc_scale, int16_t& dc) noexcept {
+  return flat_dc_dispatch(level, src, stride, 8, 0, max_range, dc_scale, dc);
+}
+
+bool flat_dc(myyuv::SimdLevel level, const uint16_t* src, uint32_t stride, uint32_t bits, uint32_t shift, uint8_t max_range, float dc_scale, int16_t& dc) noexcept {
+  assert(bits > 8 && bits <= 12 && bits + shift <= 16);
+  return flat_dc_dispatch(level, src, stride, bits, shift, max_range, dc_scale, dc);
+}
+
+void idct_store(myyuv::SimdLevel level, const float coeffs[64], uint8_t* dst, uint32_t stride) noexcept {
+  idct_store_dispatch(level, coeffs, dst, stride, 8, 0);
+}
+
+void idct_store(myyuv::SimdLevel level, const float coeffs[64], uint16_t* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept {
+  assert(bits > 8 && bits <= 12 && bits + shift <= 16);
+  idct_store_dispatch(level, coeffs, dst, stride, bits, shift);
+}
+
+void idct_store_4x4(myyuv::SimdLevel level, const float coeffs[64], uint8_t* dst, uint32_t stride) noexcept {
+  idct_store_4x4_dispatch(level, coeffs, dst, stride, 8, 0);
+}
+
+void idct_store_4x4(myyuv::SimdLevel level, const float coeffs[64], uint16_t* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept {
+  assert(bits > 8 && bits <= 12 && bits + shift <= 16);
+  idct_store_4x4_dispatch(level, coeffs, dst, stride, bits, shift);
+}
+
+void idct_store_dc(myyuv::SimdLevel level, float dc, uint8_t* dst, uint32_t stride) noexcept {
+  idct_store_dc_dispatch(level, dc, dst, stride, 8, 0);
+}
+
+void idct_store_dc(myyuv::SimdLevel level, float dc, uint16_t* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept {
+  assert(bits > 8 && bits <= 12 && bits + shift <= 16);
+  idct_store_dc_dispatch(level, dc, dst, stride, bits, shift);
+}
+
+} // myyuvDCT
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include "myyuv_cpu.hpp"
+
+namespace myyuvDCT {
+
+/**
+* @brief AAN (Arai, Agui, Nakajima) DCT scale factors.
+* @note Output of the fast forward DCT for frequency (u, v) is scaled by `aan_scale_factors[u] * aan_scale_factors[v] * 8`,
+* the fast inverse DCT expects its input scaled by `aan_scale_factors[u] * aan_scale_factors[v] / 8`.
+*/
+static constexpr const float aan_scale_factors[8] = {
+  1.0f, 1.387039845f, 1.306562965f, 1.175875602f, 1.0f, 0.785694958f, 0.541196100f, 0.275899379f,
+};
+
+/**
+* @brief Level shift, forward DCT and quantization of 8x8 block.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+* @param src Top-left sample of the block in the plane.
+* @param stride Plane width in samples.
+* @param fdct_scale Reciprocal of quantization table with AAN scale factors folded in.
+* @param[out] res Quantized coefficients.
+*/
+void fdct_quantize(myyuv::SimdLevel level, const uint8_t* src, uint32_t stride, const float fdct_scale[64], int16_t res[64]) noexcept;
+
+/**
+* @brief `fdct_quantize` of high bit depth samples.
+* @param bits Sample bit depth, from 9 to 12, so coefficients fit `int16_t`.
+* @param shift Samples are stored in 16 bits shifted left by `shift`, `bits + shift` is at most 16.
+* @see fdct_quantize
+*/
+void fdct_quantize(myyuv::SimdLevel level, const uint16_t* src, uint32_t stride, uint32_t bits, uint32_t shift, const float fdct_scale[64], int16_t res[64]) noexcept;
+
+/**
+* @brief Checks if 8x8 block is flat, that is all its samples are within `max_range` of each other.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+* @param src Top-left sample of the block in the plane.
+* @param stride Plane width in samples.
+* @param max_range Largest difference between samples of flat block.
+* @param dc_scale Reciprocal of DC quantization with AAN scale factor folded in, `fdct_scale[0]` of `fdct_quantize`.
+* @param[out] dc Quantized DC coefficient, the same as of `fdct_quantize` with the same level. Set only for flat blocks.
+* @return `true` if the block is flat.
+*/
+bool flat_dc(myyuv::SimdLevel level, const uint8_t* src, uint32_t stride, uint8_t max_range, float dc_scale, int16_t& dc) noexcept;
+
+/**
+* @brief `flat_dc` of high bit depth samples, `max_range` is in units of `bits` bit samples.
+* @see flat_dc
+* @see fdct_quantize
+*/
+bool flat_dc(myyuv::SimdLevel level, const uint16_t* src, uint32_t stride, uint32_t bits, uint32_t shift, uint8_t max_range, float dc_scale, int16_t& dc) noexcept;
+
+/**
+* @brief Inverse DCT, level shift and saturation of dequantized 8x8 block.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+* @param coeffs Coefficients multiplied by quantization table with AAN scale factors folded in.
+* @param[out] dst Top-left sample of the block in the plane.
+* @param stride Plane width in samples.
+*/
+void idct_store(myyuv::SimdLevel level, const float coeffs[64], uint8_t* dst, uint32_t stride) noexcept;
+
+/**
+* @brief `idct_store` of high bit depth samples, samples are saturated to `bits` bits and shifted left by `shift`.
+* @see idct_store
+* @see fdct_quantize
+*/
+void idct_store(myyuv::SimdLevel level, const float coeffs[64], uint16_t* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept;
+
+/**
+* @brief `idct_store` for blocks whose nonzero coefficients are all in the top-left 4x4, zero inputs are skipped.
+* @note The results are the same as of `idct_store`.
+* @see idct_store
+*/
+void idct_store_4x4(myyuv::SimdLevel level, const float coeffs[64], uint8_t* dst, uint32_t stride) noexcept;
+
+/**
+* @brief `idct_store_4x4` of high bit depth samples.
+* @see idct_store_4x4
+* @see fdct_quantize
+*/
+void idct_store_4x4(myyuv::SimdLevel level, const float coeffs[64], uint16_t* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept;
+
+/**
+* @brief `idct_store` for blocks with only DC coefficient, which fills the block with one value.
+* @note The results are the same as of `idct_store`.
+* @param level Kernel SIMD level, only rounding of `idct_store` with this level is repeated.
+* @param dc Dequantized DC coefficient.
+* @param[out] dst Top-left sample of the block in the plane.
+* @param stride Plane width in samples.
+* @see idct_store
+*/
+void idct_store_dc(myyuv::SimdLevel level, float dc, uint8_t* dst, uint32_t stride) noexcept;
+
+/**
+* @brief `idct_store_dc` of high bit depth samples.
+* @see idct_store_dc
+* @see fdct_quantize
+*/
+void idct_store_dc(myyuv::SimdLevel level, float dc, uint16_t* dst, uint32_t stride, uint32_t bits, uint32_t shift) noexcept;
+
+} // myyuvDCT
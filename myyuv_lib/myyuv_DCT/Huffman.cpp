@@ -1,16 +1,14 @@
 #include "Huffman.hpp"
 
+#include "BitIO.hpp"
 #include <cstdint>
-#include <iterator>
+#include <cstring>
 #include <stdexcept>
 #include <unordered_map>
-#include <queue>
+#include <memory_resource>
 #include <cassert>
-#include <functional>
-#include <iostream>
 #include <limits>
 #include <algorithm>
-#include <iterator>
 
 namespace {
 
@@ -24,113 +22,94 @@ static T divide_roundup(T numer, T denom) noexcept {
   return result;
 }
 
-template<typename T, typename U>
-inline static bool mapKeyExist(const std::map<T, U>& map, const T& key) noexcept {
-  return map.find(key) != map.end();
-}
-
 static uint32_t zigzag_indexes[64] = {
   0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
 };
 
-static void pack11bit(uint8_t* packed_res, std::vector<int16_t>::const_iterator& it, uint8_t count) noexcept {
-  std::fill(packed_res, packed_res + divide_roundup(static_cast<unsigned>(count) * 11u, 8u), 0);
-  int bit_offset = 0;
+// `bits` bits per character in LSB first bit stream, padded to a whole byte. 8-bit samples use 11 bits.
+static uint8_t packBits(uint8_t* packed_res, const int16_t* symbols, uint8_t count, uint8_t bits) noexcept {
+  myyuvDCT::BitWriter writer(packed_res, divide_roundup(static_cast<unsigned>(count) * bits, 8u));
+  const uint16_t mask = static_cast<uint16_t>((1u << bits) - 1);
   for (uint8_t i = 0; i < count; i++) {
-    int byte_ind = bit_offset / 8;
-    int bit_ind = bit_offset % 8;
-    int16_t _num = *it;
-    uint16_t num = (_num < 0 ) ? (2048 + _num) : _num;
-    packed_res[byte_ind] |= (num << bit_ind) & 0xFF;
-    packed_res[byte_ind + 1] |= (num >> (8 - bit_ind)) & 0xFF;
-    if (bit_ind > 5) { // 16 - 11
-      packed_res[byte_ind + 2] |= (num >> (16 - bit_ind)) & 0xFF;
-    }
-    bit_offset += 11;
-    it++;
+    writer.put(static_cast<uint16_t>(symbols[i]) & mask, bits);
   }
+  return writer.finish();
 }
 
-static void unpack11bit(const uint8_t* packed_arr, std::vector<int16_t>& res, uint8_t count) noexcept {
-  int bit_offset = 0;
+static void unpackBits(const uint8_t* packed_arr, int16_t* res, uint8_t count, uint8_t bits) noexcept {
+  myyuvDCT::BitReader reader(packed_arr, divide_roundup(static_cast<unsigned>(count) * bits, 8u));
+  const int32_t half = 1 << (bits - 1);
   for (uint8_t i = 0; i < count; i++) {
-    int byte_ind = bit_offset / 8;
-    int bit_ind = bit_offset % 8;
-    uint16_t _num = (packed_arr[byte_ind] >> bit_ind) & 0xFF;
-    _num |= (packed_arr[byte_ind + 1] << (8 - bit_ind)) & 0x7FF;
-    if (bit_ind > 5) { // 16 - 11
-      _num |= (packed_arr[byte_ind + 2] << (16 - bit_ind)) & 0x7FF;
-    }
-    _num &= 0x7FF;
-    int16_t num = (_num >= 1024) ? (_num - 2048) : _num;
-    res.push_back(num);
-    bit_offset += 11;
+    const int32_t num = reader.read(bits);
+    res[i] = static_cast<int16_t>((num >= half) ? (num - 2 * half) : num);
   }
 }
 
-static void generateCodeLength(std::map<uint8_t, std::vector<int16_t>>& tree_data, const std::shared_ptr<myyuvDCT::HFMNode>& node, uint8_t code_length) {
-  if (node == nullptr) {
-    return;
+static uint8_t reverseBits(uint8_t code, uint8_t len) noexcept {
+  uint8_t reversed = 0;
+  for (uint8_t b = 0; b < len; b++) {
+    reversed |= ((code >> b) & 1) << (len - b - 1);
   }
-  if (node->isLeaf()) {
-    std::vector<int16_t>& vector = tree_data[code_length + (code_length == 0)];
-    vector.reserve(16); // 8 looks too little and 32 looks too much
-    vector.insert(std::lower_bound(vector.begin(), vector.end(), node->ch), node->ch);
-    return;
-  }
-  generateCodeLength(tree_data, node->left, code_length + 1);
-  generateCodeLength(tree_data, node->right, code_length + 1);
+  return reversed;
 }
 
-// map<ch, <length, code>>
-static std::unordered_map<int16_t, std::pair<uint8_t, std::bitset<8>>> generateCanonicalTree(const std::map<uint8_t, std::vector<int16_t>>& tree_data) {
-  std::unordered_map<int16_t, std::pair<uint8_t, std::bitset<8>>> res;
+/**
+* Huffman tree in flat arrays.
+* Leaves come first, internal nodes are appended as they are merged, so children always have smaller indexes than their parent and the root is the last node.
+*/
+struct HFMTree {
+  static constexpr uint8_t max_nodes = 2 * 64 - 1;
+  int16_t ch[max_nodes]; /// Character that is stored in the leaf.
+  uint8_t freq[max_nodes]; /// Frequency of a node.
+  uint8_t left[max_nodes]; /// Left node index of internal node.
+  uint8_t right[max_nodes]; /// Right node index of internal node.
+  uint8_t size = 0;
+};
+
+// Symbol of `max_symbol_bits` bits ranges from -16384 to 16383, so it is offset by 16384.
+// Each entry is reversed code << 4 | length, codes are written MSB first into LSB first bit stream.
+static constexpr uint32_t symbol_offset = 1u << (myyuvDCT::Huffman::max_symbol_bits - 1);
+static constexpr uint32_t code_table_size = 2 * symbol_offset;
+
+static void generateCanonicalCodes(uint16_t code_table[code_table_size], const int16_t symbols[64], const uint8_t length_counts[9]) noexcept {
   uint8_t prev_len = 0;
   uint8_t code = 0;
-  for (const auto& it : tree_data) {
-    const std::vector<int16_t>& vector = it.second;
-    const uint8_t& len = it.first;
+  const int16_t* symbol = symbols;
+  for (uint8_t len = 1; len <= 8; len++) {
+    if (length_counts[len] == 0) {
+      continue;
+    }
     code <<= len - prev_len;
-    for (const auto& c : vector) {
+    for (uint8_t k = 0; k < length_counts[len]; k++) {
       assert(code < 128); // just in case
-      res.insert({ c, { len, code } });
-      //std::cout << (int)c << ':' << std::bitset<8>(code).to_string().substr(8 - len) << ' ' << (int)len << '\n';
+      code_table[*symbol++ + symbol_offset] = static_cast<uint16_t>(reverseBits(code, len) << 4) | len;
       code++;
     }
     prev_len = len;
   }
-  return res;
 }
 
 // https://github.com/madler/zlib/blob/develop/contrib/puff/puff.c decode (SLOW)
-static int16_t decodeSymbol(uint16_t& i, const std::bitset<512>& encoded_data, const uint16_t encoded_data_bits, const std::map<uint8_t, std::vector<int16_t>>& tree_data) {
+static int16_t decodeSymbol(uint16_t& i, myyuvDCT::BitReader& encoded_data, const uint16_t encoded_data_bits, const int16_t symbols[64], const uint8_t length_counts[9]) {
   uint8_t code = 0;
   uint8_t first = 0;
-  auto tree_data_iterator = tree_data.begin();
+  const int16_t* symbol = symbols;
   for (uint8_t j = 1; j <= 8; j++) {
-    uint8_t ch_count = 0;
-    const std::vector<int16_t>* vector = nullptr;
-    if (tree_data_iterator != tree_data.end() && tree_data_iterator->first == j) {
-      vector = &tree_data_iterator->second;
-      tree_data_iterator++;
-      assert(vector == &tree_data.at(j));
-      ch_count = vector->size();
-    }
+    const uint8_t ch_count = length_counts[j];
     assert(i < encoded_data_bits);
     if (i >= encoded_data_bits) {
       throw std::runtime_error("Huffman bad code");
     }
-    code |= encoded_data.test(i++);
+    code |= encoded_data.read(1);
+    i++;
     assert(static_cast<int>(ch_count) + static_cast<int>(first) < 255);
     assert(code < 255);
     if (code < ch_count + first) {
       assert(code >= first);
       assert(code - first < ch_count);
-      if (!vector) {
-        throw std::runtime_error("Huffman bad code");
-      }
-      return vector->at(code - first);
+      return symbol[code - first];
     }
+    symbol += ch_count;
     first += ch_count;
     first <<= 1;
     assert(code <= 127);
@@ -140,19 +119,117 @@ static int16_t decodeSymbol(uint16_t& i, const std::bitset<512>& encoded_data, c
   return 0;
 }
 
-static void decodeFromTreeData(int16_t data[64], const std::bitset<512>& encoded_data, const uint16_t encoded_data_bits, const std::map<uint8_t, std::vector<int16_t>>& tree_data) {
-  assert(encoded_data_bits <= encoded_data.size());
+static void decodeFromTreeData(int16_t data[64], const uint8_t* encoded, const uint16_t encoded_data_bits, const int16_t symbols[64], const uint8_t length_counts[9]) {
+  assert(encoded_data_bits <= 512);
+  myyuvDCT::BitReader encoded_data(encoded, divide_roundup<uint16_t>(encoded_data_bits, 8u));
   size_t j = 0;
   uint16_t i = 0;
   while (i < encoded_data_bits && j < 64) {
     assert(j < 64);
-    data[zigzag_indexes[j++]] = decodeSymbol(i, encoded_data, encoded_data_bits, tree_data);
-    //std::cout << "data[" << zigzag_indexes[j - 1] << "] = " << data[zigzag_indexes[j - 1]] << '\n';
+    data[zigzag_indexes[j++]] = decodeSymbol(i, encoded_data, encoded_data_bits, symbols, length_counts);
     assert(i <= encoded_data_bits);
   }
   assert(i == encoded_data_bits);
 }
 
+/**
+* Lookup table that resolves a symbol with a single peek of `bits` bits, where `bits` is the longest code length (8 at most).
+* Encoded data is stored LSB first, so the table is indexed by bit reversed codes.
+* Each entry packs code length in the low 4 bits and the symbol in the high bits, 0 means no code starts with these bits.
+*/
+struct DecodeTable {
+  uint8_t bits;
+  int32_t entries[256];
+};
+
+static void buildDecodeTable(DecodeTable& table, const int16_t symbols[64], const uint8_t length_counts[9]) {
+  table.bits = 8;
+  while (table.bits > 1 && length_counts[table.bits] == 0) {
+    table.bits--;
+  }
+  const uint16_t table_size = 1u << table.bits;
+  std::fill(table.entries, table.entries + table_size, 0);
+  uint8_t prev_len = 0;
+  uint16_t code = 0;
+  const int16_t* symbol = symbols;
+  for (uint8_t len = 1; len <= table.bits; len++) {
+    if (length_counts[len] == 0) {
+      continue;
+    }
+    code <<= len - prev_len;
+    for (uint8_t k = 0; k < length_counts[len]; k++) {
+      if (code >= (1u << len)) {
+        throw std::runtime_error("Huffman bad tree");
+      }
+      const uint16_t reversed = reverseBits(code, len);
+      const int32_t entry = static_cast<int32_t>(static_cast<uint32_t>(*symbol++) << 4) | len;
+      for (uint16_t e = reversed; e < table_size; e += (1u << len)) {
+        table.entries[e] = entry;
+      }
+      code++;
+    }
+    prev_len = len;
+  }
+}
+
+// Calls `store(index, ch)` for every decoded character, `index` is the position in the matrix.
+template <typename Store>
+static void decodeFromTable(const uint8_t* encoded, const uint16_t encoded_data_bits, const DecodeTable& table, Store store) {
+  myyuvDCT::BitReader reader(encoded, divide_roundup<uint16_t>(encoded_data_bits, 8u));
+  uint16_t i = 0;
+  size_t j = 0;
+  while (i < encoded_data_bits && j < 64) {
+    const int32_t entry = table.entries[reader.peek(table.bits)];
+    const uint8_t len = entry & 15;
+    if (len == 0 || len > encoded_data_bits - i) {
+      throw std::runtime_error("Huffman bad code");
+    }
+    store(zigzag_indexes[j++], static_cast<int16_t>(entry >> 4));
+    reader.skip(len);
+    i += len;
+  }
+  assert(i == encoded_data_bits);
+}
+
+/**
+* Parses encoded data size and canonical tree of a dump.
+* `length_counts` must be zeroed.
+* Returns position of encoded data in the dump.
+*/
+static uint8_t parseDump(const uint8_t* data, uint8_t size, uint8_t symbol_bits, uint16_t& encoded_data_bits, int16_t symbols[64], uint8_t length_counts[9], uint8_t& symbols_count) {
+  // 2 bytes for encoded data size in bits
+  // 1 byte for tree ch size
+  // each tree ch: 1 byte for code length (1..8) and ch count (1..32) + (ch_count * symbol_bits + 7) / 8 bytes for tree (symbol_bits bits per ch_count and padding)
+  // (encoded_data_bits + 7) / 8 bytes of encoded data
+  assert(size >= 3);
+  uint8_t i = 0;
+  std::copy(data, data + sizeof(encoded_data_bits), reinterpret_cast<uint8_t*>(&encoded_data_bits));
+  if (encoded_data_bits > 512) {
+    throw std::runtime_error("Huffman bad encoded data size");
+  }
+  [[maybe_unused]] const uint16_t encoded_data_size = divide_roundup<uint16_t>(encoded_data_bits, 8u);
+  i += sizeof(encoded_data_bits);
+  const uint8_t tree_data_size = data[i++];
+  assert(3 + tree_data_size + encoded_data_size <= size);
+  symbols_count = 0;
+  uint8_t prev_length = 0;
+  while (i - 3 < tree_data_size) {
+    uint8_t ch_info = data[i++];
+    uint8_t ch_length = (ch_info >> 5) + 1;
+    uint8_t ch_count = (ch_info & 31) + 1;
+    if (ch_length < prev_length || symbols_count + ch_count > 64) {
+      throw std::runtime_error("Huffman bad tree");
+    }
+    unpackBits(data + i, symbols + symbols_count, ch_count, symbol_bits);
+    symbols_count += ch_count;
+    length_counts[ch_length] += ch_count;
+    prev_length = ch_length;
+    i += divide_roundup(static_cast<unsigned>(ch_count) * symbol_bits, 8u);
+  }
+  assert(i - 3 == tree_data_size);
+  return i;
+}
+
 } // namespace
 
 namespace myyuvDCT {
@@ -165,18 +242,27 @@ Huffman& Huffman::operator=(Huffman&& huffman) noexcept {
   std::swap(data, huffman.data);
   std::swap(encoded_data_bits, huffman.encoded_data_bits);
   std::swap(encoded_data, huffman.encoded_data);
-  std::swap(tree_data, huffman.tree_data);
+  std::swap(symbols, huffman.symbols);
+  std::swap(length_counts, huffman.length_counts);
+  std::swap(symbols_count, huffman.symbols_count);
+  std::swap(symbol_bits, huffman.symbol_bits);
   return *this;
 }
 
-Huffman Huffman::fromData(const int16_t data[64]) {
-  std::unordered_map<int16_t, uint8_t> freq;
+Huffman Huffman::fromData(const int16_t data[64], uint8_t symbol_bits) {
+  assert(symbol_bits >= default_symbol_bits && symbol_bits <= max_symbol_bits);
+  [[maybe_unused]] const int16_t max_symbol = static_cast<int16_t>((1 << (symbol_bits - 1)) - 1);
+  // Iteration order of `freq` decides how equal frequencies are merged and so the resulting code lengths.
+  // The map is kept to keep the bitstream, but it allocates from the stack.
+  alignas(std::max_align_t) uint8_t freq_arena[4096];
+  std::pmr::monotonic_buffer_resource freq_resource(freq_arena, sizeof(freq_arena));
+  std::pmr::unordered_map<int16_t, uint8_t> freq(&freq_resource);
   uint16_t last_seen_zero = 0;
   int16_t _data[64];
   for (size_t i = 0; i < 64; i++) {
     // zigzag path
-    assert(data[i] <= 1023);
-    assert(data[i] >= -1024);
+    assert(data[i] <= max_symbol);
+    assert(data[i] >= -max_symbol - 1);
     const int16_t d = data[zigzag_indexes[i]];
     _data[i] = d;
     freq[d]++;
@@ -201,128 +287,182 @@ Huffman Huffman::fromData(const int16_t data[64]) {
       freq.erase(0);
     }
   }
-  std::priority_queue<std::shared_ptr<HFMNode>, std::vector<std::shared_ptr<HFMNode>>, HFMNode::Compare> pq;
-  std::shared_ptr<HFMNode> root;
-  assert(root == nullptr);
+  // Same binary heap operations as std::priority_queue, so ties are merged in the same order.
+  HFMTree tree;
+  uint8_t heap[64];
+  uint8_t heap_size = 0;
+  const auto compare = [&tree](uint8_t a, uint8_t b) noexcept {
+    return tree.freq[a] > tree.freq[b];
+  };
   for (const auto& pair : freq) {
-    pq.push(std::make_shared<HFMNode>(pair.first, pair.second));
+    tree.ch[tree.size] = pair.first;
+    tree.freq[tree.size] = pair.second;
+    heap[heap_size++] = tree.size++;
+    std::push_heap(heap, heap + heap_size, compare);
+  }
+  const uint8_t leaves_count = tree.size;
+  assert(leaves_count >= 1 && leaves_count <= 64);
+  while (heap_size > 1) {
+    std::pop_heap(heap, heap + heap_size, compare);
+    const uint8_t left = heap[--heap_size];
+    std::pop_heap(heap, heap + heap_size, compare);
+    const uint8_t right = heap[--heap_size];
+    tree.freq[tree.size] = tree.freq[left] + tree.freq[right];
+    tree.left[tree.size] = left;
+    tree.right[tree.size] = right;
+    heap[heap_size++] = tree.size++;
+    std::push_heap(heap, heap + heap_size, compare);
   }
-  while (pq.size() > 1) {
-    std::shared_ptr<HFMNode> left = pq.top();
-    pq.pop();
-    std::shared_ptr<HFMNode> right = pq.top();
-    pq.pop();
-    root = std::make_shared<HFMNode>(0, left->freq + right->freq, left, right);
-    pq.push(root);
+  // depth of every node, parents are visited before their children
+  uint8_t depth[HFMTree::max_nodes] = { 0 };
+  for (uint8_t n = tree.size; n-- > leaves_count;) {
+    depth[tree.left[n]] = depth[n] + 1;
+    depth[tree.right[n]] = depth[n] + 1;
   }
-  if (root == nullptr) {
-    // means only 1 ch
-    root = std::make_shared<HFMNode>(_data[0], freq[_data[0]]);
+  // sort characters by (code length, character)
+  uint32_t sort_keys[64];
+  for (uint8_t n = 0; n < leaves_count; n++) {
+    const uint32_t code_length = depth[n] + (depth[n] == 0);
+    assert(code_length <= 8);
+    sort_keys[n] = (code_length << 16) | static_cast<uint32_t>(tree.ch[n] + symbol_offset);
   }
-  assert(root != nullptr);
+  std::sort(sort_keys, sort_keys + leaves_count);
   Huffman huffman;
   std::copy(data, data + 64, huffman.data);
-  generateCodeLength(huffman.tree_data, root, 0);
-  const std::unordered_map<int16_t, std::pair<uint8_t, std::bitset<8>>> canonical_tree = generateCanonicalTree(huffman.tree_data);
-  uint16_t encoded_data_bits = 0;
+  huffman.symbol_bits = symbol_bits;
+  huffman.symbols_count = leaves_count;
+  for (uint8_t n = 0; n < leaves_count; n++) {
+    huffman.symbols[n] = static_cast<int16_t>(static_cast<int32_t>(sort_keys[n] & 0xFFFF) - static_cast<int32_t>(symbol_offset));
+    huffman.length_counts[sort_keys[n] >> 16]++;
+  }
+  // only entries of characters in the block are written and read, so one table per thread is reused without clearing
+  static thread_local uint16_t code_table[code_table_size];
+  generateCanonicalCodes(code_table, huffman.symbols, huffman.length_counts);
+  myyuvDCT::BitWriter writer(huffman.encoded_data, sizeof(huffman.encoded_data));
   for (size_t i = 0; i < actual_msg_size; i++) {
-    const auto& d = canonical_tree.at(_data[i]);
-    const uint8_t& code_len = d.first;
-    const std::bitset<8>& code = d.second;
-    for (uint8_t j = 0; j < code_len; j++) {
-      huffman.encoded_data.set(encoded_data_bits + j, code.test(code_len - j - 1));
-    }
-    encoded_data_bits += code_len;
+    const uint16_t entry = code_table[_data[i] + symbol_offset];
+    assert((entry & 15) > 0);
+    writer.put(entry >> 4, entry & 15);
   }
-  //std::cout << huffman.encoded_data.to_string().substr(512 - encoded_data_bits) << '\n';
-  assert(encoded_data_bits <= huffman.encoded_data.size());
-  huffman.encoded_data_bits = encoded_data_bits;
+  writer.finish();
+  assert(writer.bits() <= 512);
+  huffman.encoded_data_bits = writer.bits();
   return huffman;
 }
 
-Huffman Huffman::fromDump(const uint8_t* data, uint8_t size) {
-  // 2 bytes for encoded data size in bits
-  // 1 byte for tree ch size
-  // each tree ch: 1 byte for code length (1..8) and ch count (1..32) + (ch_count * 11 + 7) / 8 bytes for tree (11 bits per ch_count and padding)
-  // (encoded_data_bits + 7) / 8 bytes of encoded data
-  assert(size >= 3);
+uint8_t Huffman::dumpDC(int16_t dc, uint8_t* res_data, uint8_t symbol_bits) {
+  assert(symbol_bits >= default_symbol_bits && symbol_bits <= max_symbol_bits);
+  assert(dc < (1 << (symbol_bits - 1)));
+  assert(dc >= -(1 << (symbol_bits - 1)));
+  // the only character has code 0 of length 1, every symbol size takes 2 bytes
+  constexpr uint8_t res_size = 7;
+  const uint16_t encoded_data_bits = 1;
+  std::memcpy(res_data, &encoded_data_bits, sizeof(encoded_data_bits));
+  res_data[2] = 3;
+  res_data[3] = 0;
+  packBits(res_data + 4, &dc, 1, symbol_bits);
+  res_data[6] = 0;
+  assert(([dc, res_data, symbol_bits]()->bool{
+    int16_t data[64] = { dc };
+    uint8_t dump_data[max_dump_size];
+    const uint8_t dump_size = fromData(data, symbol_bits).dumpTo(dump_data);
+    return dump_size == res_size && std::equal(res_data, res_data + res_size, dump_data);
+  }()));
+  return res_size;
+}
+
+Huffman Huffman::loadDump(const uint8_t* data, uint8_t size, uint8_t symbol_bits) {
+  assert(symbol_bits >= default_symbol_bits && symbol_bits <= max_symbol_bits);
   Huffman huffman;
-  uint8_t i = 0;
+  huffman.symbol_bits = symbol_bits;
+  const uint8_t i = parseDump(data, size, symbol_bits, huffman.encoded_data_bits, huffman.symbols, huffman.length_counts, huffman.symbols_count);
+  std::copy(data + i, data + i + divide_roundup<uint16_t>(huffman.encoded_data_bits, 8u), huffman.encoded_data);
+  return huffman;
+}
+
+Huffman Huffman::fromDump(const uint8_t* data, uint8_t size, uint8_t symbol_bits) {
+  Huffman huffman = loadDump(data, size, symbol_bits);
+  DecodeTable table;
+  buildDecodeTable(table, huffman.symbols, huffman.length_counts);
+  decodeFromTable(huffman.encoded_data, huffman.encoded_data_bits, table, [&huffman](uint32_t k, int16_t ch) {
+    huffman.data[k] = ch;
+  });
+  assert(huffman == fromDumpReference(data, size, symbol_bits));
+  return huffman;
+}
+
+uint8_t Huffman::decodeDump(const uint8_t* data, uint8_t size, const float scale[64], float res[64], bool& in_4x4, uint8_t symbol_bits) {
+  assert(symbol_bits >= default_symbol_bits && symbol_bits <= max_symbol_bits);
   uint16_t encoded_data_bits;
-  std::copy(data, data + sizeof(Huffman::encoded_data_bits), reinterpret_cast<uint8_t*>(&encoded_data_bits));
-  assert(encoded_data_bits <= huffman.encoded_data.size());
-  const uint16_t encoded_data_size = divide_roundup<uint16_t>(encoded_data_bits, 8u);
-  i += sizeof(Huffman::encoded_data_bits);
-  const uint8_t tree_data_size = data[i++];
-  assert(3 + tree_data_size + encoded_data_size <= size);
-  while (i - 3 < tree_data_size) {
-    uint8_t ch_info = data[i++];
-    uint8_t ch_length = (ch_info >> 5) + 1;
-    uint8_t ch_count = (ch_info & 31) + 1;
-    std::vector<int16_t>& vector = huffman.tree_data[ch_length];
-    vector.reserve(ch_count);
-    unpack11bit(data + i, vector, ch_count);
-    i += divide_roundup(static_cast<unsigned>(ch_count) * 11u, 8u);
-  }
-  assert(i - 3 == tree_data_size);
-  huffman.encoded_data_bits = encoded_data_bits;
-  for (uint16_t j = 0; j < encoded_data_size * 8; j += 8) {
-    std::bitset<8> tmp = data[i++];
-    for (uint16_t jj = 0; jj < 8; jj++) {
-      huffman.encoded_data.set(j + jj, tmp.test(jj));
+  int16_t symbols[64];
+  uint8_t length_counts[9] = { 0 };
+  uint8_t symbols_count;
+  const uint8_t i = parseDump(data, size, symbol_bits, encoded_data_bits, symbols, length_counts, symbols_count);
+  DecodeTable table;
+  buildDecodeTable(table, symbols, length_counts);
+  std::fill(res, res + 64, 0.0f);
+  uint8_t zigzag_index = 0;
+  uint8_t last_nonzero = 0;
+  uint32_t outside_4x4 = 0;
+  decodeFromTable(data + i, encoded_data_bits, table, [&](uint32_t k, int16_t ch) {
+    if (ch != 0) {
+      res[k] = static_cast<float>(ch) * scale[k];
+      last_nonzero = zigzag_index;
+      // row >= 4 or column >= 4
+      outside_4x4 |= k & 0x24;
     }
-  }
-  decodeFromTreeData(huffman.data, huffman.encoded_data, encoded_data_bits, huffman.tree_data);
+    zigzag_index++;
+  });
+  in_4x4 = outside_4x4 == 0;
+  return last_nonzero;
+}
+
+Huffman Huffman::fromDumpReference(const uint8_t* data, uint8_t size, uint8_t symbol_bits) {
+  Huffman huffman = loadDump(data, size, symbol_bits);
+  decodeFromTreeData(huffman.data, huffman.encoded_data, huffman.encoded_data_bits, huffman.symbols, huffman.length_counts);
   return huffman;
 }
 
 void Huffman::dump(uint8_t*& res_data, uint8_t& res_size) const {
-  assert(encoded_data_bits <= encoded_data.size());
-  const uint16_t encoded_data_size = divide_roundup<uint16_t>(encoded_data_bits, 8u);
-  res_size = 3 + encoded_data_size;
-  // figure out tree code size
-  for (const auto& it : tree_data) {
-    uint8_t ch_count = it.second.size();
-    assert(ch_count <= 64);
-    if (ch_count <= 32) {
-      res_size += 1 + divide_roundup(static_cast<unsigned>(ch_count) * 11u, 8u);
-    } else {
-      // more than 64 is not possible
-      res_size += 2 + 44 + divide_roundup(static_cast<unsigned>(ch_count - 32u) * 11u, 8u);
-    }
-  }
-  // begin
+  uint8_t dump_data[max_dump_size];
+  res_size = dumpTo(dump_data);
   res_data = new uint8_t[res_size];
-  uint8_t i = 0;
-  reinterpret_cast<uint16_t*>(res_data)[0] = encoded_data_bits;
+  std::copy(dump_data, dump_data + res_size, res_data);
+}
+
+uint8_t Huffman::dumpTo(uint8_t* res_data) const {
+  assert(encoded_data_bits <= sizeof(encoded_data) * 8);
+  const uint16_t encoded_data_size = divide_roundup<uint16_t>(encoded_data_bits, 8u);
+  uint32_t i = 0;
+  // dump slots of the arena are not aligned
+  std::memcpy(res_data, &encoded_data_bits, sizeof(encoded_data_bits));
   i += 2;
-  res_data[i++] = res_size - 3 - encoded_data_size;
-  for (const auto& it : tree_data) {
-    const std::vector<int16_t>& vector = it.second;
-    assert(vector.size() <= 64);
-    uint8_t ch_count = vector.size();
-    const uint8_t ch_length = it.first;
+  // tree size is written after the tree
+  i++;
+  const int16_t* symbol = symbols;
+  for (uint8_t ch_length = 1; ch_length <= 8; ch_length++) {
+    uint8_t ch_count = length_counts[ch_length];
+    if (ch_count == 0) {
+      continue;
+    }
     assert(ch_length <= 7);
-    std::vector<int16_t>::const_iterator vector_iter = vector.begin();
-tmp_label:
-    const uint8_t _ch_count = std::min<uint8_t>(ch_count, 32u);
-    res_data[i++] = ((ch_length - 1) << 5) | (_ch_count - 1);
-    pack11bit(res_data + i, vector_iter, _ch_count);
-    i += divide_roundup(static_cast<unsigned>(_ch_count) * 11u, 8u);
-    if (ch_count > 32) {
+    while (true) {
+      const uint8_t _ch_count = std::min<uint8_t>(ch_count, 32u);
+      res_data[i++] = ((ch_length - 1) << 5) | (_ch_count - 1);
+      i += packBits(res_data + i, symbol, _ch_count, symbol_bits);
+      symbol += _ch_count;
+      if (ch_count <= 32) {
+        break;
+      }
       ch_count -= 32;
-      goto tmp_label;
-    }
-  }
-  assert(i - 3 == res_size - 3 - encoded_data_size);
-  // pack encoded data
-  for (uint16_t j = 0; j < encoded_data_size * 8; j += 8) {
-    std::bitset<8> tmp;
-    for (uint16_t jj = 0; jj < 8; jj++) {
-      tmp.set(jj, encoded_data.test(j + jj));
     }
-    res_data[i++] = static_cast<uint8_t>(tmp.to_ulong());
   }
+  assert(symbol == symbols + symbols_count);
+  assert(i - 3 <= UINT8_MAX);
+  res_data[2] = static_cast<uint8_t>(i - 3);
+  assert(i + encoded_data_size <= max_dump_size);
+  std::copy(encoded_data, encoded_data + encoded_data_size, res_data + i);
+  return static_cast<uint8_t>(i + encoded_data_size);
 }
 
 void Huffman::getData(int16_t data[64]) const {
@@ -330,20 +470,32 @@ void Huffman::getData(int16_t data[64]) const {
 }
 
 bool Huffman::operator==(const Huffman& huffman) const noexcept {
-  assert(encoded_data_bits <= encoded_data.size());
-  assert(huffman.encoded_data_bits <= huffman.encoded_data.size());
+  assert(encoded_data_bits <= sizeof(encoded_data) * 8);
+  assert(huffman.encoded_data_bits <= sizeof(huffman.encoded_data) * 8);
   if (encoded_data_bits != huffman.encoded_data_bits) {
     return false;
   }
   if (!std::equal(data, data + 64, huffman.data)) {
     return false;
   }
-  const auto mask = ~std::bitset<512>() >> (encoded_data_bits); // constexpr since C++23
-  assert(mask.size() == encoded_data.size()); // just in case
-  if ((encoded_data & mask) != (huffman.encoded_data & mask)) {
+  // compare only encoded bits, padding of the last byte does not matter
+  const uint16_t full_bytes = encoded_data_bits / 8;
+  if (!std::equal(encoded_data, encoded_data + full_bytes, huffman.encoded_data)) {
+    return false;
+  }
+  if (encoded_data_bits % 8 != 0) {
+    const uint8_t last_mask = (1u << (encoded_data_bits % 8)) - 1;
+    if ((encoded_data[full_bytes] & last_mask) != (huffman.encoded_data[full_bytes] & last_mask)) {
+      return false;
+    }
+  }
+  if (symbols_count != huffman.symbols_count || symbol_bits != huffman.symbol_bits) {
+    return false;
+  }
+  if (!std::equal(length_counts, length_counts + 9, huffman.length_counts)) {
     return false;
   }
-  return tree_data == huffman.tree_data;
+  return std::equal(symbols, symbols + symbols_count, huffman.symbols);
 }
 
 bool Huffman::operator!=(const Huffman& huffman) const noexcept {
@@ -1,45 +1,9 @@
 #pragma once
 
 #include <cstdint>
-#include <memory>
-#include <vector>
-#include <map>
-#include <bitset>
 
 namespace myyuvDCT {
 
-/** 
-* @brief Tree node for the Huffman tree.
-*/
-struct HFMNode {
-  int16_t ch; /// Character that is stored in the node.
-  uint8_t freq; /// Frequency of a character.
-  std::shared_ptr<HFMNode> left; /// Left node in the Huffman tree.
-  std::shared_ptr<HFMNode> right; /// Right node in the Huffman tree.
-
-  /**
-  * @brief Constructor
-  * @param ch Character that is stored in the node.
-  * @param freq Frequency of a character.
-  * @param left Left node in the Huffman tree.
-  * @param right Right node in the Huffman tree.
-  */
-  HFMNode(int16_t ch = 0, uint8_t freq = 0, std::shared_ptr<HFMNode> left = nullptr, std::shared_ptr<HFMNode> right = nullptr) : ch(ch), freq(freq), left(left), right(right) {}
-  bool isLeaf() const noexcept {
-    return left == nullptr && right == nullptr;
-  }
-
-  /**
-  * @brief Struct that is used to compare nodes in priority queue. The nodes are compared by it's frequency of it's character.
-  * 
-  */
-  struct Compare {
-    inline bool operator()(const std::shared_ptr<HFMNode>& a, const std::shared_ptr<HFMNode>& b) const noexcept {
-      return a->freq > b->freq;
-    }
-  };
-};
-
 /**
 * @brief Class that handles Huffman coding for 8x8 matrix block.
 * @note Create objects only with `fromData` or `fromDump`.
@@ -58,19 +22,61 @@ public:
   */
   Huffman& operator=(Huffman&& huffman) noexcept;
 
+  /// Bits per tree character of 8-bit samples, coefficients range from -1024 to 1023.
+  static constexpr uint8_t default_symbol_bits = 11;
+
+  /// Largest bits per tree character, enough for coefficients of 12-bit samples.
+  static constexpr uint8_t max_symbol_bits = 15;
+
   /**
   * @brief Constructs object from 8x8 matrix block.
   * @param data 8x8 matrix in a vector form.
+  * @param symbol_bits Bits per tree character, coefficients must fit it as signed numbers.
   * @return Constructed Huffman object.
   */
-  static Huffman fromData(const int16_t data[64]);
+  static Huffman fromData(const int16_t data[64], uint8_t symbol_bits = default_symbol_bits);
+
+  /**
+  * @brief Dumps 8x8 matrix block that has only DC coefficient without building the tree.
+  * @note The dump is the same as of `fromData` and `dumpTo` with such block.
+  * @param dc DC coefficient.
+  * @param[out] res_data Object dump, at least `max_dump_size` bytes.
+  * @param symbol_bits Bits per tree character.
+  * @return Object dump size in bytes.
+  */
+  static uint8_t dumpDC(int16_t dc, uint8_t* res_data, uint8_t symbol_bits = default_symbol_bits);
 
   /**
   * @brief Constructs object from it's dump.
   * @param data Dump data.
+  * @param symbol_bits Bits per tree character, the same as of the dumped object.
   * @return Dump data in bytes.
   */
-  static Huffman fromDump(const uint8_t* data, uint8_t size);
+  static Huffman fromDump(const uint8_t* data, uint8_t size, uint8_t symbol_bits = default_symbol_bits);
+
+  /**
+  * @brief Constructs object from it's dump with the reference decoder that walks the code tree bit by bit.
+  * @note Slow, useful in testing and benchmarks.
+  * @param data Dump data.
+  * @param size Dump data size in bytes.
+  * @param symbol_bits Bits per tree character, the same as of the dumped object.
+  * @return Constructed Huffman object.
+  * @see fromDump
+  */
+  static Huffman fromDumpReference(const uint8_t* data, uint8_t size, uint8_t symbol_bits = default_symbol_bits);
+
+  /**
+  * @brief Decodes 8x8 matrix block from dump straight into dequantized coefficients, without constructing Huffman object.
+  * @param data Dump data.
+  * @param size Dump data size in bytes.
+  * @param scale Dequantization table, each coefficient is multiplied by it.
+  * @param[out] res Dequantized coefficients in a vector form.
+  * @param[out] in_4x4 `true` if all nonzero coefficients are in the top-left 4x4 of the matrix.
+  * @param symbol_bits Bits per tree character, the same as of the dumped object.
+  * @return Zigzag index of the last nonzero coefficient, 0 if there is only DC coefficient or none.
+  * @see fromDump
+  */
+  static uint8_t decodeDump(const uint8_t* data, uint8_t size, const float scale[64], float res[64], bool& in_4x4, uint8_t symbol_bits = default_symbol_bits);
 
   /**
   * @brief Dumps object to `res_data` with `res_size` in bytes.
@@ -79,6 +85,16 @@ public:
   */
   void dump(uint8_t*& res_data, uint8_t& res_size) const;
 
+  /**
+  * @brief Dumps object to a buffer owned by the caller.
+  * @param[out] res_data Object dump, at least `max_dump_size` bytes.
+  * @return Object dump size in bytes.
+  */
+  uint8_t dumpTo(uint8_t* res_data) const;
+
+  /// Upper bound of object dump size in bytes.
+  static constexpr uint32_t max_dump_size = UINT8_MAX;
+
   /**
   * @brief Get 8x8 matrix block.
   * @param[out] data Dumps matrix to this array in a vector form.
@@ -101,17 +117,32 @@ public:
   */
   bool operator!=(const Huffman& huffman) const noexcept;
 protected:
-  friend struct HFMNode;
   /// Default constructor is not allowed, use `fromData` and `fromDump`
   Huffman() {}
 
+  /**
+  * @brief Loads tree and encoded data from dump without decoding the matrix.
+  * @param data Dump data.
+  * @param size Dump data size in bytes.
+  * @param symbol_bits Bits per tree character.
+  * @return Huffman object with empty matrix.
+  */
+  static Huffman loadDump(const uint8_t* data, uint8_t size, uint8_t symbol_bits);
+
   /// matrix 8x8 in a vector form
   int16_t data[64] = { 0 };
   uint16_t encoded_data_bits = 0;
-  std::bitset<512> encoded_data;
-
-  /// map<code_length, vector<character>>
-  std::map<uint8_t, std::vector<int16_t>> tree_data;
+  /// Encoded matrix as LSB first bit stream, the same as in dump.
+  uint8_t encoded_data[64] = { 0 };
+
+  /// Characters sorted by code length and then by value, which is the order of canonical codes.
+  int16_t symbols[64] = { 0 };
+  /// Amount of characters for each code length (1..8), index 0 is unused.
+  uint8_t length_counts[9] = { 0 };
+  /// Amount of characters in `symbols`.
+  uint8_t symbols_count = 0;
+  /// Bits per character in the dumped tree.
+  uint8_t symbol_bits = default_symbol_bits;
 };
 
 } // myyuvDCT
@@ -0,0 +1,181 @@
+#include "myyuv_allocator.hpp"
+
+#include <atomic>
+#include <new>
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#if defined(_WIN32)
+#include <malloc.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+// Huge page size of x86-64 and most of aarch64 configurations
+static constexpr const size_t huge_page_size = size_t(2) << 20;
+static constexpr const size_t page_size = 4096;
+
+/**
+* Prefix of every buffer of `allocateBuffer`, keeps the allocator to give the buffer back to.
+* It takes a whole alignment unit, so the buffer after it stays aligned.
+*/
+struct alignas(myyuv::Allocator::alignment) BufferPrefix {
+  myyuv::Allocator* allocator;
+  size_t size;
+};
+static_assert(sizeof(BufferPrefix) == myyuv::Allocator::alignment, "Buffer prefix must keep the alignment");
+
+static std::atomic<myyuv::Allocator*>& currentAllocator() noexcept {
+  static std::atomic<myyuv::Allocator*> allocator(&myyuv::getDefaultAllocator());
+  return allocator;
+}
+
+} // namespace
+
+namespace myyuv {
+
+AllocatorStats Allocator::getStats() const {
+  return {};
+}
+
+PoolAllocator::PoolAllocator(size_t max_cached_bytes, size_t huge_page_threshold) : max_cached_bytes(max_cached_bytes), huge_page_threshold(huge_page_threshold) {}
+
+PoolAllocator::~PoolAllocator() {
+  trim();
+}
+
+size_t PoolAllocator::sizeClass(size_t size) noexcept {
+  if (size <= alignment) {
+    return alignment;
+  }
+  size_t pow2 = alignment;
+  while (pow2 < size) {
+    pow2 *= 2;
+  }
+  const size_t step = std::max(alignment, pow2 / 8);
+  return (size + step - 1) / step * step;
+}
+
+void* PoolAllocator::systemAllocate(size_t class_size) {
+  const bool huge = huge_page_threshold > 0 && class_size >= huge_page_threshold;
+  const size_t buffer_alignment = huge ? huge_page_size : alignment;
+  void* ptr = nullptr;
+#if defined(_WIN32)
+  ptr = _aligned_malloc(class_size, buffer_alignment);
+#else
+  if (posix_memalign(&ptr, buffer_alignment, class_size) != 0) {
+    ptr = nullptr;
+  }
+#endif
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+#if defined(MADV_HUGEPAGE)
+  if (huge) {
+    // Only a hint, failure is not an error
+    if (::madvise(ptr, class_size / page_size * page_size, MADV_HUGEPAGE) == 0) {
+      stats.huge_page_buffers++;
+    }
+  }
+#endif
+  return ptr;
+}
+
+void PoolAllocator::systemFree(void* ptr) noexcept {
+#if defined(_WIN32)
+  _aligned_free(ptr);
+#else
+  std::free(ptr);
+#endif
+}
+
+void* PoolAllocator::allocate(size_t size) {
+  const size_t class_size = sizeClass(size);
+  std::lock_guard<std::mutex> lock(mutex);
+  void* ptr = nullptr;
+  auto it = free_lists.find(class_size);
+  if (it != free_lists.end() && !it->second.empty()) {
+    ptr = it->second.back();
+    it->second.pop_back();
+    stats.bytes_cached -= class_size;
+    stats.pool_hits++;
+  } else {
+    ptr = systemAllocate(class_size);
+  }
+  stats.allocations++;
+  stats.bytes_in_use += class_size;
+  stats.peak_bytes_in_use = std::max(stats.peak_bytes_in_use, stats.bytes_in_use);
+  return ptr;
+}
+
+void PoolAllocator::deallocate(void* ptr, size_t size) noexcept {
+  if (ptr == nullptr) {
+    return;
+  }
+  const size_t class_size = sizeClass(size);
+  std::lock_guard<std::mutex> lock(mutex);
+  assert(stats.bytes_in_use >= class_size);
+  stats.deallocations++;
+  stats.bytes_in_use -= class_size;
+  if (stats.bytes_cached + class_size <= max_cached_bytes) {
+    try {
+      free_lists[class_size].push_back(ptr);
+      stats.bytes_cached += class_size;
+      return;
+    } catch (...) {
+      // no memory for the free list, the buffer is freed
+    }
+  }
+  systemFree(ptr);
+}
+
+AllocatorStats PoolAllocator::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return stats;
+}
+
+void PoolAllocator::trim() noexcept {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto& it : free_lists) {
+    for (void* ptr : it.second) {
+      systemFree(ptr);
+    }
+  }
+  free_lists.clear();
+  stats.bytes_cached = 0;
+}
+
+Allocator& getAllocator() noexcept {
+  return *currentAllocator().load(std::memory_order_acquire);
+}
+
+void setAllocator(Allocator* allocator) noexcept {
+  currentAllocator().store(allocator != nullptr ? allocator : &getDefaultAllocator(), std::memory_order_release);
+}
+
+PoolAllocator& getDefaultAllocator() noexcept {
+  // Never destroyed, so images in static storage can be destroyed in any order
+  static PoolAllocator* allocator = new PoolAllocator();
+  return *allocator;
+}
+
+uint8_t* allocateBuffer(size_t size) {
+  Allocator& allocator = getAllocator();
+  const size_t total_size = sizeof(BufferPrefix) + size;
+  void* ptr = allocator.allocate(total_size);
+  assert(reinterpret_cast<uintptr_t>(ptr) % Allocator::alignment == 0);
+  BufferPrefix* prefix = new (ptr) BufferPrefix{ &allocator, total_size };
+  return reinterpret_cast<uint8_t*>(prefix + 1);
+}
+
+void freeBuffer(uint8_t* data) noexcept {
+  if (data == nullptr) {
+    return;
+  }
+  BufferPrefix* prefix = reinterpret_cast<BufferPrefix*>(data) - 1;
+  prefix->allocator->deallocate(prefix, prefix->size);
+}
+
+} // myyuv
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <vector>
+
+namespace myyuv {
+
+/**
+* @brief Allocation statistics.
+*/
+struct AllocatorStats {
+  uint64_t allocations = 0; /// Buffers handed out.
+  uint64_t deallocations = 0; /// Buffers given back.
+  uint64_t pool_hits = 0; /// Allocations served by cached buffers without asking the system.
+  uint64_t huge_page_buffers = 0; /// System allocations advised to be backed by huge pages.
+  uint64_t bytes_in_use = 0; /// Bytes of buffers handed out and not given back yet.
+  uint64_t peak_bytes_in_use = 0; /// Maximum of `bytes_in_use`.
+  uint64_t bytes_cached = 0; /// Bytes of given back buffers that are kept for reuse.
+};
+
+/**
+* @brief Interface of allocator for image storage (`YUV::data`, `BMP::data`, DCT buffers).
+* @see setAllocator
+*/
+class Allocator {
+public:
+  /**
+  * @brief Alignment of every buffer, enough for aligned loads of any SIMD level and a cache line.
+  */
+  static constexpr const size_t alignment = 64;
+
+  virtual ~Allocator() = default;
+
+  /**
+  * @brief Allocates a buffer.
+  * @param size Buffer size in bytes.
+  * @return Buffer of at least `size` bytes aligned to `alignment`.
+  * @throws std::bad_alloc if there is not enough memory.
+  */
+  virtual void* allocate(size_t size) = 0;
+
+  /**
+  * @brief Gives back a buffer of `allocate`.
+  * @param ptr Buffer.
+  * @param size The same size as passed to `allocate`.
+  */
+  virtual void deallocate(void* ptr, size_t size) noexcept = 0;
+
+  /**
+  * @brief Get allocation statistics.
+  * @note Allocators that don't track statistics return zeros.
+  * @return Statistics.
+  */
+  virtual AllocatorStats getStats() const;
+};
+
+/**
+* @brief Default allocator: a pool of aligned buffers grouped in size classes.
+* @details Sizes are rounded up to one of 8 classes per power of 2, so a class wastes at most 1/8 of a buffer.
+* Given back buffers are kept in free lists of their class and reused, the amount of kept bytes is limited.
+* Buffers of at least `huge_page_threshold` bytes are aligned to huge pages and advised to be backed by them where it's supported (Linux transparent huge pages).
+* @note Thread safe.
+*/
+class PoolAllocator : public Allocator {
+public:
+  /**
+  * @brief Default limit of cached bytes.
+  */
+  static constexpr const size_t default_max_cached_bytes = size_t(256) << 20;
+
+  /**
+  * @brief Default size of buffers backed by huge pages, the size of a huge page. Every frame of 4K resolution is above it.
+  */
+  static constexpr const size_t default_huge_page_threshold = size_t(2) << 20;
+
+  /**
+  * @brief Constructor.
+  * @param max_cached_bytes Limit of cached bytes, `0` disables caching.
+  * @param huge_page_threshold Minimum size of buffers backed by huge pages, `0` disables huge pages.
+  */
+  explicit PoolAllocator(size_t max_cached_bytes = default_max_cached_bytes, size_t huge_page_threshold = default_huge_page_threshold);
+
+  /**
+  * @brief Destructor. Frees cached buffers.
+  * @warning Buffers that are still in use must not be given back after that.
+  */
+  ~PoolAllocator() override;
+
+  PoolAllocator(const PoolAllocator&) = delete;
+  PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+  void* allocate(size_t size) override;
+  void deallocate(void* ptr, size_t size) noexcept override;
+  AllocatorStats getStats() const override;
+
+  /**
+  * @brief Frees cached buffers.
+  */
+  void trim() noexcept;
+
+  /**
+  * @brief Get size of the class that a buffer of `size` bytes belongs to.
+  * @param size Buffer size in bytes.
+  * @return Class size in bytes, at least `size` and a multiple of `alignment`.
+  */
+  static size_t sizeClass(size_t size) noexcept;
+private:
+  void* systemAllocate(size_t class_size);
+  void systemFree(void* ptr) noexcept;
+
+  const size_t max_cached_bytes;
+  const size_t huge_page_threshold;
+  mutable std::mutex mutex;
+  // Free buffers by class size
+  std::map<size_t, std::vector<void*>> free_lists;
+  AllocatorStats stats;
+};
+
+/**
+* @brief Get allocator that is currently used for new image buffers.
+* @note Defaults to `getDefaultAllocator()`.
+* @return Current allocator.
+*/
+Allocator& getAllocator() noexcept;
+
+/**
+* @brief Set allocator that will be used for new image buffers.
+* @note Buffers remember their allocator, so buffers allocated before the change are given back to the previous allocator.
+* @warning The allocator must outlive every buffer allocated by it.
+* @param allocator Requested allocator. `nullptr` resets it to `getDefaultAllocator()`.
+*/
+void setAllocator(Allocator* allocator) noexcept;
+
+/**
+* @brief Get the default pool allocator.
+* @return Default allocator.
+*/
+PoolAllocator& getDefaultAllocator() noexcept;
+
+/**
+* @brief Allocates image buffer with the current allocator.
+* @param size Buffer size in bytes.
+* @return Buffer aligned to `Allocator::alignment`. Free it with `freeBuffer`.
+* @throws std::bad_alloc if there is not enough memory.
+*/
+uint8_t* allocateBuffer(size_t size);
+
+/**
+* @brief Gives image buffer back to the allocator it was allocated with.
+* @param data Buffer of `allocateBuffer` or `nullptr`.
+*/
+void freeBuffer(uint8_t* data) noexcept;
+
+/**
+* @brief Deleter of `BufferPtr`.
+*/
+struct BufferDeleter {
+  void operator()(uint8_t* data) const noexcept {
+    freeBuffer(data);
+  }
+};
+
+/**
+* @brief Owning pointer to image buffer of `allocateBuffer`.
+*/
+using BufferPtr = std::unique_ptr<uint8_t[], BufferDeleter>;
+
+} // myyuv
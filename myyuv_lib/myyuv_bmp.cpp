@@ -1,5 +1,6 @@
 #include "myyuv_bmp.hpp"
 
+#include "myyuv_allocator.hpp"
 #include <fstream>
 #include <stdexcept>
 #include <cassert>
@@ -21,7 +22,7 @@ BMP& BMP::operator=(const BMP& bmp) {
   if (bmp.data != nullptr) {
     try { // just in case
       if (data == nullptr || tmp_image_size > imageSize()) { // I think it's better this way instead of `bmp.image_size != image_size`
-        new_data = new uint8_t[tmp_image_size];
+        new_data = allocateBuffer(tmp_image_size);
       } else {
         new_data = data;
       }
@@ -32,7 +33,7 @@ BMP& BMP::operator=(const BMP& bmp) {
       //}
     } catch (...) {
       if (new_data != data) {
-        delete[] new_data;
+        freeBuffer(new_data);
       }
       throw;
     }
@@ -41,7 +42,7 @@ BMP& BMP::operator=(const BMP& bmp) {
   //  data = nullptr;
   //}
   if (new_data != data || new_data == nullptr) {
-    delete[] data;
+    freeBuffer(data);
     data = new_data;
   }
   header = bmp.header;
@@ -61,7 +62,7 @@ BMP& BMP::operator=(BMP&& bmp) noexcept {
 }
 
 BMP::~BMP() {
-  delete[] data;
+  freeBuffer(data);
 }
 
 uint32_t BMP::trueWidth() const noexcept {
@@ -102,6 +103,20 @@ uint8_t* BMP::colorData() const {
   return res;
 }
 
+const uint8_t* BMP::colorRow(uint32_t row) const {
+  assert(isValid());
+  assert(row < trueHeight());
+  if (header.width < 0) {
+    throw std::runtime_error("Can't get color row of mirrored BMP");
+  }
+  const uint32_t stride = trueWidth() * header.bit_count / 8;
+  if (header.height > 0) {
+    return data + stride * (trueHeight() - row - 1);
+  } else {
+    return data + stride * row;
+  }
+}
+
 uint8_t* BMP::colorDataFlipped() const {
   if (!isValid()) {
     throw std::runtime_error("BMP data is invalid");
@@ -161,7 +176,7 @@ void BMP::load(const std::string& path) {
   if (!res.isValidHeader()) {
     throw std::runtime_error("Error bad header " + path);
   }
-  res.data = new uint8_t[res_image_size];
+  res.data = allocateBuffer(res_image_size);
   f.read(reinterpret_cast<char*>(res.data), res_image_size);
   assert(res.isValid());
   std::swap(*this, res);
@@ -47,7 +47,7 @@ struct BMPColorHeader {
 * @brief Class that represents BMP (RGB[A]) image.
 * @var header BMP file header (file header and info header).
 * @var color_header BMP color header.
-* @var data Image data.
+* @var data Image data. Allocated with `allocateBuffer` and owned by the image.
 */
 class BMP {
 public:
@@ -119,6 +119,15 @@ public:
   */
   uint8_t* colorData() const;
 
+  /**
+  * @brief Get pointer to color data row with top-left origin without copying.
+  * @note Rows are read in their stored order, works for both positive and negative height.
+  * @warning Mirrored images (negative width) are not supported, use `colorData` instead.
+  * @param row Row index from the top.
+  * @return Pointer to the row in `data`.
+  */
+  const uint8_t* colorRow(uint32_t row) const;
+
   /**
   * @brief Get color data with bottom-left origin.
   * @note Free the allocated memory with `delete[]`.
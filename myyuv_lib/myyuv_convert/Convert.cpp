@@ -0,0 +1,1510 @@
+#include "Convert.hpp"
+
+#include "myyuv_simd.hpp"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace {
+
+// https://stackoverflow.com/a/58568736
+template <typename T>
+static T divide_roundnearest(T numer, T denom) noexcept {
+  static_assert(std::numeric_limits<T>::is_integer, "Only integer types are allowed");
+
+  T result = ((numer) < 0) != ((denom) < 0) ?
+    ((numer) - ((denom)/2)) / (denom) :
+    ((numer) + ((denom)/2)) / (denom);
+  return result;
+}
+
+// https://stackoverflow.com/a/36835959
+static inline constexpr unsigned char operator"" _uchar(unsigned long long arg) noexcept {
+  return static_cast<unsigned char>(arg);
+}
+
+static inline void getYUV444FromRGB(uint8_t yuv444[3], const uint8_t* rgb) noexcept {
+  const float B = static_cast<float>(rgb[0]);
+  const float G = static_cast<float>(rgb[1]);
+  const float R = static_cast<float>(rgb[2]);
+  const float Y = 0.299f * R + 0.587f * G + 0.114f * B;
+  yuv444[0] = static_cast<uint8_t>(Y); // Y
+  yuv444[1] = static_cast<uint8_t>((B - Y) * 0.564f) + 128; // Cb
+  yuv444[2] = static_cast<uint8_t>((R - Y) * 0.713f) + 128; // Cr
+}
+
+static inline void getYUV444FromRGB2x2(uint8_t yuv444[12], const uint8_t* rgb_top, const uint8_t* rgb_bottom) noexcept {
+  constexpr const uint32_t pixel_bytes = 4;
+  const uint8_t* locs[4] = { rgb_top, rgb_top + pixel_bytes, rgb_bottom, rgb_bottom + pixel_bytes };
+  for (uint32_t jj = 0; jj < 4; jj++) {
+    getYUV444FromRGB(yuv444 + jj * 3, locs[jj]);
+  }
+}
+
+// Sum of rounded quarters saturates at 255 (4 samples of 254+ would overflow uint8_t).
+static inline uint8_t averageQuarters(uint8_t a, uint8_t b, uint8_t c, uint8_t d) noexcept {
+  const uint32_t sum = static_cast<uint32_t>(divide_roundnearest(a, 4_uchar)) + divide_roundnearest(b, 4_uchar) + divide_roundnearest(c, 4_uchar) + divide_roundnearest(d, 4_uchar);
+  return static_cast<uint8_t>(std::min<uint32_t>(sum, UINT8_MAX));
+}
+
+// High bit depth samples are the same conversion scaled by `2^(bits - 8)` before truncation, so they keep the extra precision.
+static inline void getYUV444FromRGB(uint16_t yuv444[3], const uint8_t* rgb, uint32_t bits) noexcept {
+  const float B = static_cast<float>(rgb[0]);
+  const float G = static_cast<float>(rgb[1]);
+  const float R = static_cast<float>(rgb[2]);
+  const float Y = 0.299f * R + 0.587f * G + 0.114f * B;
+  const float scale = static_cast<float>(1u << (bits - 8));
+  const int32_t bias = 128 << (bits - 8);
+  yuv444[0] = static_cast<uint16_t>(Y * scale); // Y
+  yuv444[1] = static_cast<uint16_t>(static_cast<int32_t>((B - Y) * 0.564f * scale) + bias); // Cb
+  yuv444[2] = static_cast<uint16_t>(static_cast<int32_t>((R - Y) * 0.713f * scale) + bias); // Cr
+}
+
+// Sum of rounded quarters saturates at `max`.
+static inline uint16_t averageQuarters(uint16_t a, uint16_t b, uint16_t c, uint16_t d, uint16_t max) noexcept {
+  const uint32_t sum = static_cast<uint32_t>(divide_roundnearest<uint16_t>(a, 4)) + divide_roundnearest<uint16_t>(b, 4) + divide_roundnearest<uint16_t>(c, 4) + divide_roundnearest<uint16_t>(d, 4);
+  return static_cast<uint16_t>(std::min<uint32_t>(sum, max));
+}
+
+// RGB kernels are specialized on `Rows`: 2 for 4:2:0 (chroma of 2x2 pixels), 1 for 4:2:2 (chroma of 2x1 pixels).
+// A single row counts twice in the chroma average, so 4:2:2 chroma is 4:2:0 chroma of the row repeated.
+
+// Reference implementation
+template <uint32_t Rows>
+static void rgb_to_yuv_rows_scalar(const uint8_t* rgb_top, const uint8_t* rgb_bottom, uint8_t* y_top, uint8_t* y_bottom, uint8_t* u, uint8_t* v, uint32_t width) noexcept {
+  static_assert(Rows == 1 || Rows == 2, "Only 1 or 2 rows");
+  for (uint32_t i = 0; i < width; i += 2) {
+    uint8_t yuv444[12];
+    getYUV444FromRGB2x2(yuv444, rgb_top + i * 4, (Rows == 2 ? rgb_bottom : rgb_top) + i * 4);
+    y_top[i] = yuv444[0];
+    y_top[i + 1] = yuv444[3];
+    if (Rows == 2) {
+      y_bottom[i] = yuv444[6];
+      y_bottom[i + 1] = yuv444[9];
+    }
+    u[i / 2] = averageQuarters(yuv444[1], yuv444[4], yuv444[7], yuv444[10]);
+    v[i / 2] = averageQuarters(yuv444[2], yuv444[5], yuv444[8], yuv444[11]);
+  }
+}
+
+// Reference implementation of high bit depth 4:2:0, samples of `bits` bits are stored shifted left by `shift`
+static void rgb_to_iyuv_rows_scalar(const uint8_t* rgb_top, const uint8_t* rgb_bottom, uint16_t* y_top, uint16_t* y_bottom, uint16_t* u, uint16_t* v, uint32_t width, uint32_t bits, uint32_t shift) noexcept {
+  const uint16_t max = static_cast<uint16_t>((1u << bits) - 1);
+  for (uint32_t i = 0; i < width; i += 2) {
+    uint16_t yuv444[12];
+    const uint8_t* locs[4] = { rgb_top + i * 4, rgb_top + i * 4 + 4, rgb_bottom + i * 4, rgb_bottom + i * 4 + 4 };
+    for (uint32_t jj = 0; jj < 4; jj++) {
+      getYUV444FromRGB(yuv444 + jj * 3, locs[jj], bits);
+    }
+    y_top[i] = static_cast<uint16_t>(yuv444[0] << shift);
+    y_top[i + 1] = static_cast<uint16_t>(yuv444[3] << shift);
+    y_bottom[i] = static_cast<uint16_t>(yuv444[6] << shift);
+    y_bottom[i + 1] = static_cast<uint16_t>(yuv444[9] << shift);
+    u[i / 2] = static_cast<uint16_t>(averageQuarters(yuv444[1], yuv444[4], yuv444[7], yuv444[10], max) << shift);
+    v[i / 2] = static_cast<uint16_t>(averageQuarters(yuv444[2], yuv444[5], yuv444[8], yuv444[11], max) << shift);
+  }
+}
+
+// Reference implementation of 4:4:4, chroma of every pixel
+static void rgb_to_yuv444_row_scalar(const uint8_t* rgb, uint8_t* y, uint8_t* u, uint8_t* v, uint32_t width) noexcept {
+  for (uint32_t i = 0; i < width; i++) {
+    uint8_t yuv444[3];
+    getYUV444FromRGB(yuv444, rgb + i * 4);
+    y[i] = yuv444[0];
+    u[i] = yuv444[1];
+    v[i] = yuv444[2];
+  }
+}
+
+// Unused X byte is 0
+static void bgr_to_bgrx_row_scalar(const uint8_t* bgr, uint8_t* bgrx, uint32_t width) noexcept {
+  for (uint32_t i = 0; i < width; i++) {
+    bgrx[i * 4] = bgr[i * 3];
+    bgrx[i * 4 + 1] = bgr[i * 3 + 1];
+    bgrx[i * 4 + 2] = bgr[i * 3 + 2];
+    bgrx[i * 4 + 3] = 0;
+  }
+}
+
+template <typename T>
+static void interleave_uv_row_scalar(const T* u, const T* v, T* uv, uint32_t width) noexcept {
+  for (uint32_t i = 0; i < width; i++) {
+    uv[2 * i] = u[i];
+    uv[2 * i + 1] = v[i];
+  }
+}
+
+template <typename T>
+static void deinterleave_uv_row_scalar(const T* uv, T* u, T* v, uint32_t width) noexcept {
+  for (uint32_t i = 0; i < width; i++) {
+    u[i] = uv[2 * i];
+    v[i] = uv[2 * i + 1];
+  }
+}
+
+// Packed 4:2:2 macropixel of 2 pixels is Y0 C0 Y1 C1, or C0 Y0 C1 Y1 if `chroma_first`
+
+static void pack_yuv422_row_scalar(const uint8_t* y, const uint8_t* c0, const uint8_t* c1, uint8_t* packed, uint32_t width, bool chroma_first) noexcept {
+  const uint32_t y_offset = chroma_first ? 1 : 0;
+  const uint32_t c_offset = 1 - y_offset;
+  for (uint32_t i = 0; i < width; i += 2) {
+    uint8_t* macropixel = packed + 2 * i;
+    macropixel[y_offset] = y[i];
+    macropixel[y_offset + 2] = y[i + 1];
+    macropixel[c_offset] = c0[i / 2];
+    macropixel[c_offset + 2] = c1[i / 2];
+  }
+}
+
+// `Average` unpacks two rows and averages their chroma (4:2:0), otherwise unpacks `top` only
+template <bool Average>
+static void unpack_yuv422_rows_scalar(const uint8_t* top, const uint8_t* bottom, uint8_t* y_top, uint8_t* y_bottom, uint8_t* c0, uint8_t* c1, uint32_t width, bool chroma_first) noexcept {
+  const uint32_t y_offset = chroma_first ? 1 : 0;
+  const uint32_t c_offset = 1 - y_offset;
+  for (uint32_t i = 0; i < width; i += 2) {
+    const uint8_t* t = top + 2 * i;
+    y_top[i] = t[y_offset];
+    y_top[i + 1] = t[y_offset + 2];
+    if (Average) {
+      const uint8_t* b = bottom + 2 * i;
+      y_bottom[i] = b[y_offset];
+      y_bottom[i + 1] = b[y_offset + 2];
+      c0[i / 2] = static_cast<uint8_t>((t[c_offset] + b[c_offset] + 1) / 2);
+      c1[i / 2] = static_cast<uint8_t>((t[c_offset + 2] + b[c_offset + 2] + 1) / 2);
+    } else {
+      c0[i / 2] = t[c_offset];
+      c1[i / 2] = t[c_offset + 2];
+    }
+  }
+}
+
+// Chroma resampling: downsampling averages neighbours, upsampling interpolates between neighbours with 3/4 and 1/4 weights,
+// so samples stay centered between the pixels they cover like the averaged chroma of RGB conversion.
+
+static void swap_uv_row_scalar(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept {
+  for (uint32_t i = 0; i < width; i++) {
+    const uint8_t first = src[2 * i];
+    dst[2 * i] = src[2 * i + 1];
+    dst[2 * i + 1] = first;
+  }
+}
+
+static void shift_samples_row_scalar(const uint16_t* src, uint16_t* dst, uint32_t count, int32_t shift) noexcept {
+  for (uint32_t i = 0; i < count; i++) {
+    dst[i] = static_cast<uint16_t>(shift >= 0 ? src[i] << shift : src[i] >> -shift);
+  }
+}
+
+static void widen_samples_row_scalar(const uint8_t* src, uint16_t* dst, uint32_t count, uint32_t shift) noexcept {
+  for (uint32_t i = 0; i < count; i++) {
+    dst[i] = static_cast<uint16_t>(src[i] << shift);
+  }
+}
+
+static void narrow_samples_row_scalar(const uint16_t* src, uint8_t* dst, uint32_t count, uint32_t shift) noexcept {
+  for (uint32_t i = 0; i < count; i++) {
+    dst[i] = static_cast<uint8_t>(std::min<uint32_t>(src[i] >> shift, 255));
+  }
+}
+
+static void average_rows_scalar(const uint8_t* a, const uint8_t* b, uint8_t* dst, uint32_t width) noexcept {
+  for (uint32_t i = 0; i < width; i++) {
+    dst[i] = static_cast<uint8_t>((a[i] + b[i] + 1) >> 1);
+  }
+}
+
+static void average_pairs_row_scalar(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept {
+  for (uint32_t i = 0; i < width; i++) {
+    dst[i] = static_cast<uint8_t>((src[2 * i] + src[2 * i + 1] + 1) >> 1);
+  }
+}
+
+static inline uint8_t lerpQuarter(uint8_t near, uint8_t far) noexcept {
+  return static_cast<uint8_t>((3 * near + far + 2) >> 2);
+}
+
+static void lerp_rows_scalar(const uint8_t* near, const uint8_t* far, uint8_t* dst, uint32_t width) noexcept {
+  for (uint32_t i = 0; i < width; i++) {
+    dst[i] = lerpQuarter(near[i], far[i]);
+  }
+}
+
+// Samples from `begin` to `end` of a row of `width` samples, edges are clamped
+static void upsample_pairs_row_scalar(const uint8_t* src, uint8_t* dst, uint32_t begin, uint32_t end, uint32_t width) noexcept {
+  for (uint32_t i = begin; i < end; i++) {
+    dst[2 * i] = lerpQuarter(src[i], src[i > 0 ? i - 1 : 0]);
+    dst[2 * i + 1] = lerpQuarter(src[i], src[i + 1 < width ? i + 1 : i]);
+  }
+}
+
+#ifdef MYYUV_X86
+
+// Packed 4:2:2: 16 pixels per iteration for SSE2, 32 pixels for AVX2.
+// 16 pixels are one row of a 16x8 luma block and its 8x8 chroma blocks.
+
+MYYUV_TARGET("sse2")
+static void pack_yuv422_row_sse2(const uint8_t* y, const uint8_t* c0, const uint8_t* c1, uint8_t* packed, uint32_t width, bool chroma_first) noexcept {
+  uint32_t i = 0;
+  for (; i + 16 <= width; i += 16) {
+    const __m128i y16 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i));
+    const __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(c0 + i / 2)), _mm_loadl_epi64(reinterpret_cast<const __m128i*>(c1 + i / 2)));
+    const __m128i lo = chroma_first ? _mm_unpacklo_epi8(c, y16) : _mm_unpacklo_epi8(y16, c);
+    const __m128i hi = chroma_first ? _mm_unpackhi_epi8(c, y16) : _mm_unpackhi_epi8(y16, c);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(packed + 2 * i), lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(packed + 2 * i + 16), hi);
+  }
+  if (i < width) {
+    pack_yuv422_row_scalar(y + i, c0 + i / 2, c1 + i / 2, packed + 2 * i, width - i, chroma_first);
+  }
+}
+
+// Splits 16 packed pixels: stores luma and returns chroma pairs
+MYYUV_TARGET("sse2")
+static inline __m128i splitYUV422(const uint8_t* packed, uint8_t* y, bool chroma_first) noexcept {
+  const __m128i mask = _mm_set1_epi16(0x00ff);
+  const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(packed));
+  const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(packed + 16));
+  const __m128i even = _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+  const __m128i odd = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(y), chroma_first ? odd : even);
+  return chroma_first ? even : odd;
+}
+
+template <bool Average>
+MYYUV_TARGET("sse2")
+static void unpack_yuv422_rows_sse2(const uint8_t* top, const uint8_t* bottom, uint8_t* y_top, uint8_t* y_bottom, uint8_t* c0, uint8_t* c1, uint32_t width, bool chroma_first) noexcept {
+  const __m128i mask = _mm_set1_epi16(0x00ff);
+  uint32_t i = 0;
+  for (; i + 16 <= width; i += 16) {
+    __m128i c = splitYUV422(top + 2 * i, y_top + i, chroma_first);
+    if (Average) {
+      c = _mm_avg_epu8(c, splitYUV422(bottom + 2 * i, y_bottom + i, chroma_first));
+    }
+    const __m128i c8 = _mm_packus_epi16(_mm_and_si128(c, mask), _mm_srli_epi16(c, 8));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(c0 + i / 2), c8);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(c1 + i / 2), _mm_srli_si128(c8, 8));
+  }
+  if (i < width) {
+    unpack_yuv422_rows_scalar<Average>(top + 2 * i, Average ? bottom + 2 * i : nullptr, y_top + i, Average ? y_bottom + i : nullptr, c0 + i / 2, c1 + i / 2, width - i, chroma_first);
+  }
+}
+
+MYYUV_TARGET("avx2")
+static void pack_yuv422_row_avx2(const uint8_t* y, const uint8_t* c0, const uint8_t* c1, uint8_t* packed, uint32_t width, bool chroma_first) noexcept {
+  uint32_t i = 0;
+  for (; i + 32 <= width; i += 32) {
+    const __m128i c0_16 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c0 + i / 2));
+    const __m128i c1_16 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c1 + i / 2));
+    const __m256i c = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi8(c0_16, c1_16)), _mm_unpackhi_epi8(c0_16, c1_16), 1);
+    // unpack works within 128-bit lanes, so 64-bit quarters are put in order first
+    const __m256i y32 = _mm256_permute4x64_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i)), _MM_SHUFFLE(3, 1, 2, 0));
+    const __m256i c32 = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(3, 1, 2, 0));
+    const __m256i lo = chroma_first ? _mm256_unpacklo_epi8(c32, y32) : _mm256_unpacklo_epi8(y32, c32);
+    const __m256i hi = chroma_first ? _mm256_unpackhi_epi8(c32, y32) : _mm256_unpackhi_epi8(y32, c32);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(packed + 2 * i), lo);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(packed + 2 * i + 32), hi);
+  }
+  if (i < width) {
+    pack_yuv422_row_sse2(y + i, c0 + i / 2, c1 + i / 2, packed + 2 * i, width - i, chroma_first);
+  }
+}
+
+// Splits 32 packed pixels: stores luma and returns chroma pairs
+MYYUV_TARGET("avx2")
+static inline __m256i splitYUV422x2(const uint8_t* packed, uint8_t* y, bool chroma_first) noexcept {
+  const __m256i mask = _mm256_set1_epi16(0x00ff);
+  const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(packed));
+  const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(packed + 32));
+  // pack works within 128-bit lanes, fix the order with 64-bit permute
+  const __m256i even = _mm256_permute4x64_epi64(_mm256_packus_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask)), _MM_SHUFFLE(3, 1, 2, 0));
+  const __m256i odd = _mm256_permute4x64_epi64(_mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8)), _MM_SHUFFLE(3, 1, 2, 0));
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(y), chroma_first ? odd : even);
+  return chroma_first ? even : odd;
+}
+
+template <bool Average>
+MYYUV_TARGET("avx2")
+static void unpack_yuv422_rows_avx2(const uint8_t* top, const uint8_t* bottom, uint8_t* y_top, uint8_t* y_bottom, uint8_t* c0, uint8_t* c1, uint32_t width, bool chroma_first) noexcept {
+  const __m256i mask = _mm256_set1_epi16(0x00ff);
+  uint32_t i = 0;
+  for (; i + 32 <= width; i += 32) {
+    __m256i c = splitYUV422x2(top + 2 * i, y_top + i, chroma_first);
+    if (Average) {
+      c = _mm256_avg_epu8(c, splitYUV422x2(bottom + 2 * i, y_bottom + i, chroma_first));
+    }
+    const __m256i c16 = _mm256_permute4x64_epi64(_mm256_packus_epi16(_mm256_and_si256(c, mask), _mm256_srli_epi16(c, 8)), _MM_SHUFFLE(3, 1, 2, 0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(c0 + i / 2), _mm256_castsi256_si128(c16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(c1 + i / 2), _mm256_extracti128_si256(c16, 1));
+  }
+  if (i < width) {
+    unpack_yuv422_rows_sse2<Average>(top + 2 * i, Average ? bottom + 2 * i : nullptr, y_top + i, Average ? y_bottom + i : nullptr, c0 + i / 2, c1 + i / 2, width - i, chroma_first);
+  }
+}
+
+// Semi-planar chroma: 8 pairs per iteration for SSE2, 32 pairs for AVX2.
+// 8 pairs are one row of an 8x8 block, so DCT blocks don't fall back to scalar.
+
+MYYUV_TARGET("sse2")
+static void interleave_uv_row_sse2(const uint8_t* u, const uint8_t* v, uint8_t* uv, uint32_t width) noexcept {
+  uint32_t i = 0;
+  for (; i + 16 <= width; i += 16) {
+    const __m128i u16 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(u + i));
+    const __m128i v16 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + 2 * i), _mm_unpacklo_epi8(u16, v16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + 2 * i + 16), _mm_unpackhi_epi8(u16, v16));
+  }
+  for (; i + 8 <= width; i += 8) {
+    const __m128i u8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + i));
+    const __m128i v8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + 2 * i), _mm_unpacklo_epi8(u8, v8));
+  }
+  if (i < width) {
+    interleave_uv_row_scalar(u + i, v + i, uv + 2 * i, width - i);
+  }
+}
+
+MYYUV_TARGET("sse2")
+static void deinterleave_uv_row_sse2(const uint8_t* uv, uint8_t* u, uint8_t* v, uint32_t width) noexcept {
+  const __m128i mask = _mm_set1_epi16(0x00ff);
+  uint32_t i = 0;
+  for (; i + 16 <= width; i += 16) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + 2 * i));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + 2 * i + 16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(u + i), _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(v + i), _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+  }
+  for (; i + 8 <= width; i += 8) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + 2 * i));
+    const __m128i uv8 = _mm_packus_epi16(_mm_and_si128(a, mask), _mm_srli_epi16(a, 8));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(u + i), uv8);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(v + i), _mm_srli_si128(uv8, 8));
+  }
+  if (i < width) {
+    deinterleave_uv_row_scalar(uv + 2 * i, u + i, v + i, width - i);
+  }
+}
+
+MYYUV_TARGET("avx2")
+static void interleave_uv_row_avx2(const uint8_t* u, const uint8_t* v, uint8_t* uv, uint32_t width) noexcept {
+  uint32_t i = 0;
+  for (; i + 32 <= width; i += 32) {
+    // unpack works within 128-bit lanes, so 64-bit quarters are put in order first
+    const __m256i u32 = _mm256_permute4x64_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(u + i)), _MM_SHUFFLE(3, 1, 2, 0));
+    const __m256i v32 = _mm256_permute4x64_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i)), _MM_SHUFFLE(3, 1, 2, 0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + 2 * i), _mm256_unpacklo_epi8(u32, v32));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + 2 * i + 32), _mm256_unpackhi_epi8(u32, v32));
+  }
+  if (i < width) {
+    interleave_uv_row_sse2(u + i, v + i, uv + 2 * i, width - i);
+  }
+}
+
+MYYUV_TARGET("avx2")
+static void deinterleave_uv_row_avx2(const uint8_t* uv, uint8_t* u, uint8_t* v, uint32_t width) noexcept {
+  const __m256i mask = _mm256_set1_epi16(0x00ff);
+  uint32_t i = 0;
+  for (; i + 32 <= width; i += 32) {
+    const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(uv + 2 * i));
+    const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(uv + 2 * i + 32));
+    // pack works within 128-bit lanes, fix the order with 64-bit permute
+    const __m256i u32 = _mm256_packus_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+    const __m256i v32 = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(u + i), _mm256_permute4x64_epi64(u32, _MM_SHUFFLE(3, 1, 2, 0)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(v + i), _mm256_permute4x64_epi64(v32, _MM_SHUFFLE(3, 1, 2, 0)));
+  }
+  if (i < width) {
+    deinterleave_uv_row_sse2(uv + 2 * i, u + i, v + i, width - i);
+  }
+}
+
+// High bit depth semi-planar chroma: 8 pairs per iteration for SSE2, 16 pairs for AVX2.
+
+MYYUV_TARGET("sse2")
+static void interleave_uv_row_sse2(const uint16_t* u, const uint16_t* v, uint16_t* uv, uint32_t width) noexcept {
+  uint32_t i = 0;
+  for (; i + 8 <= width; i += 8) {
+    const __m128i u8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(u + i));
+    const __m128i v8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + 2 * i), _mm_unpacklo_epi16(u8, v8));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + 2 * i + 8), _mm_unpackhi_epi16(u8, v8));
+  }
+  if (i < width) {
+    interleave_uv_row_scalar(u + i, v + i, uv + 2 * i, width - i);
+  }
+}
+
+MYYUV_TARGET("sse2")
+static void deinterleave_uv_row_sse2(const uint16_t* uv, uint16_t* u, uint16_t* v, uint32_t width) noexcept {
+  uint32_t i = 0;
+  for (; i + 8 <= width; i += 8) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + 2 * i));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + 2 * i + 8));
+    // samples are sign extended to 32 bits, so signed saturation of pack keeps every bit
+    const __m128i u8 = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+    const __m128i v8 = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(u + i), u8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(v + i), v8);
+  }
+  if (i < width) {
+    deinterleave_uv_row_scalar(uv + 2 * i, u + i, v + i, width - i);
+  }
+}
+
+MYYUV_TARGET("avx2")
+static void interleave_uv_row_avx2(const uint16_t* u, const uint16_t* v, uint16_t* uv, uint32_t width) noexcept {
+  uint32_t i = 0;
+  for (; i + 16 <= width; i += 16) {
+    const __m256i u16 = _mm256_permute4x64_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(u + i)), _MM_SHUFFLE(3, 1, 2, 0));
+    const __m256i v16 = _mm256_permute4x64_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i)), _MM_SHUFFLE(3, 1, 2, 0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + 2 * i), _mm256_unpacklo_epi16(u16, v16));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + 2 * i + 16), _mm256_unpackhi_epi16(u16, v16));
+  }
+  if (i < width) {
+    interleave_uv_row_sse2(u + i, v + i, uv + 2 * i, width - i);
+  }
+}
+
+MYYUV_TARGET("avx2")
+static void deinterleave_uv_row_avx2(const uint16_t* uv, uint16_t* u, uint16_t* v, uint32_t width) noexcept {
+  uint32_t i = 0;
+  for (; i + 16 <= width; i += 16) {
+    const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(uv + 2 * i));
+    const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(uv + 2 * i + 16));
+    const __m256i u16 = _mm256_packs_epi32(_mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16), _mm256_srai_epi32(_mm256_slli_epi32(b, 16), 16));
+    const __m256i v16 = _mm256_packs_epi32(_mm256_srai_epi32(a, 16), _mm256_srai_epi32(b, 16));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(u + i), _mm256_permute4x64_epi64(u16, _MM_SHUFFLE(3, 1, 2, 0)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(v + i), _mm256_permute4x64_epi64(v16, _MM_SHUFFLE(3, 1, 2, 0)));
+  }
+  if (i < width) {
+    deinterleave_uv_row_sse2(uv + 2 * i, u + i, v + i, width - i);
+  }
+}
+
+// Q15 fixed-point coefficients. Chroma is expanded to a linear combination of R, G, B:
+// Cb = 0.564 * (B - Y), Cr = 0.713 * (R - Y). Every row sums to 32768 (luma) or 0 (chroma),
+// so gray stays gray.
+static constexpr const int16_t y_r = 9798, y_g = 19235, y_b = 3735;
+static constexpr const int16_t cb_r = -5526, cb_g = -10848, cb_b = 16374;
+static constexpr const int16_t cr_r = 16378, cr_g = -13715, cr_b = -2663;
+static_assert(y_r + y_g + y_b == 32768, "Luma coefficients must sum to 1.0");
+static_assert(cb_r + cb_g + cb_b == 0, "Cb coefficients must sum to 0");
+static_assert(cr_r + cr_g + cr_b == 0, "Cr coefficients must sum to 0");
+
+// Two int16 packed in int32 lane for `madd`: `lo` multiplies B (or G), `hi` multiplies R (or X).
+static constexpr int32_t pairCoeffs(int16_t lo, int16_t hi) noexcept {
+  return static_cast<int32_t>(static_cast<uint32_t>(static_cast<uint16_t>(lo)) | (static_cast<uint32_t>(static_cast<uint16_t>(hi)) << 16));
+}
+
+// SSE4.1: 4 pixels per vector, 8 x `Rows` pixels per iteration.
+
+// Q15 luma and chroma of 4 pixels
+MYYUV_TARGET("sse4.1")
+static inline void rgbxToQ15x4(__m128i px, __m128i& y, __m128i& cb, __m128i& cr) noexcept {
+  const __m128i mask = _mm_set1_epi32(0x00ff00ff);
+  const __m128i br = _mm_and_si128(px, mask);
+  const __m128i gx = _mm_and_si128(_mm_srli_epi32(px, 8), mask);
+  y = _mm_add_epi32(_mm_madd_epi16(br, _mm_set1_epi32(pairCoeffs(y_b, y_r))), _mm_madd_epi16(gx, _mm_set1_epi32(pairCoeffs(y_g, 0))));
+  cb = _mm_add_epi32(_mm_madd_epi16(br, _mm_set1_epi32(pairCoeffs(cb_b, cb_r))), _mm_madd_epi16(gx, _mm_set1_epi32(pairCoeffs(cb_g, 0))));
+  cr = _mm_add_epi32(_mm_madd_epi16(br, _mm_set1_epi32(pairCoeffs(cr_b, cr_r))), _mm_madd_epi16(gx, _mm_set1_epi32(pairCoeffs(cr_g, 0))));
+}
+
+// Chroma is (c + 128) / `ChromaSamples` rounded, so `ChromaSamples` of them sum up to the average: 4 for averaged chroma, 1 for 4:4:4.
+template <uint32_t ChromaSamples>
+MYYUV_TARGET("sse4.1")
+static inline void rgbxToYUV4(__m128i px, __m128i& y, __m128i& cb, __m128i& cr) noexcept {
+  static_assert(ChromaSamples == 1 || ChromaSamples == 4, "Only 1 or 4 chroma samples");
+  const __m128i round = _mm_set1_epi32(0x7fff);
+  rgbxToQ15x4(px, y, cb, cr);
+  y = _mm_srli_epi32(y, 15);
+  // truncate towards zero like float to int cast does
+  cb = _mm_srai_epi32(_mm_add_epi32(cb, _mm_and_si128(_mm_srai_epi32(cb, 31), round)), 15);
+  cr = _mm_srai_epi32(_mm_add_epi32(cr, _mm_and_si128(_mm_srai_epi32(cr, 31), round)), 15);
+  // (c + 128 + 2) / 4 or c + 128
+  const __m128i bias = _mm_set1_epi32(128 + ChromaSamples / 2);
+  cb = _mm_srli_epi32(_mm_add_epi32(cb, bias), ChromaSamples == 4 ? 2 : 0);
+  cr = _mm_srli_epi32(_mm_add_epi32(cr, bias), ChromaSamples == 4 ? 2 : 0);
+}
+
+/**
+* Shift counts and constants of high bit depth samples: Q15 values are truncated to `bits` bits,
+* chroma is (c + (128 << (bits - 8))) / 4 rounded like `rgbxToYUV4<4>`.
+*/
+struct HighBitDepth4 {
+  __m128i q_shift;
+  __m128i round;
+  __m128i bias;
+  __m128i max;
+  __m128i shift;
+  MYYUV_TARGET("sse4.1")
+  HighBitDepth4(uint32_t bits, uint32_t shift_count) noexcept {
+    q_shift = _mm_cvtsi32_si128(static_cast<int>(15 - (bits - 8)));
+    round = _mm_set1_epi32((1 << (15 - (bits - 8))) - 1);
+    bias = _mm_set1_epi32((128 << (bits - 8)) + 2);
+    max = _mm_set1_epi16(static_cast<int16_t>((1u << bits) - 1));
+    shift = _mm_cvtsi32_si128(static_cast<int>(shift_count));
+  }
+};
+
+MYYUV_TARGET("sse4.1")
+static inline void rgbxToYUV4(__m128i px, __m128i& y, __m128i& cb, __m128i& cr, const HighBitDepth4& hbd) noexcept {
+  rgbxToQ15x4(px, y, cb, cr);
+  y = _mm_srl_epi32(y, hbd.q_shift);
+  cb = _mm_sra_epi32(_mm_add_epi32(cb, _mm_and_si128(_mm_srai_epi32(cb, 31), hbd.round)), hbd.q_shift);
+  cr = _mm_sra_epi32(_mm_add_epi32(cr, _mm_and_si128(_mm_srai_epi32(cr, 31), hbd.round)), hbd.q_shift);
+  cb = _mm_srli_epi32(_mm_add_epi32(cb, hbd.bias), 2);
+  cr = _mm_srli_epi32(_mm_add_epi32(cr, hbd.bias), 2);
+}
+
+MYYUV_TARGET("sse4.1")
+static void rgb_to_iyuv_rows_sse41(const uint8_t* rgb_top, const uint8_t* rgb_bottom, uint16_t* y_top, uint16_t* y_bottom, uint16_t* u, uint16_t* v, uint32_t width, uint32_t bits, uint32_t shift) noexcept {
+  const HighBitDepth4 hbd(bits, shift);
+  uint32_t i = 0;
+  for (; i + 8 <= width; i += 8) {
+    __m128i cb_sum = _mm_setzero_si128();
+    __m128i cr_sum = _mm_setzero_si128();
+    const uint8_t* rows[2] = { rgb_top + i * 4, rgb_bottom + i * 4 };
+    uint16_t* y_rows[2] = { y_top + i, y_bottom + i };
+    for (uint32_t r = 0; r < 2; r++) {
+      __m128i y0, cb0, cr0, y1, cb1, cr1;
+      rgbxToYUV4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r])), y0, cb0, cr0, hbd);
+      rgbxToYUV4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + 16)), y1, cb1, cr1, hbd);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(y_rows[r]), _mm_sll_epi16(_mm_packus_epi32(y0, y1), hbd.shift));
+      cb_sum = _mm_add_epi32(cb_sum, _mm_hadd_epi32(cb0, cb1));
+      cr_sum = _mm_add_epi32(cr_sum, _mm_hadd_epi32(cr0, cr1));
+    }
+    const __m128i c16 = _mm_sll_epi16(_mm_min_epu16(_mm_packus_epi32(cb_sum, cr_sum), hbd.max), hbd.shift);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(u + i / 2), c16);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(v + i / 2), _mm_srli_si128(c16, 8));
+  }
+  if (i < width) {
+    rgb_to_iyuv_rows_scalar(rgb_top + i * 4, rgb_bottom + i * 4, y_top + i, y_bottom + i, u + i / 2, v + i / 2, width - i, bits, shift);
+  }
+}
+
+template <uint32_t Rows>
+MYYUV_TARGET("sse4.1")
+static void rgb_to_yuv_rows_sse41(const uint8_t* rgb_top, const uint8_t* rgb_bottom, uint8_t* y_top, uint8_t* y_bottom, uint8_t* u, uint8_t* v, uint32_t width) noexcept {
+  uint32_t i = 0;
+  for (; i + 8 <= width; i += 8) {
+    __m128i cb_sum = _mm_setzero_si128();
+    __m128i cr_sum = _mm_setzero_si128();
+    const uint8_t* rows[2] = { rgb_top + i * 4, Rows == 2 ? rgb_bottom + i * 4 : nullptr };
+    uint8_t* y_rows[2] = { y_top + i, Rows == 2 ? y_bottom + i : nullptr };
+    for (uint32_t r = 0; r < Rows; r++) {
+      __m128i y0, cb0, cr0, y1, cb1, cr1;
+      rgbxToYUV4<4>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r])), y0, cb0, cr0);
+      rgbxToYUV4<4>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + 16)), y1, cb1, cr1);
+      const __m128i y16 = _mm_packs_epi32(y0, y1);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(y_rows[r]), _mm_packus_epi16(y16, y16));
+      cb_sum = _mm_add_epi32(cb_sum, _mm_hadd_epi32(cb0, cb1));
+      cr_sum = _mm_add_epi32(cr_sum, _mm_hadd_epi32(cr0, cr1));
+    }
+    if (Rows == 1) {
+      cb_sum = _mm_add_epi32(cb_sum, cb_sum);
+      cr_sum = _mm_add_epi32(cr_sum, cr_sum);
+    }
+    const __m128i c16 = _mm_packs_epi32(cb_sum, cr_sum);
+    const __m128i c8 = _mm_packus_epi16(c16, c16);
+    const int32_t cb4 = _mm_cvtsi128_si32(c8);
+    const int32_t cr4 = _mm_cvtsi128_si32(_mm_srli_si128(c8, 4));
+    std::copy(reinterpret_cast<const uint8_t*>(&cb4), reinterpret_cast<const uint8_t*>(&cb4) + 4, u + i / 2);
+    std::copy(reinterpret_cast<const uint8_t*>(&cr4), reinterpret_cast<const uint8_t*>(&cr4) + 4, v + i / 2);
+  }
+  if (i < width) {
+    rgb_to_yuv_rows_scalar<Rows>(rgb_top + i * 4, Rows == 2 ? rgb_bottom + i * 4 : nullptr, y_top + i, Rows == 2 ? y_bottom + i : nullptr, u + i / 2, v + i / 2, width - i);
+  }
+}
+
+MYYUV_TARGET("sse4.1")
+static void rgb_to_yuv444_row_sse41(const uint8_t* rgb, uint8_t* y, uint8_t* u, uint8_t* v, uint32_t width) noexcept {
+  uint32_t i = 0;
+  for (; i + 8 <= width; i += 8) {
+    __m128i y0, cb0, cr0, y1, cb1, cr1;
+    rgbxToYUV4<1>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + i * 4)), y0, cb0, cr0);
+    rgbxToYUV4<1>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + i * 4 + 16)), y1, cb1, cr1);
+    uint8_t* const dst[3] = { y + i, u + i, v + i };
+    const __m128i samples[3][2] = { { y0, y1 }, { cb0, cb1 }, { cr0, cr1 } };
+    for (uint8_t c = 0; c < 3; c++) {
+      const __m128i s16 = _mm_packs_epi32(samples[c][0], samples[c][1]);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(dst[c]), _mm_packus_epi16(s16, s16));
+    }
+  }
+  if (i < width) {
+    rgb_to_yuv444_row_scalar(rgb + i * 4, y + i, u + i, v + i, width - i);
+  }
+}
+
+// 16 pixels (48 bytes) per iteration, every 12 bytes are shuffled into 4 pixels
+MYYUV_TARGET("sse4.1")
+static void bgr_to_bgrx_row_sse41(const uint8_t* bgr, uint8_t* bgrx, uint32_t width) noexcept {
+  const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  uint32_t i = 0;
+  for (; i + 16 <= width; i += 16) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgr + i * 3));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgr + i * 3 + 16));
+    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgr + i * 3 + 32));
+    __m128i* const dst = reinterpret_cast<__m128i*>(bgrx + i * 4);
+    _mm_storeu_si128(dst, _mm_shuffle_epi8(a, shuffle));
+    _mm_storeu_si128(dst + 1, _mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), shuffle));
+    _mm_storeu_si128(dst + 2, _mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), shuffle));
+    _mm_storeu_si128(dst + 3, _mm_shuffle_epi8(_mm_srli_si128(c, 4), shuffle));
+  }
+  if (i < width) {
+    bgr_to_bgrx_row_scalar(bgr + i * 3, bgrx + i * 4, width - i);
+  }
+}
+
+// AVX2: 8 pixels per vector, 16 x `Rows` pixels per iteration.
+
+// Q15 luma and chroma of 8 pixels
+MYYUV_TARGET("avx2")
+static inline void rgbxToQ15x8(__m256i px, __m256i& y, __m256i& cb, __m256i& cr) noexcept {
+  const __m256i mask = _mm256_set1_epi32(0x00ff00ff);
+  const __m256i br = _mm256_and_si256(px, mask);
+  const __m256i gx = _mm256_and_si256(_mm256_srli_epi32(px, 8), mask);
+  y = _mm256_add_epi32(_mm256_madd_epi16(br, _mm256_set1_epi32(pairCoeffs(y_b, y_r))), _mm256_madd_epi16(gx, _mm256_set1_epi32(pairCoeffs(y_g, 0))));
+  cb = _mm256_add_epi32(_mm256_madd_epi16(br, _mm256_set1_epi32(pairCoeffs(cb_b, cb_r))), _mm256_madd_epi16(gx, _mm256_set1_epi32(pairCoeffs(cb_g, 0))));
+  cr = _mm256_add_epi32(_mm256_madd_epi16(br, _mm256_set1_epi32(pairCoeffs(cr_b, cr_r))), _mm256_madd_epi16(gx, _mm256_set1_epi32(pairCoeffs(cr_g, 0))));
+}
+
+template <uint32_t ChromaSamples>
+MYYUV_TARGET("avx2")
+static inline void rgbxToYUV8(__m256i px, __m256i& y, __m256i& cb, __m256i& cr) noexcept {
+  static_assert(ChromaSamples == 1 || ChromaSamples == 4, "Only 1 or 4 chroma samples");
+  const __m256i round = _mm256_set1_epi32(0x7fff);
+  rgbxToQ15x8(px, y, cb, cr);
+  y = _mm256_srli_epi32(y, 15);
+  cb = _mm256_srai_epi32(_mm256_add_epi32(cb, _mm256_and_si256(_mm256_srai_epi32(cb, 31), round)), 15);
+  cr = _mm256_srai_epi32(_mm256_add_epi32(cr, _mm256_and_si256(_mm256_srai_epi32(cr, 31), round)), 15);
+  const __m256i bias = _mm256_set1_epi32(128 + ChromaSamples / 2);
+  cb = _mm256_srli_epi32(_mm256_add_epi32(cb, bias), ChromaSamples == 4 ? 2 : 0);
+  cr = _mm256_srli_epi32(_mm256_add_epi32(cr, bias), ChromaSamples == 4 ? 2 : 0);
+}
+
+// `HighBitDepth4` of AVX2
+struct HighBitDepth8 {
+  __m128i q_shift;
+  __m256i round;
+  __m256i bias;
+  __m256i max;
+  __m128i shift;
+  MYYUV_TARGET("avx2")
+  HighBitDepth8(uint32_t bits, uint32_t shift_count) noexcept {
+    q_shift = _mm_cvtsi32_si128(static_cast<int>(15 - (bits - 8)));
+    round = _mm256_set1_epi32((1 << (15 - (bits - 8))) - 1);
+    bias = _mm256_set1_epi32((128 << (bits - 8)) + 2);
+    max = _mm256_set1_epi16(static_cast<int16_t>((1u << bits) - 1));
+    shift = _mm_cvtsi32_si128(static_cast<int>(shift_count));
+  }
+};
+
+MYYUV_TARGET("avx2")
+static inline void rgbxToYUV8(__m256i px, __m256i& y, __m256i& cb, __m256i& cr, const HighBitDepth8& hbd) noexcept {
+  rgbxToQ15x8(px, y, cb, cr);
+  y = _mm256_srl_epi32(y, hbd.q_shift);
+  cb = _mm256_sra_epi32(_mm256_add_epi32(cb, _mm256_and_si256(_mm256_srai_epi32(cb, 31), hbd.round)), hbd.q_shift);
+  cr = _mm256_sra_epi32(_mm256_add_epi32(cr, _mm256_and_si256(_mm256_srai_epi32(cr, 31), hbd.round)), hbd.q_shift);
+  cb = _mm256_srli_epi32(_mm256_add_epi32(cb, hbd.bias), 2);
+  cr = _mm256_srli_epi32(_mm256_add_epi32(cr, hbd.bias), 2);
+}
+
+MYYUV_TARGET("avx2")
+static void rgb_to_iyuv_rows_avx2(const uint8_t* rgb_top, const uint8_t* rgb_bottom, uint16_t* y_top, uint16_t* y_bottom, uint16_t* u, uint16_t* v, uint32_t width, uint32_t bits, uint32_t shift) noexcept {
+  const HighBitDepth8 hbd(bits, shift);
+  uint32_t i = 0;
+  for (; i + 16 <= width; i += 16) {
+    __m256i cb_sum = _mm256_setzero_si256();
+    __m256i cr_sum = _mm256_setzero_si256();
+    const uint8_t* rows[2] = { rgb_top + i * 4, rgb_bottom + i * 4 };
+    uint16_t* y_rows[2] = { y_top + i, y_bottom + i };
+    for (uint32_t r = 0; r < 2; r++) {
+      __m256i y0, cb0, cr0, y1, cb1, cr1;
+      rgbxToYUV8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[r])), y0, cb0, cr0, hbd);
+      rgbxToYUV8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[r] + 32)), y1, cb1, cr1, hbd);
+      // packus and hadd work within 128-bit lanes, fix the order with 64-bit permute
+      const __m256i y16 = _mm256_permute4x64_epi64(_mm256_packus_epi32(y0, y1), _MM_SHUFFLE(3, 1, 2, 0));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(y_rows[r]), _mm256_sll_epi16(y16, hbd.shift));
+      cb_sum = _mm256_add_epi32(cb_sum, _mm256_hadd_epi32(cb0, cb1));
+      cr_sum = _mm256_add_epi32(cr_sum, _mm256_hadd_epi32(cr0, cr1));
+    }
+    cb_sum = _mm256_permute4x64_epi64(cb_sum, _MM_SHUFFLE(3, 1, 2, 0));
+    cr_sum = _mm256_permute4x64_epi64(cr_sum, _MM_SHUFFLE(3, 1, 2, 0));
+    // 8 Cb then 8 Cr
+    __m256i c16 = _mm256_permute4x64_epi64(_mm256_packus_epi32(cb_sum, cr_sum), _MM_SHUFFLE(3, 1, 2, 0));
+    c16 = _mm256_sll_epi16(_mm256_min_epu16(c16, hbd.max), hbd.shift);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(u + i / 2), _mm256_castsi256_si128(c16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(v + i / 2), _mm256_extracti128_si256(c16, 1));
+  }
+  if (i < width) {
+    rgb_to_iyuv_rows_sse41(rgb_top + i * 4, rgb_bottom + i * 4, y_top + i, y_bottom + i, u + i / 2, v + i / 2, width - i, bits, shift);
+  }
+}
+
+template <uint32_t Rows>
+MYYUV_TARGET("avx2")
+static void rgb_to_yuv_rows_avx2(const uint8_t* rgb_top, const uint8_t* rgb_bottom, uint8_t* y_top, uint8_t* y_bottom, uint8_t* u, uint8_t* v, uint32_t width) noexcept {
+  uint32_t i = 0;
+  for (; i + 16 <= width; i += 16) {
+    __m256i cb_sum = _mm256_setzero_si256();
+    __m256i cr_sum = _mm256_setzero_si256();
+    const uint8_t* rows[2] = { rgb_top + i * 4, Rows == 2 ? rgb_bottom + i * 4 : nullptr };
+    uint8_t* y_rows[2] = { y_top + i, Rows == 2 ? y_bottom + i : nullptr };
+    for (uint32_t r = 0; r < Rows; r++) {
+      __m256i y0, cb0, cr0, y1, cb1, cr1;
+      rgbxToYUV8<4>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[r])), y0, cb0, cr0);
+      rgbxToYUV8<4>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[r] + 32)), y1, cb1, cr1);
+      // packs and hadd work within 128-bit lanes, fix the order with 64-bit permute
+      const __m256i y16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(y0, y1), _MM_SHUFFLE(3, 1, 2, 0));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(y_rows[r]), _mm_packus_epi16(_mm256_castsi256_si128(y16), _mm256_extracti128_si256(y16, 1)));
+      cb_sum = _mm256_add_epi32(cb_sum, _mm256_hadd_epi32(cb0, cb1));
+      cr_sum = _mm256_add_epi32(cr_sum, _mm256_hadd_epi32(cr0, cr1));
+    }
+    if (Rows == 1) {
+      cb_sum = _mm256_add_epi32(cb_sum, cb_sum);
+      cr_sum = _mm256_add_epi32(cr_sum, cr_sum);
+    }
+    cb_sum = _mm256_permute4x64_epi64(cb_sum, _MM_SHUFFLE(3, 1, 2, 0));
+    cr_sum = _mm256_permute4x64_epi64(cr_sum, _MM_SHUFFLE(3, 1, 2, 0));
+    const __m128i cb16 = _mm_packs_epi32(_mm256_castsi256_si128(cb_sum), _mm256_extracti128_si256(cb_sum, 1));
+    const __m128i cr16 = _mm_packs_epi32(_mm256_castsi256_si128(cr_sum), _mm256_extracti128_si256(cr_sum, 1));
+    const __m128i c8 = _mm_packus_epi16(cb16, cr16);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(u + i / 2), c8);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(v + i / 2), _mm_srli_si128(c8, 8));
+  }
+  if (i < width) {
+    rgb_to_yuv_rows_sse41<Rows>(rgb_top + i * 4, Rows == 2 ? rgb_bottom + i * 4 : nullptr, y_top + i, Rows == 2 ? y_bottom + i : nullptr, u + i / 2, v + i / 2, width - i);
+  }
+}
+
+MYYUV_TARGET("avx2")
+static void rgb_to_yuv444_row_avx2(const uint8_t* rgb, uint8_t* y, uint8_t* u, uint8_t* v, uint32_t width) noexcept {
+  uint32_t i = 0;
+  for (; i + 16 <= width; i += 16) {
+    __m256i y0, cb0, cr0, y1, cb1, cr1;
+    rgbxToYUV8<1>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgb + i * 4)), y0, cb0, cr0);
+    rgbxToYUV8<1>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgb + i * 4 + 32)), y1, cb1, cr1);
+    uint8_t* const dst[3] = { y + i, u + i, v + i };
+    const __m256i samples[3][2] = { { y0, y1 }, { cb0, cb1 }, { cr0, cr1 } };
+    for (uint8_t c = 0; c < 3; c++) {
+      // packs works within 128-bit lanes, fix the order with 64-bit permute
+      const __m256i s16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(samples[c][0], samples[c][1]), _MM_SHUFFLE(3, 1, 2, 0));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst[c]), _mm_packus_epi16(_mm256_castsi256_si128(s16), _mm256_extracti128_si256(s16, 1)));
+    }
+  }
+  if (i < width) {
+    rgb_to_yuv444_row_sse41(rgb + i * 4, y + i, u + i, v + i, width - i);
+  }
+}
+
+// Chroma reorder and resampling: 16 samples per iteration for SSE2, 32 samples for AVX2.
+
+MYYUV_TARGET("sse2")
+static void swap_uv_row_sse2(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept {
+  uint32_t i = 0;
+  for (; i + 8 <= width; i += 8) {
+    const __m128i uv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), _mm_or_si128(_mm_slli_epi16(uv, 8), _mm_srli_epi16(uv, 8)));
+  }
+  if (i < width) {
+    swap_uv_row_scalar(src + 2 * i, dst + 2 * i, width - i);
+  }
+}
+
+MYYUV_TARGET("sse2")
+static void shift_samples_row_sse2(const uint16_t* src, uint16_t* dst, uint32_t count, int32_t shift) noexcept {
+  const __m128i shift_count = _mm_cvtsi32_si128(shift >= 0 ? shift : -shift);
+  uint32_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), shift >= 0 ? _mm_sll_epi16(x, shift_count) : _mm_srl_epi16(x, shift_count));
+  }
+  if (i < count) {
+    shift_samples_row_scalar(src + i, dst + i, count - i, shift);
+  }
+}
+
+MYYUV_TARGET("sse2")
+static void widen_samples_row_sse2(const uint8_t* src, uint16_t* dst, uint32_t count, uint32_t shift) noexcept {
+  const __m128i shift_count = _mm_cvtsi32_si128(static_cast<int>(shift));
+  const __m128i zero = _mm_setzero_si128();
+  uint32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_sll_epi16(_mm_unpacklo_epi8(x, zero), shift_count));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_sll_epi16(_mm_unpackhi_epi8(x, zero), shift_count));
+  }
+  if (i < count) {
+    widen_samples_row_scalar(src + i, dst + i, count - i, shift);
+  }
+}
+
+MYYUV_TARGET("sse2")
+static void narrow_samples_row_sse2(const uint16_t* src, uint8_t* dst, uint32_t count, uint32_t shift) noexcept {
+  const __m128i shift_count = _mm_cvtsi32_si128(static_cast<int>(shift));
+  uint32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const __m128i lo = _mm_srl_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), shift_count);
+    const __m128i hi = _mm_srl_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8)), shift_count);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+  }
+  if (i < count) {
+    narrow_samples_row_scalar(src + i, dst + i, count - i, shift);
+  }
+}
+
+MYYUV_TARGET("sse2")
+static void average_rows_sse2(const uint8_t* a, const uint8_t* b, uint8_t* dst, uint32_t width) noexcept {
+  uint32_t i = 0;
+  for (; i + 16 <= width; i += 16) {
+    const __m128i a16 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    const __m128i b16 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_avg_epu8(a16, b16));
+  }
+  if (i < width) {
+    average_rows_scalar(a + i, b + i, dst + i, width - i);
+  }
+}
+
+MYYUV_TARGET("sse2")
+static inline __m128i averagePairs8(__m128i x) noexcept {
+  return _mm_avg_epu16(_mm_and_si128(x, _mm_set1_epi16(0x00ff)), _mm_srli_epi16(x, 8));
+}
+
+MYYUV_TARGET("sse2")
+static void average_pairs_row_sse2(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept {
+  uint32_t i = 0;
+  for (; i + 16 <= width; i += 16) {
+    const __m128i lo = averagePairs8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i)));
+    const __m128i hi = averagePairs8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i + 16)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+  }
+  if (i < width) {
+    average_pairs_row_scalar(src + 2 * i, dst + i, width - i);
+  }
+}
+
+// (3 * near + far + 2) / 4 of 8 samples in 16 bits
+MYYUV_TARGET("sse2")
+static inline __m128i lerpQuarter8(__m128i near, __m128i far) noexcept {
+  return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(near, _mm_slli_epi16(near, 1)), _mm_add_epi16(far, _mm_set1_epi16(2))), 2);
+}
+
+MYYUV_TARGET("sse2")
+static void lerp_rows_sse2(const uint8_t* near, const uint8_t* far, uint8_t* dst, uint32_t width) noexcept {
+  const __m128i zero = _mm_setzero_si128();
+  uint32_t i = 0;
+  for (; i + 16 <= width; i += 16) {
+    const __m128i n = _mm_loadu_si128(reinterpret_cast<const __m128i*>(near + i));
+    const __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(far + i));
+    const __m128i lo = lerpQuarter8(_mm_unpacklo_epi8(n, zero), _mm_unpacklo_epi8(f, zero));
+    const __m128i hi = lerpQuarter8(_mm_unpackhi_epi8(n, zero), _mm_unpackhi_epi8(f, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+  }
+  if (i < width) {
+    lerp_rows_scalar(near + i, far + i, dst + i, width - i);
+  }
+}
+
+MYYUV_TARGET("sse2")
+static void upsample_pairs_row_sse2(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept {
+  const __m128i zero = _mm_setzero_si128();
+  // the first sample has no left neighbour, blocks read one sample to the left and to the right
+  upsample_pairs_row_scalar(src, dst, 0, std::min(width, 1u), width);
+  uint32_t i = 1;
+  for (; i + 17 <= width; i += 16) {
+    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    const __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i - 1));
+    const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 1));
+    const __m128i c_lo = _mm_unpacklo_epi8(c, zero);
+    const __m128i c_hi = _mm_unpackhi_epi8(c, zero);
+    const __m128i even = _mm_packus_epi16(lerpQuarter8(c_lo, _mm_unpacklo_epi8(l, zero)), lerpQuarter8(c_hi, _mm_unpackhi_epi8(l, zero)));
+    const __m128i odd = _mm_packus_epi16(lerpQuarter8(c_lo, _mm_unpacklo_epi8(r, zero)), lerpQuarter8(c_hi, _mm_unpackhi_epi8(r, zero)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), _mm_unpacklo_epi8(even, odd));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i + 16), _mm_unpackhi_epi8(even, odd));
+  }
+  if (i < width) {
+    upsample_pairs_row_scalar(src, dst, i, width, width);
+  }
+}
+
+MYYUV_TARGET("avx2")
+static void swap_uv_row_avx2(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept {
+  uint32_t i = 0;
+  for (; i + 16 <= width; i += 16) {
+    const __m256i uv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i), _mm256_or_si256(_mm256_slli_epi16(uv, 8), _mm256_srli_epi16(uv, 8)));
+  }
+  if (i < width) {
+    swap_uv_row_sse2(src + 2 * i, dst + 2 * i, width - i);
+  }
+}
+
+MYYUV_TARGET("avx2")
+static void shift_samples_row_avx2(const uint16_t* src, uint16_t* dst, uint32_t count, int32_t shift) noexcept {
+  const __m128i shift_count = _mm_cvtsi32_si128(shift >= 0 ? shift : -shift);
+  uint32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), shift >= 0 ? _mm256_sll_epi16(x, shift_count) : _mm256_srl_epi16(x, shift_count));
+  }
+  if (i < count) {
+    shift_samples_row_sse2(src + i, dst + i, count - i, shift);
+  }
+}
+
+MYYUV_TARGET("avx2")
+static void widen_samples_row_avx2(const uint8_t* src, uint16_t* dst, uint32_t count, uint32_t shift) noexcept {
+  const __m128i shift_count = _mm_cvtsi32_si128(static_cast<int>(shift));
+  uint32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const __m256i x = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_sll_epi16(x, shift_count));
+  }
+  if (i < count) {
+    widen_samples_row_scalar(src + i, dst + i, count - i, shift);
+  }
+}
+
+MYYUV_TARGET("avx2")
+static void narrow_samples_row_avx2(const uint16_t* src, uint8_t* dst, uint32_t count, uint32_t shift) noexcept {
+  const __m128i shift_count = _mm_cvtsi32_si128(static_cast<int>(shift));
+  uint32_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    const __m256i lo = _mm256_srl_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)), shift_count);
+    const __m256i hi = _mm256_srl_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 16)), shift_count);
+    // packus works within 128-bit lanes
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xd8));
+  }
+  if (i < count) {
+    narrow_samples_row_sse2(src + i, dst + i, count - i, shift);
+  }
+}
+
+MYYUV_TARGET("avx2")
+static void average_rows_avx2(const uint8_t* a, const uint8_t* b, uint8_t* dst, uint32_t width) noexcept {
+  uint32_t i = 0;
+  for (; i + 32 <= width; i += 32) {
+    const __m256i a32 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    const __m256i b32 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_avg_epu8(a32, b32));
+  }
+  if (i < width) {
+    average_rows_sse2(a + i, b + i, dst + i, width - i);
+  }
+}
+
+MYYUV_TARGET("avx2")
+static inline __m256i averagePairs16(__m256i x) noexcept {
+  return _mm256_avg_epu16(_mm256_and_si256(x, _mm256_set1_epi16(0x00ff)), _mm256_srli_epi16(x, 8));
+}
+
+MYYUV_TARGET("avx2")
+static void average_pairs_row_avx2(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept {
+  uint32_t i = 0;
+  for (; i + 32 <= width; i += 32) {
+    const __m256i lo = averagePairs16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i)));
+    const __m256i hi = averagePairs16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i + 32)));
+    // packus works within 128-bit lanes, fix the order with 64-bit permute
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), _MM_SHUFFLE(3, 1, 2, 0)));
+  }
+  if (i < width) {
+    average_pairs_row_sse2(src + 2 * i, dst + i, width - i);
+  }
+}
+
+MYYUV_TARGET("avx2")
+static inline __m256i lerpQuarter16(__m256i near, __m256i far) noexcept {
+  return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(near, _mm256_slli_epi16(near, 1)), _mm256_add_epi16(far, _mm256_set1_epi16(2))), 2);
+}
+
+MYYUV_TARGET("avx2")
+static void lerp_rows_avx2(const uint8_t* near, const uint8_t* far, uint8_t* dst, uint32_t width) noexcept {
+  const __m256i zero = _mm256_setzero_si256();
+  uint32_t i = 0;
+  for (; i + 32 <= width; i += 32) {
+    const __m256i n = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(near + i));
+    const __m256i f = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(far + i));
+    // unpack and packus both work within 128-bit lanes, so the order is kept
+    const __m256i lo = lerpQuarter16(_mm256_unpacklo_epi8(n, zero), _mm256_unpacklo_epi8(f, zero));
+    const __m256i hi = lerpQuarter16(_mm256_unpackhi_epi8(n, zero), _mm256_unpackhi_epi8(f, zero));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(lo, hi));
+  }
+  if (i < width) {
+    lerp_rows_sse2(near + i, far + i, dst + i, width - i);
+  }
+}
+
+MYYUV_TARGET("avx2")
+static void upsample_pairs_row_avx2(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept {
+  const __m256i zero = _mm256_setzero_si256();
+  upsample_pairs_row_scalar(src, dst, 0, std::min(width, 1u), width);
+  uint32_t i = 1;
+  for (; i + 33 <= width; i += 32) {
+    const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    const __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i - 1));
+    const __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 1));
+    const __m256i c_lo = _mm256_unpacklo_epi8(c, zero);
+    const __m256i c_hi = _mm256_unpackhi_epi8(c, zero);
+    const __m256i even = _mm256_packus_epi16(lerpQuarter16(c_lo, _mm256_unpacklo_epi8(l, zero)), lerpQuarter16(c_hi, _mm256_unpackhi_epi8(l, zero)));
+    const __m256i odd = _mm256_packus_epi16(lerpQuarter16(c_lo, _mm256_unpacklo_epi8(r, zero)), lerpQuarter16(c_hi, _mm256_unpackhi_epi8(r, zero)));
+    // pairs of samples 0-7 and 16-23 are in the low halves of lanes, 8-15 and 24-31 in the high halves
+    const __m256i lo = _mm256_unpacklo_epi8(even, odd);
+    const __m256i hi = _mm256_unpackhi_epi8(even, odd);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i), _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+  }
+  if (i < width) {
+    upsample_pairs_row_scalar(src, dst, i, width, width);
+  }
+}
+
+#endif // MYYUV_X86
+
+} // namespace
+
+namespace myyuvConvert {
+
+void rgb_to_iyuv_rows(const uint8_t* rgb_top, const uint8_t* rgb_bottom, uint8_t* y_top, uint8_t* y_bottom, uint8_t* u, uint8_t* v, uint32_t width) noexcept {
+  rgb_to_iyuv_rows(myyuv::getSimdLevel(), rgb_top, rgb_bottom, y_top, y_bottom, u, v, width);
+}
+
+void rgb_to_iyuv_rows(myyuv::SimdLevel level, const uint8_t* rgb_top, const uint8_t* rgb_bottom, uint8_t* y_top, uint8_t* y_bottom, uint8_t* u, uint8_t* v, uint32_t width) noexcept {
+  assert(width % 2 == 0);
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      rgb_to_yuv_rows_avx2<2>(rgb_top, rgb_bottom, y_top, y_bottom, u, v, width);
+      break;
+    case myyuv::SimdLevel::SSE41:
+      rgb_to_yuv_rows_sse41<2>(rgb_top, rgb_bottom, y_top, y_bottom, u, v, width);
+      break;
+#endif
+    default:
+      rgb_to_yuv_rows_scalar<2>(rgb_top, rgb_bottom, y_top, y_bottom, u, v, width);
+      break;
+  }
+}
+
+void rgb_to_iyuv_rows(const uint8_t* rgb_top, const uint8_t* rgb_bottom, uint16_t* y_top, uint16_t* y_bottom, uint16_t* u, uint16_t* v, uint32_t width, uint32_t bits, uint32_t shift) noexcept {
+  rgb_to_iyuv_rows(myyuv::getSimdLevel(), rgb_top, rgb_bottom, y_top, y_bottom, u, v, width, bits, shift);
+}
+
+void rgb_to_iyuv_rows(myyuv::SimdLevel level, const uint8_t* rgb_top, const uint8_t* rgb_bottom, uint16_t* y_top, uint16_t* y_bottom, uint16_t* u, uint16_t* v, uint32_t width, uint32_t bits, uint32_t shift) noexcept {
+  assert(width % 2 == 0);
+  assert(bits > 8 && bits <= 15 && bits + shift <= 16);
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      rgb_to_iyuv_rows_avx2(rgb_top, rgb_bottom, y_top, y_bottom, u, v, width, bits, shift);
+      break;
+    case myyuv::SimdLevel::SSE41:
+      rgb_to_iyuv_rows_sse41(rgb_top, rgb_bottom, y_top, y_bottom, u, v, width, bits, shift);
+      break;
+#endif
+    default:
+      rgb_to_iyuv_rows_scalar(rgb_top, rgb_bottom, y_top, y_bottom, u, v, width, bits, shift);
+      break;
+  }
+}
+
+void rgb_to_yuv422_row(const uint8_t* rgb, uint8_t* y, uint8_t* u, uint8_t* v, uint32_t width) noexcept {
+  rgb_to_yuv422_row(myyuv::getSimdLevel(), rgb, y, u, v, width);
+}
+
+void rgb_to_yuv422_row(myyuv::SimdLevel level, const uint8_t* rgb, uint8_t* y, uint8_t* u, uint8_t* v, uint32_t width) noexcept {
+  assert(width % 2 == 0);
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      rgb_to_yuv_rows_avx2<1>(rgb, nullptr, y, nullptr, u, v, width);
+      break;
+    case myyuv::SimdLevel::SSE41:
+      rgb_to_yuv_rows_sse41<1>(rgb, nullptr, y, nullptr, u, v, width);
+      break;
+#endif
+    default:
+      rgb_to_yuv_rows_scalar<1>(rgb, nullptr, y, nullptr, u, v, width);
+      break;
+  }
+}
+
+void rgb_to_yuv444_row(const uint8_t* rgb, uint8_t* y, uint8_t* u, uint8_t* v, uint32_t width) noexcept {
+  rgb_to_yuv444_row(myyuv::getSimdLevel(), rgb, y, u, v, width);
+}
+
+void rgb_to_yuv444_row(myyuv::SimdLevel level, const uint8_t* rgb, uint8_t* y, uint8_t* u, uint8_t* v, uint32_t width) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      rgb_to_yuv444_row_avx2(rgb, y, u, v, width);
+      break;
+    case myyuv::SimdLevel::SSE41:
+      rgb_to_yuv444_row_sse41(rgb, y, u, v, width);
+      break;
+#endif
+    default:
+      rgb_to_yuv444_row_scalar(rgb, y, u, v, width);
+      break;
+  }
+}
+
+void bgr_to_bgrx_row(const uint8_t* bgr, uint8_t* bgrx, uint32_t width) noexcept {
+  bgr_to_bgrx_row(myyuv::getSimdLevel(), bgr, bgrx, width);
+}
+
+void bgr_to_bgrx_row(myyuv::SimdLevel level, const uint8_t* bgr, uint8_t* bgrx, uint32_t width) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+    case myyuv::SimdLevel::SSE41:
+      bgr_to_bgrx_row_sse41(bgr, bgrx, width);
+      break;
+#endif
+    default:
+      bgr_to_bgrx_row_scalar(bgr, bgrx, width);
+      break;
+  }
+}
+
+void interleave_uv_row(const uint8_t* u, const uint8_t* v, uint8_t* uv, uint32_t width) noexcept {
+  interleave_uv_row(myyuv::getSimdLevel(), u, v, uv, width);
+}
+
+void interleave_uv_row(myyuv::SimdLevel level, const uint8_t* u, const uint8_t* v, uint8_t* uv, uint32_t width) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      interleave_uv_row_avx2(u, v, uv, width);
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      interleave_uv_row_sse2(u, v, uv, width);
+      break;
+#endif
+    default:
+      interleave_uv_row_scalar(u, v, uv, width);
+      break;
+  }
+}
+
+void interleave_uv_row(const uint16_t* u, const uint16_t* v, uint16_t* uv, uint32_t width) noexcept {
+  interleave_uv_row(myyuv::getSimdLevel(), u, v, uv, width);
+}
+
+void interleave_uv_row(myyuv::SimdLevel level, const uint16_t* u, const uint16_t* v, uint16_t* uv, uint32_t width) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      interleave_uv_row_avx2(u, v, uv, width);
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      interleave_uv_row_sse2(u, v, uv, width);
+      break;
+#endif
+    default:
+      interleave_uv_row_scalar(u, v, uv, width);
+      break;
+  }
+}
+
+void deinterleave_uv_row(const uint8_t* uv, uint8_t* u, uint8_t* v, uint32_t width) noexcept {
+  deinterleave_uv_row(myyuv::getSimdLevel(), uv, u, v, width);
+}
+
+void deinterleave_uv_row(myyuv::SimdLevel level, const uint8_t* uv, uint8_t* u, uint8_t* v, uint32_t width) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      deinterleave_uv_row_avx2(uv, u, v, width);
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      deinterleave_uv_row_sse2(uv, u, v, width);
+      break;
+#endif
+    default:
+      deinterleave_uv_row_scalar(uv, u, v, width);
+      break;
+  }
+}
+
+void deinterleave_uv_row(const uint16_t* uv, uint16_t* u, uint16_t* v, uint32_t width) noexcept {
+  deinterleave_uv_row(myyuv::getSimdLevel(), uv, u, v, width);
+}
+
+void deinterleave_uv_row(myyuv::SimdLevel level, const uint16_t* uv, uint16_t* u, uint16_t* v, uint32_t width) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      deinterleave_uv_row_avx2(uv, u, v, width);
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      deinterleave_uv_row_sse2(uv, u, v, width);
+      break;
+#endif
+    default:
+      deinterleave_uv_row_scalar(uv, u, v, width);
+      break;
+  }
+}
+
+void pack_yuv422_row(const uint8_t* y, const uint8_t* c0, const uint8_t* c1, uint8_t* packed, uint32_t width, bool chroma_first) noexcept {
+  pack_yuv422_row(myyuv::getSimdLevel(), y, c0, c1, packed, width, chroma_first);
+}
+
+void pack_yuv422_row(myyuv::SimdLevel level, const uint8_t* y, const uint8_t* c0, const uint8_t* c1, uint8_t* packed, uint32_t width, bool chroma_first) noexcept {
+  assert(width % 2 == 0);
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      pack_yuv422_row_avx2(y, c0, c1, packed, width, chroma_first);
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      pack_yuv422_row_sse2(y, c0, c1, packed, width, chroma_first);
+      break;
+#endif
+    default:
+      pack_yuv422_row_scalar(y, c0, c1, packed, width, chroma_first);
+      break;
+  }
+}
+
+void unpack_yuv422_row(const uint8_t* packed, uint8_t* y, uint8_t* c0, uint8_t* c1, uint32_t width, bool chroma_first) noexcept {
+  unpack_yuv422_row(myyuv::getSimdLevel(), packed, y, c0, c1, width, chroma_first);
+}
+
+void unpack_yuv422_row(myyuv::SimdLevel level, const uint8_t* packed, uint8_t* y, uint8_t* c0, uint8_t* c1, uint32_t width, bool chroma_first) noexcept {
+  assert(width % 2 == 0);
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      unpack_yuv422_rows_avx2<false>(packed, nullptr, y, nullptr, c0, c1, width, chroma_first);
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      unpack_yuv422_rows_sse2<false>(packed, nullptr, y, nullptr, c0, c1, width, chroma_first);
+      break;
+#endif
+    default:
+      unpack_yuv422_rows_scalar<false>(packed, nullptr, y, nullptr, c0, c1, width, chroma_first);
+      break;
+  }
+}
+
+void unpack_yuv422_rows_to_420(const uint8_t* top, const uint8_t* bottom, uint8_t* y_top, uint8_t* y_bottom, uint8_t* c0, uint8_t* c1, uint32_t width, bool chroma_first) noexcept {
+  unpack_yuv422_rows_to_420(myyuv::getSimdLevel(), top, bottom, y_top, y_bottom, c0, c1, width, chroma_first);
+}
+
+void unpack_yuv422_rows_to_420(myyuv::SimdLevel level, const uint8_t* top, const uint8_t* bottom, uint8_t* y_top, uint8_t* y_bottom, uint8_t* c0, uint8_t* c1, uint32_t width, bool chroma_first) noexcept {
+  assert(width % 2 == 0);
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      unpack_yuv422_rows_avx2<true>(top, bottom, y_top, y_bottom, c0, c1, width, chroma_first);
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      unpack_yuv422_rows_sse2<true>(top, bottom, y_top, y_bottom, c0, c1, width, chroma_first);
+      break;
+#endif
+    default:
+      unpack_yuv422_rows_scalar<true>(top, bottom, y_top, y_bottom, c0, c1, width, chroma_first);
+      break;
+  }
+}
+
+void swap_uv_row(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept {
+  swap_uv_row(myyuv::getSimdLevel(), src, dst, width);
+}
+
+void swap_uv_row(myyuv::SimdLevel level, const uint8_t* src, uint8_t* dst, uint32_t width) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      swap_uv_row_avx2(src, dst, width);
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      swap_uv_row_sse2(src, dst, width);
+      break;
+#endif
+    default:
+      swap_uv_row_scalar(src, dst, width);
+      break;
+  }
+}
+
+void shift_samples_row(const uint16_t* src, uint16_t* dst, uint32_t count, int32_t shift) noexcept {
+  shift_samples_row(myyuv::getSimdLevel(), src, dst, count, shift);
+}
+
+void shift_samples_row(myyuv::SimdLevel level, const uint16_t* src, uint16_t* dst, uint32_t count, int32_t shift) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  assert(shift > -16 && shift < 16);
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      shift_samples_row_avx2(src, dst, count, shift);
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      shift_samples_row_sse2(src, dst, count, shift);
+      break;
+#endif
+    default:
+      shift_samples_row_scalar(src, dst, count, shift);
+      break;
+  }
+}
+
+void widen_samples_row(const uint8_t* src, uint16_t* dst, uint32_t count, uint32_t shift) noexcept {
+  widen_samples_row(myyuv::getSimdLevel(), src, dst, count, shift);
+}
+
+void widen_samples_row(myyuv::SimdLevel level, const uint8_t* src, uint16_t* dst, uint32_t count, uint32_t shift) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  assert(shift <= 8);
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      widen_samples_row_avx2(src, dst, count, shift);
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      widen_samples_row_sse2(src, dst, count, shift);
+      break;
+#endif
+    default:
+      widen_samples_row_scalar(src, dst, count, shift);
+      break;
+  }
+}
+
+void narrow_samples_row(const uint16_t* src, uint8_t* dst, uint32_t count, uint32_t shift) noexcept {
+  narrow_samples_row(myyuv::getSimdLevel(), src, dst, count, shift);
+}
+
+void narrow_samples_row(myyuv::SimdLevel level, const uint16_t* src, uint8_t* dst, uint32_t count, uint32_t shift) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  assert(shift <= 8);
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      narrow_samples_row_avx2(src, dst, count, shift);
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      narrow_samples_row_sse2(src, dst, count, shift);
+      break;
+#endif
+    default:
+      narrow_samples_row_scalar(src, dst, count, shift);
+      break;
+  }
+}
+
+void average_rows(const uint8_t* a, const uint8_t* b, uint8_t* dst, uint32_t width) noexcept {
+  average_rows(myyuv::getSimdLevel(), a, b, dst, width);
+}
+
+void average_rows(myyuv::SimdLevel level, const uint8_t* a, const uint8_t* b, uint8_t* dst, uint32_t width) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      average_rows_avx2(a, b, dst, width);
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      average_rows_sse2(a, b, dst, width);
+      break;
+#endif
+    default:
+      average_rows_scalar(a, b, dst, width);
+      break;
+  }
+}
+
+void average_pairs_row(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept {
+  average_pairs_row(myyuv::getSimdLevel(), src, dst, width);
+}
+
+void average_pairs_row(myyuv::SimdLevel level, const uint8_t* src, uint8_t* dst, uint32_t width) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      average_pairs_row_avx2(src, dst, width);
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      average_pairs_row_sse2(src, dst, width);
+      break;
+#endif
+    default:
+      average_pairs_row_scalar(src, dst, width);
+      break;
+  }
+}
+
+void lerp_rows(const uint8_t* near, const uint8_t* far, uint8_t* dst, uint32_t width) noexcept {
+  lerp_rows(myyuv::getSimdLevel(), near, far, dst, width);
+}
+
+void lerp_rows(myyuv::SimdLevel level, const uint8_t* near, const uint8_t* far, uint8_t* dst, uint32_t width) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      lerp_rows_avx2(near, far, dst, width);
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      lerp_rows_sse2(near, far, dst, width);
+      break;
+#endif
+    default:
+      lerp_rows_scalar(near, far, dst, width);
+      break;
+  }
+}
+
+void upsample_pairs_row(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept {
+  upsample_pairs_row(myyuv::getSimdLevel(), src, dst, width);
+}
+
+void upsample_pairs_row(myyuv::SimdLevel level, const uint8_t* src, uint8_t* dst, uint32_t width) noexcept {
+  assert(level <= myyuv::detectSimdLevel());
+  switch (level) {
+#ifdef MYYUV_X86
+    case myyuv::SimdLevel::AVX2:
+      upsample_pairs_row_avx2(src, dst, width);
+      break;
+    case myyuv::SimdLevel::SSE41:
+    case myyuv::SimdLevel::SSE2:
+      upsample_pairs_row_sse2(src, dst, width);
+      break;
+#endif
+    default:
+      upsample_pairs_row_scalar(src, dst, 0, width, width);
+      break;
+  }
+}
+
+} // myyuvConvert
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <cstdint>
+#include "myyuv_cpu.hpp"
+
+namespace myyuvConvert {
+
+/**
+* @brief Converts a pair of XRGB8888 (BGRX in memory) rows into IYUV: two luma rows and one row of each chroma plane.
+* @note Picks the kernel according to `myyuv::getSimdLevel()`.
+* @param rgb_top Upper RGB row.
+* @param rgb_bottom Lower RGB row.
+* @param y_top Upper luma row.
+* @param y_bottom Lower luma row.
+* @param u Cb row (`width / 2` samples).
+* @param v Cr row (`width / 2` samples).
+* @param width Row width in pixels. Must be even.
+*/
+void rgb_to_iyuv_rows(const uint8_t* rgb_top, const uint8_t* rgb_bottom, uint8_t* y_top, uint8_t* y_bottom, uint8_t* u, uint8_t* v, uint32_t width) noexcept;
+
+/**
+* @brief Same as `rgb_to_iyuv_rows`, but with explicit kernel.
+* @note The scalar kernel is the reference, SIMD kernels are fixed-point and may differ from it by `rgb_to_iyuv_max_error`.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void rgb_to_iyuv_rows(myyuv::SimdLevel level, const uint8_t* rgb_top, const uint8_t* rgb_bottom, uint8_t* y_top, uint8_t* y_bottom, uint8_t* u, uint8_t* v, uint32_t width) noexcept;
+
+/**
+* @brief Converts a pair of XRGB8888 (BGRX in memory) rows into 4:2:0 planar rows of high bit depth samples.
+* @note Samples are `rgb_to_iyuv_rows` samples with the extra precision of the conversion instead of truncated to 8 bits. Picks the kernel according to `myyuv::getSimdLevel()`.
+* @param bits Sample bit depth, from 9 to 15.
+* @param shift Samples are stored in 16 bits shifted left by `shift` (6 for P010), `bits + shift` is at most 16.
+* @see rgb_to_iyuv_rows
+*/
+void rgb_to_iyuv_rows(const uint8_t* rgb_top, const uint8_t* rgb_bottom, uint16_t* y_top, uint16_t* y_bottom, uint16_t* u, uint16_t* v, uint32_t width, uint32_t bits, uint32_t shift) noexcept;
+
+/**
+* @brief Same as high bit depth `rgb_to_iyuv_rows`, but with explicit kernel.
+* @note SIMD kernels may differ from the scalar reference by `rgb_to_iyuv_max_error` in units of 8-bit samples.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void rgb_to_iyuv_rows(myyuv::SimdLevel level, const uint8_t* rgb_top, const uint8_t* rgb_bottom, uint16_t* y_top, uint16_t* y_bottom, uint16_t* u, uint16_t* v, uint32_t width, uint32_t bits, uint32_t shift) noexcept;
+
+/**
+* @brief Converts a XRGB8888 (BGRX in memory) row into YUV 4:2:2: a luma row and one row of each chroma plane.
+* @note Chroma is the same as `rgb_to_iyuv_rows` gives for the row repeated twice. Picks the kernel according to `myyuv::getSimdLevel()`.
+* @param rgb RGB row.
+* @param y Luma row.
+* @param u Cb row (`width / 2` samples).
+* @param v Cr row (`width / 2` samples).
+* @param width Row width in pixels. Must be even.
+*/
+void rgb_to_yuv422_row(const uint8_t* rgb, uint8_t* y, uint8_t* u, uint8_t* v, uint32_t width) noexcept;
+
+/**
+* @brief Same as `rgb_to_yuv422_row`, but with explicit kernel.
+* @note The scalar kernel is the reference, SIMD kernels may differ from it by `rgb_to_iyuv_max_error`.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void rgb_to_yuv422_row(myyuv::SimdLevel level, const uint8_t* rgb, uint8_t* y, uint8_t* u, uint8_t* v, uint32_t width) noexcept;
+
+/**
+* @brief Converts a XRGB8888 (BGRX in memory) row into YUV 4:4:4: a luma row and one row of each chroma plane with a sample for every pixel.
+* @note Picks the kernel according to `myyuv::getSimdLevel()`.
+* @param rgb RGB row.
+* @param y Luma row.
+* @param u Cb row (`width` samples).
+* @param v Cr row (`width` samples).
+* @param width Row width in pixels.
+*/
+void rgb_to_yuv444_row(const uint8_t* rgb, uint8_t* y, uint8_t* u, uint8_t* v, uint32_t width) noexcept;
+
+/**
+* @brief Same as `rgb_to_yuv444_row`, but with explicit kernel.
+* @note The scalar kernel is the reference, SIMD kernels may differ from it by `rgb_to_iyuv_max_error`.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void rgb_to_yuv444_row(myyuv::SimdLevel level, const uint8_t* rgb, uint8_t* y, uint8_t* u, uint8_t* v, uint32_t width) noexcept;
+
+/**
+* @brief Expands a RGB888 (BGR in memory) row into a XRGB8888 (BGRX in memory) row for the RGB kernels, X is 0.
+* @note Picks the kernel according to `myyuv::getSimdLevel()`.
+* @param bgr Source row (`width * 3` bytes).
+* @param bgrx Destination row (`width * 4` bytes).
+* @param width Row width in pixels.
+*/
+void bgr_to_bgrx_row(const uint8_t* bgr, uint8_t* bgrx, uint32_t width) noexcept;
+
+/**
+* @brief Same as `bgr_to_bgrx_row`, but with explicit kernel.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void bgr_to_bgrx_row(myyuv::SimdLevel level, const uint8_t* bgr, uint8_t* bgrx, uint32_t width) noexcept;
+
+/**
+* @brief Maximum absolute difference of any sample between SIMD kernels and scalar reference.
+* @note Luma differs by at most 1. Per-pixel chroma differs by at most 1 before averaging, each of 4 averaged quarters can round differently.
+*/
+static constexpr const uint32_t rgb_to_iyuv_max_error = 4;
+
+/**
+* @brief Interleaves two chroma rows into one row of pairs (semi-planar): `uv[2 * i] = u[i]`, `uv[2 * i + 1] = v[i]`.
+* @note Picks the kernel according to `myyuv::getSimdLevel()`.
+* @param u First chroma row.
+* @param v Second chroma row.
+* @param uv Row of pairs (`2 * width` bytes).
+* @param width Row width in samples of each chroma.
+*/
+void interleave_uv_row(const uint8_t* u, const uint8_t* v, uint8_t* uv, uint32_t width) noexcept;
+
+/**
+* @brief Same as `interleave_uv_row`, but with explicit kernel.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void interleave_uv_row(myyuv::SimdLevel level, const uint8_t* u, const uint8_t* v, uint8_t* uv, uint32_t width) noexcept;
+
+/**
+* @brief `interleave_uv_row` of high bit depth samples.
+*/
+void interleave_uv_row(const uint16_t* u, const uint16_t* v, uint16_t* uv, uint32_t width) noexcept;
+
+/**
+* @brief `interleave_uv_row` of high bit depth samples with explicit kernel.
+*/
+void interleave_uv_row(myyuv::SimdLevel level, const uint16_t* u, const uint16_t* v, uint16_t* uv, uint32_t width) noexcept;
+
+/**
+* @brief Deinterleaves row of chroma pairs (semi-planar) into two rows: `u[i] = uv[2 * i]`, `v[i] = uv[2 * i + 1]`.
+* @note Picks the kernel according to `myyuv::getSimdLevel()`.
+* @param uv Row of pairs (`2 * width` bytes).
+* @param u First chroma row.
+* @param v Second chroma row.
+* @param width Row width in samples of each chroma.
+*/
+void deinterleave_uv_row(const uint8_t* uv, uint8_t* u, uint8_t* v, uint32_t width) noexcept;
+
+/**
+* @brief Same as `deinterleave_uv_row`, but with explicit kernel.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void deinterleave_uv_row(myyuv::SimdLevel level, const uint8_t* uv, uint8_t* u, uint8_t* v, uint32_t width) noexcept;
+
+/**
+* @brief `deinterleave_uv_row` of high bit depth samples.
+*/
+void deinterleave_uv_row(const uint16_t* uv, uint16_t* u, uint16_t* v, uint32_t width) noexcept;
+
+/**
+* @brief `deinterleave_uv_row` of high bit depth samples with explicit kernel.
+*/
+void deinterleave_uv_row(myyuv::SimdLevel level, const uint16_t* uv, uint16_t* u, uint16_t* v, uint32_t width) noexcept;
+
+/**
+* @brief Packs a luma row and two chroma rows into a row of packed YUV 4:2:2 macropixels: `Y0 C0 Y1 C1` (YUY2) or `C0 Y0 C1 Y1` (UYVY).
+* @note Picks the kernel according to `myyuv::getSimdLevel()`.
+* @param y Luma row.
+* @param c0 Row of the chroma that goes first in a macropixel (`width / 2` samples).
+* @param c1 Row of the chroma that goes second in a macropixel (`width / 2` samples).
+* @param packed Packed row (`2 * width` bytes).
+* @param width Row width in pixels. Must be even.
+* @param chroma_first `true` if a macropixel starts with chroma (UYVY), `false` if with luma (YUY2).
+*/
+void pack_yuv422_row(const uint8_t* y, const uint8_t* c0, const uint8_t* c1, uint8_t* packed, uint32_t width, bool chroma_first) noexcept;
+
+/**
+* @brief Same as `pack_yuv422_row`, but with explicit kernel.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void pack_yuv422_row(myyuv::SimdLevel level, const uint8_t* y, const uint8_t* c0, const uint8_t* c1, uint8_t* packed, uint32_t width, bool chroma_first) noexcept;
+
+/**
+* @brief Unpacks a row of packed YUV 4:2:2 macropixels into a luma row and two chroma rows.
+* @note Picks the kernel according to `myyuv::getSimdLevel()`.
+* @see pack_yuv422_row
+*/
+void unpack_yuv422_row(const uint8_t* packed, uint8_t* y, uint8_t* c0, uint8_t* c1, uint32_t width, bool chroma_first) noexcept;
+
+/**
+* @brief Same as `unpack_yuv422_row`, but with explicit kernel.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void unpack_yuv422_row(myyuv::SimdLevel level, const uint8_t* packed, uint8_t* y, uint8_t* c0, uint8_t* c1, uint32_t width, bool chroma_first) noexcept;
+
+/**
+* @brief Unpacks two rows of packed YUV 4:2:2 macropixels into two luma rows and one row of each chroma (4:2:0), chroma of the rows is averaged.
+* @note Picks the kernel according to `myyuv::getSimdLevel()`.
+* @param top Upper packed row.
+* @param bottom Lower packed row.
+* @param y_top Upper luma row.
+* @param y_bottom Lower luma row.
+* @param c0 Row of the chroma that goes first in a macropixel (`width / 2` samples).
+* @param c1 Row of the chroma that goes second in a macropixel (`width / 2` samples).
+* @param width Row width in pixels. Must be even.
+* @param chroma_first `true` if a macropixel starts with chroma (UYVY), `false` if with luma (YUY2).
+*/
+void unpack_yuv422_rows_to_420(const uint8_t* top, const uint8_t* bottom, uint8_t* y_top, uint8_t* y_bottom, uint8_t* c0, uint8_t* c1, uint32_t width, bool chroma_first) noexcept;
+
+/**
+* @brief Same as `unpack_yuv422_rows_to_420`, but with explicit kernel.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void unpack_yuv422_rows_to_420(myyuv::SimdLevel level, const uint8_t* top, const uint8_t* bottom, uint8_t* y_top, uint8_t* y_bottom, uint8_t* c0, uint8_t* c1, uint32_t width, bool chroma_first) noexcept;
+
+/**
+* @brief Swaps chroma in every pair of a semi-planar row (NV12 <-> NV21): `dst[2 * i] = src[2 * i + 1]`, `dst[2 * i + 1] = src[2 * i]`.
+* @note Picks the kernel according to `myyuv::getSimdLevel()`. `src` and `dst` may be the same row.
+* @param src Row of pairs (`2 * width` samples).
+* @param dst Row of swapped pairs (`2 * width` samples).
+* @param width Pairs count.
+*/
+void swap_uv_row(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept;
+
+/**
+* @brief Same as `swap_uv_row`, but with explicit kernel.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void swap_uv_row(myyuv::SimdLevel level, const uint8_t* src, uint8_t* dst, uint32_t width) noexcept;
+
+/**
+* @brief Shifts high bit depth samples between low and high bits of 16 bits (I010 <-> P010): `dst[i] = src[i] << shift` or `src[i] >> -shift`.
+* @note Picks the kernel according to `myyuv::getSimdLevel()`. `src` and `dst` may be the same row.
+* @param count Samples count.
+* @param shift Shift to the left if positive, to the right if negative.
+*/
+void shift_samples_row(const uint16_t* src, uint16_t* dst, uint32_t count, int32_t shift) noexcept;
+
+/**
+* @brief Same as `shift_samples_row`, but with explicit kernel.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void shift_samples_row(myyuv::SimdLevel level, const uint16_t* src, uint16_t* dst, uint32_t count, int32_t shift) noexcept;
+
+/**
+* @brief Widens 8-bit samples into 16 bits of high bit depth samples (IYUV -> I010): `dst[i] = src[i] << shift`.
+* @note Picks the kernel according to `myyuv::getSimdLevel()`.
+* @param count Samples count.
+* @param shift Bit depth minus 8 plus the shift of the format, at most 8.
+*/
+void widen_samples_row(const uint8_t* src, uint16_t* dst, uint32_t count, uint32_t shift) noexcept;
+
+/**
+* @brief Same as `widen_samples_row`, but with explicit kernel.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void widen_samples_row(myyuv::SimdLevel level, const uint8_t* src, uint16_t* dst, uint32_t count, uint32_t shift) noexcept;
+
+/**
+* @brief Narrows high bit depth samples into 8 bits (I010 -> IYUV): `dst[i] = src[i] >> shift` saturated to 255.
+* @note Extra bits are truncated the same way the RGB conversion truncates 8-bit samples. Picks the kernel according to `myyuv::getSimdLevel()`.
+* @param count Samples count.
+* @param shift Bit depth minus 8 plus the shift of the format, at most 8.
+*/
+void narrow_samples_row(const uint16_t* src, uint8_t* dst, uint32_t count, uint32_t shift) noexcept;
+
+/**
+* @brief Same as `narrow_samples_row`, but with explicit kernel.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void narrow_samples_row(myyuv::SimdLevel level, const uint16_t* src, uint8_t* dst, uint32_t count, uint32_t shift) noexcept;
+
+/**
+* @brief Downsamples two chroma rows into one (4:2:2 -> 4:2:0): `dst[i] = (a[i] + b[i] + 1) / 2`.
+* @note Picks the kernel according to `myyuv::getSimdLevel()`. Every kernel gives the same result.
+* @param width Samples count of a row.
+*/
+void average_rows(const uint8_t* a, const uint8_t* b, uint8_t* dst, uint32_t width) noexcept;
+
+/**
+* @brief Same as `average_rows`, but with explicit kernel.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void average_rows(myyuv::SimdLevel level, const uint8_t* a, const uint8_t* b, uint8_t* dst, uint32_t width) noexcept;
+
+/**
+* @brief Downsamples chroma row horizontally (4:4:4 -> 4:2:2): `dst[i] = (src[2 * i] + src[2 * i + 1] + 1) / 2`.
+* @note Picks the kernel according to `myyuv::getSimdLevel()`. Every kernel gives the same result.
+* @param src Row of `2 * width` samples.
+* @param dst Row of `width` samples.
+* @param width Samples count of `dst`.
+*/
+void average_pairs_row(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept;
+
+/**
+* @brief Same as `average_pairs_row`, but with explicit kernel.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void average_pairs_row(myyuv::SimdLevel level, const uint8_t* src, uint8_t* dst, uint32_t width) noexcept;
+
+/**
+* @brief Interpolates chroma row between the nearest and the farther row of a lower resolution (4:2:0 -> 4:2:2): `dst[i] = (3 * near[i] + far[i] + 2) / 4`.
+* @note Picks the kernel according to `myyuv::getSimdLevel()`. Every kernel gives the same result.
+* @param width Samples count of a row.
+*/
+void lerp_rows(const uint8_t* near, const uint8_t* far, uint8_t* dst, uint32_t width) noexcept;
+
+/**
+* @brief Same as `lerp_rows`, but with explicit kernel.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void lerp_rows(myyuv::SimdLevel level, const uint8_t* near, const uint8_t* far, uint8_t* dst, uint32_t width) noexcept;
+
+/**
+* @brief Upsamples chroma row horizontally (4:2:2 -> 4:4:4): every sample becomes two samples interpolated like `lerp_rows` with its left and right neighbour, edges are clamped.
+* @note Picks the kernel according to `myyuv::getSimdLevel()`. Every kernel gives the same result.
+* @param src Row of `width` samples.
+* @param dst Row of `2 * width` samples.
+* @param width Samples count of `src`.
+*/
+void upsample_pairs_row(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept;
+
+/**
+* @brief Same as `upsample_pairs_row`, but with explicit kernel.
+* @param level Kernel SIMD level. Must be supported by the CPU.
+*/
+void upsample_pairs_row(myyuv::SimdLevel level, const uint8_t* src, uint8_t* dst, uint32_t width) noexcept;
+
+} // myyuvConvert
@@ -0,0 +1,108 @@
+#include "myyuv_cpu.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+
+static myyuv::SimdLevel detect() noexcept {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return myyuv::SimdLevel::AVX2;
+  }
+  if (__builtin_cpu_supports("sse4.1")) {
+    return myyuv::SimdLevel::SSE41;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return myyuv::SimdLevel::SSE2;
+  }
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  int info[4];
+  __cpuid(info, 0);
+  const int max_leaf = info[0];
+  __cpuid(info, 1);
+  const bool sse2 = (info[3] & (1 << 26)) != 0;
+  const bool sse41 = (info[2] & (1 << 19)) != 0;
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx = (info[2] & (1 << 28)) != 0;
+  if (max_leaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+    __cpuidex(info, 7, 0);
+    if (info[1] & (1 << 5)) {
+      return myyuv::SimdLevel::AVX2;
+    }
+  }
+  if (sse41) {
+    return myyuv::SimdLevel::SSE41;
+  }
+  if (sse2) {
+    return myyuv::SimdLevel::SSE2;
+  }
+#endif
+  return myyuv::SimdLevel::SCALAR;
+}
+
+static std::atomic<myyuv::SimdLevel>& currentLevel() noexcept {
+  static std::atomic<myyuv::SimdLevel> level(myyuv::detectSimdLevel());
+  return level;
+}
+
+static uint32_t hardwareThreads() noexcept {
+  const uint32_t count = std::thread::hardware_concurrency();
+  return count > 0 ? count : 1;
+}
+
+static std::atomic<uint32_t>& currentThreads() noexcept {
+  static std::atomic<uint32_t> count(hardwareThreads());
+  return count;
+}
+
+} // namespace
+
+namespace myyuv {
+
+SimdLevel detectSimdLevel() noexcept {
+  static const SimdLevel level = detect();
+  return level;
+}
+
+SimdLevel getSimdLevel() noexcept {
+  return currentLevel().load(std::memory_order_relaxed);
+}
+
+void setSimdLevel(SimdLevel level) {
+  if (level > detectSimdLevel()) {
+    throw std::runtime_error(std::string("SIMD level is not supported: ") + getSimdLevelName(level));
+  }
+  currentLevel().store(level, std::memory_order_relaxed);
+}
+
+const char* getSimdLevelName(SimdLevel level) noexcept {
+  switch (level) {
+    case SimdLevel::SCALAR:
+      return "scalar";
+    case SimdLevel::SSE2:
+      return "SSE2";
+    case SimdLevel::SSE41:
+      return "SSE4.1";
+    case SimdLevel::AVX2:
+      return "AVX2";
+  }
+  return "unknown";
+}
+
+uint32_t getThreadsCount() noexcept {
+  return currentThreads().load(std::memory_order_relaxed);
+}
+
+void setThreadsCount(uint32_t count) noexcept {
+  currentThreads().store(count > 0 ? count : hardwareThreads(), std::memory_order_relaxed);
+}
+
+} // myyuv
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+namespace myyuv {
+
+/**
+* @brief SIMD instruction set level used by conversion and compression kernels.
+* @note Levels are ordered: every level includes all the levels below it.
+*/
+enum class SimdLevel : uint8_t { SCALAR = 0, SSE2, SSE41, AVX2 };
+
+/**
+* @brief Detects the highest SIMD level supported by the CPU (and the build).
+* @return Highest supported SIMD level.
+*/
+SimdLevel detectSimdLevel() noexcept;
+
+/**
+* @brief Get SIMD level that is currently used by the kernels.
+* @note Defaults to `detectSimdLevel()`.
+* @return Current SIMD level.
+*/
+SimdLevel getSimdLevel() noexcept;
+
+/**
+* @brief Set SIMD level that will be used by the kernels. Useful for benchmarking and checking kernels against scalar reference.
+* @param level Requested SIMD level. Must not be higher than `detectSimdLevel()`.
+*/
+void setSimdLevel(SimdLevel level);
+
+/**
+* @brief Get human readable name of SIMD level.
+* @param level SIMD level.
+* @return Name of SIMD level.
+*/
+const char* getSimdLevelName(SimdLevel level) noexcept;
+
+/**
+* @brief Get number of threads that parallel kernels use.
+* @note Defaults to hardware concurrency.
+* @return Threads count (at least 1).
+*/
+uint32_t getThreadsCount() noexcept;
+
+/**
+* @brief Set number of threads that parallel kernels use.
+* @param count Requested threads count. `0` resets it to hardware concurrency.
+*/
+void setThreadsCount(uint32_t count) noexcept;
+
+} // myyuv
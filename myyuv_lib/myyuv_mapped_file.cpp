@@ -0,0 +1,105 @@
+#include "myyuv_mapped_file.hpp"
+
+#include <stdexcept>
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#define MYYUV_MAPPED_FILE_WIN32
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define MYYUV_MAPPED_FILE_POSIX
+#endif
+
+namespace myyuv {
+
+MappedFile::MappedFile(const std::string& path, Access access) {
+#if defined(MYYUV_MAPPED_FILE_POSIX)
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Error opening file to read " + path);
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+    ::close(fd);
+    throw std::runtime_error("Error empty or unreadable file " + path);
+  }
+  size = static_cast<uint64_t>(st.st_size);
+  // MAP_PRIVATE makes writes copy-on-write, the file is opened read-only
+  void* mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("Error mapping file " + path);
+  }
+  data = static_cast<uint8_t*>(mapping);
+#elif defined(MYYUV_MAPPED_FILE_WIN32)
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, access == Access::SEQUENTIAL ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error("Error opening file to read " + path);
+  }
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0) {
+    CloseHandle(file);
+    throw std::runtime_error("Error empty or unreadable file " + path);
+  }
+  size = static_cast<uint64_t>(file_size.QuadPart);
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    throw std::runtime_error("Error mapping file " + path);
+  }
+  // FILE_MAP_COPY makes writes copy-on-write, the view keeps the mapping alive
+  data = static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+  CloseHandle(mapping);
+  if (data == nullptr) {
+    throw std::runtime_error("Error mapping file " + path);
+  }
+#else
+  (void)access;
+  throw std::runtime_error("Error memory mapped files are not supported " + path);
+#endif
+  advise(access);
+}
+
+MappedFile::~MappedFile() {
+#if defined(MYYUV_MAPPED_FILE_POSIX)
+  ::munmap(data, size);
+#elif defined(MYYUV_MAPPED_FILE_WIN32)
+  UnmapViewOfFile(data);
+#endif
+}
+
+uint8_t* MappedFile::getData() const noexcept {
+  return data;
+}
+
+uint64_t MappedFile::getSize() const noexcept {
+  return size;
+}
+
+void MappedFile::advise(Access access) const noexcept {
+#if defined(MYYUV_MAPPED_FILE_POSIX)
+  // Only a hint, failure is not an error
+  ::madvise(data, size, access == Access::SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+#else
+  // Windows gets the hint from the file open flags
+  (void)access;
+#endif
+}
+
+bool MappedFile::isSupported() noexcept {
+#if defined(MYYUV_MAPPED_FILE_POSIX) || defined(MYYUV_MAPPED_FILE_WIN32)
+  return true;
+#else
+  return false;
+#endif
+}
+
+} // myyuv
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace myyuv {
+
+/**
+* @brief Private copy-on-write memory mapping of a whole file.
+* @details Pages are read from the file on first access. Writes go to private copies of the pages and never reach the file.
+*/
+class MappedFile {
+public:
+  /**
+  * @brief Expected access pattern, passed to the OS as a hint.
+  */
+  enum class Access : uint8_t {
+    SEQUENTIAL, /// The data is read once from start to end, so read ahead aggressively.
+    RANDOM, /// Only parts of the data are read, so don't read ahead.
+  };
+
+  /**
+  * @brief Maps the file.
+  * @param path File path.
+  * @param access Expected access pattern.
+  * @throws std::runtime_error if the file can't be opened or mapped.
+  */
+  MappedFile(const std::string& path, Access access);
+
+  /**
+  * @brief Destructor. Unmaps the file.
+  */
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /**
+  * @brief Get mapped data.
+  * @return Pointer to the first byte of the file.
+  */
+  uint8_t* getData() const noexcept;
+
+  /**
+  * @brief Get mapped data size.
+  * @return File size in bytes.
+  */
+  uint64_t getSize() const noexcept;
+
+  /**
+  * @brief Changes access pattern hint for the mapping.
+  * @param access Expected access pattern.
+  */
+  void advise(Access access) const noexcept;
+
+  /**
+  * @brief Checks if memory mapped files are supported on this platform.
+  * @return `true` if supported, `false` otherwise.
+  */
+  static bool isSupported() noexcept;
+private:
+  uint8_t* data = nullptr;
+  uint64_t size = 0;
+};
+
+} // myyuv
@@ -0,0 +1,61 @@
+#include "myyuv_parallel.hpp"
+
+#include "myyuv_cpu.hpp"
+#include <algorithm>
+#include <cassert>
+#ifdef MYYUV_USE_OPENMP
+#include <exception>
+#include <omp.h>
+#else
+#include "myyuv_thread_pool.hpp"
+#endif
+
+namespace myyuvParallel {
+
+void parallel_for_bands(uint32_t count, uint32_t min_band, const std::function<void(uint32_t, uint32_t)>& f) {
+  assert(min_band > 0);
+  const uint32_t bands = std::max<uint32_t>(1, std::min(myyuv::getThreadsCount(), count / min_band));
+  if (bands == 1) {
+    f(0, count);
+    return;
+  }
+  parallel_for_chunks(count, (count - 1) / bands + 1, f);
+}
+
+void parallel_for_chunks(uint32_t count, uint32_t chunk, const std::function<void(uint32_t, uint32_t)>& f) {
+  assert(chunk > 0);
+  if (count == 0) {
+    return;
+  }
+  const uint32_t chunks = (count - 1) / chunk + 1;
+  const uint32_t threads = std::min(myyuv::getThreadsCount(), chunks);
+#ifdef MYYUV_USE_OPENMP
+  if (threads == 1 || omp_in_parallel()) {
+    f(0, count);
+    return;
+  }
+  std::exception_ptr exception;
+  #pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+  for (int32_t c = 0; c < static_cast<int32_t>(chunks); c++) {
+    try {
+      f(c * chunk, std::min(count, (c + 1) * chunk));
+    } catch (...) {
+      #pragma omp critical
+      if (!exception) {
+        exception = std::current_exception();
+      }
+    }
+  }
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+#else
+  if (threads == 1 || myyuv::ThreadPool::isInsideTask()) {
+    f(0, count);
+    return;
+  }
+  myyuv::ThreadPool::getShared()->parallelFor(count, chunk, f);
+#endif
+}
+
+} // myyuvParallel
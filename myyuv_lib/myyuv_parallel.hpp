@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+namespace myyuvParallel {
+
+/**
+* @brief Splits `[0, count)` into contiguous bands and runs `f(begin, end)` for each band in parallel.
+* @note Uses OpenMP if the library is built with `MYYUV_USE_OPENMP`, shared `myyuv::ThreadPool` otherwise.
+* @note Exception thrown by any band is rethrown after all bands are finished.
+* @param count Amount of items.
+* @param min_band Minimum amount of items in a band, so small inputs don't pay for threads.
+* @param f Function that processes items `[begin, end)`.
+*/
+void parallel_for_bands(uint32_t count, uint32_t min_band, const std::function<void(uint32_t, uint32_t)>& f);
+
+/**
+* @brief Splits `[0, count)` into chunks of `chunk` items and runs `f(begin, end)` for each chunk in parallel, idle threads take the remaining chunks.
+* @note Uses OpenMP dynamic schedule if the library is built with `MYYUV_USE_OPENMP`, shared `myyuv::ThreadPool` otherwise.
+* @note When running on a single thread `f` may be called with a range of several chunks.
+* @note Exception thrown by any chunk is rethrown after all chunks are finished.
+* @param count Amount of items.
+* @param chunk Amount of items in a chunk.
+* @param f Function that processes items `[begin, end)`.
+*/
+void parallel_for_chunks(uint32_t count, uint32_t chunk, const std::function<void(uint32_t, uint32_t)>& f);
+
+} // myyuvParallel
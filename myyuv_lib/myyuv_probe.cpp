@@ -0,0 +1,88 @@
+#include "myyuv_probe.hpp"
+
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Enough for every header and the compression params written right after the YUV header
+static constexpr uint32_t probe_read_size = 512;
+static_assert(probe_read_size >= sizeof(myyuv::BMPHeader) + sizeof(myyuv::BMPColorHeader), "BMP headers don't fit");
+static_assert(probe_read_size >= sizeof(myyuv::YUVHeader), "YUV header doesn't fit");
+
+} // namespace
+
+namespace myyuv {
+
+ImageInfo probe(const std::string& path) {
+  ImageInfo res;
+  std::ifstream f(path, std::ios::binary | std::ios::ate);
+  if (!f) {
+    throw std::runtime_error("Error opening file to read " + path);
+  }
+  res.file_size = static_cast<uint64_t>(f.tellg());
+  f.seekg(0, f.beg);
+  uint8_t buf[probe_read_size];
+  const uint32_t buf_size = static_cast<uint32_t>(std::min<uint64_t>(res.file_size, probe_read_size));
+  f.read(reinterpret_cast<char*>(buf), buf_size);
+  if (static_cast<uint32_t>(f.gcount()) != buf_size) {
+    throw std::runtime_error("Error reading file " + path);
+  }
+  const BMPHeader bmp_header_default;
+  const YUVHeader yuv_header_default;
+  if (buf_size >= sizeof(bmp_header_default.type) && std::equal(bmp_header_default.type, bmp_header_default.type + sizeof(bmp_header_default.type), buf)) {
+    res.type = ImageInfo::Type::BMP;
+    if (buf_size < sizeof(BMPHeader)) {
+      return res;
+    }
+    BMP bmp;
+    std::copy(buf, buf + sizeof(BMPHeader), reinterpret_cast<uint8_t*>(&bmp.header));
+    if (bmp.header.bit_count == 32) {
+      if (buf_size < sizeof(BMPHeader) + sizeof(BMPColorHeader)) {
+        return res;
+      }
+      std::copy(buf + sizeof(BMPHeader), buf + sizeof(BMPHeader) + sizeof(BMPColorHeader), reinterpret_cast<uint8_t*>(&bmp.color_header));
+    }
+    res.bmp_header = bmp.header;
+    res.bmp_color_header = bmp.color_header;
+    res.width = bmp.trueWidth();
+    res.height = bmp.trueHeight();
+    res.valid = bmp.isValidHeader() && static_cast<uint64_t>(bmp.header.data_pos) + bmp.imageSize() <= res.file_size;
+  } else if (buf_size >= sizeof(yuv_header_default.type) && std::equal(yuv_header_default.type, yuv_header_default.type + sizeof(yuv_header_default.type), buf)) {
+    res.type = ImageInfo::Type::YUV;
+    if (buf_size < sizeof(YUVHeader)) {
+      return res;
+    }
+    YUV yuv;
+    std::copy(buf, buf + sizeof(YUVHeader), reinterpret_cast<uint8_t*>(&yuv.header));
+    res.yuv_header = yuv.header;
+    res.width = yuv.header.width;
+    res.height = yuv.header.height;
+    if (!yuv.isValidHeader()) {
+      return res;
+    }
+    const uint64_t params_end = static_cast<uint64_t>(yuv.header.compression_params_pos) + yuv.header.compression_params_size;
+    if (yuv.header.compression_params_size > 0) {
+      if (params_end > res.file_size) {
+        return res;
+      }
+      res.compression_params.resize(yuv.header.compression_params_size);
+      if (params_end <= buf_size) {
+        std::copy(buf + yuv.header.compression_params_pos, buf + params_end, res.compression_params.data());
+      } else {
+        f.seekg(yuv.header.compression_params_pos, f.beg);
+        f.read(reinterpret_cast<char*>(res.compression_params.data()), yuv.header.compression_params_size);
+        if (!f) {
+          throw std::runtime_error("Error reading file " + path);
+        }
+      }
+    }
+    // Uncompressed images are loaded with the size of the format, not the stored one
+    const uint32_t data_size = (yuv.getCompression() == YUV::Compressions::NONE) ? yuv.getImageSize() : yuv.header.data_size;
+    res.valid = static_cast<uint64_t>(yuv.header.data_pos) + data_size <= res.file_size;
+  }
+  return res;
+}
+
+} // myyuv
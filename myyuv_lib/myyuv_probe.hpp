@@ -0,0 +1,52 @@
+#pragma once
+
+#include "myyuv_bmp.hpp"
+#include "myyuv_yuv.hpp"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace myyuv {
+
+/**
+* @brief Image information read from file headers only.
+* @var type Image format found by the file magic.
+* @var valid Whether the header is valid and the file is big enough for the image data.
+* @var file_size Actual file size in bytes.
+* @var width Image width (absolute value for BMP).
+* @var height Image height (absolute value for BMP).
+* @var bmp_header BMP header as stored in the file. Set only for `Type::BMP`.
+* @var bmp_color_header BMP color header as stored in the file. Set only for 32 bit `Type::BMP`.
+* @var yuv_header YUV header as stored in the file. Set only for `Type::YUV`.
+* @var compression_params YUV compression params. Set only for `Type::YUV`.
+*/
+struct ImageInfo {
+  /**
+  * @brief Image format.
+  */
+  enum class Type : uint8_t {
+    UNKNOWN,
+    BMP,
+    YUV,
+  };
+  Type type = Type::UNKNOWN;
+  bool valid = false;
+  uint64_t file_size = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  BMPHeader bmp_header;
+  BMPColorHeader bmp_color_header;
+  YUVHeader yuv_header;
+  std::vector<uint8_t> compression_params;
+};
+
+/**
+* @brief Reads and validates image headers without reading image data.
+* @details Headers and compression params that follow them are read with one small read. Params stored further in the file cost one more read.
+* @param path Image file path.
+* @return Image information. Unknown magic gives `Type::UNKNOWN`, bad headers give `valid == false`.
+* @throws std::runtime_error if the file can't be opened.
+*/
+ImageInfo probe(const std::string& path);
+
+} // myyuv
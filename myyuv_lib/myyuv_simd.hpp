@@ -0,0 +1,16 @@
+#pragma once
+
+// Internal helpers for SIMD kernels with runtime dispatch.
+// Kernels for every instruction set live in the same translation unit, each one is compiled
+// for its own target with `MYYUV_TARGET`, so the library itself is built for the baseline CPU.
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define MYYUV_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MYYUV_TARGET(x) __attribute__((target(x)))
+#else
+#define MYYUV_TARGET(x)
+#endif
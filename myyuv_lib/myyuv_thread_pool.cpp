@@ -0,0 +1,168 @@
+#include "myyuv_thread_pool.hpp"
+
+#include "myyuv_cpu.hpp"
+#include <algorithm>
+#include <exception>
+#include <cassert>
+
+namespace {
+
+// Whether the current thread runs a task, see `ThreadPool::isInsideTask`
+static thread_local bool inside_task = false;
+
+} // namespace
+
+namespace myyuv {
+
+struct ThreadPool::Job {
+  const std::function<void(uint32_t, uint32_t)>& f;
+  // Guards `remaining` and `exception`
+  std::mutex mutex;
+  std::condition_variable done;
+  uint32_t remaining;
+  std::exception_ptr exception;
+  Job(const std::function<void(uint32_t, uint32_t)>& f, uint32_t remaining) : f(f), remaining(remaining) {}
+};
+
+ThreadPool::ThreadPool(uint32_t threads) : pending(0) {
+  threads_count = threads > 0 ? threads : std::max<uint32_t>(1, std::thread::hardware_concurrency());
+  queues.reset(new Queue[threads_count]);
+  workers.reserve(threads_count - 1);
+  for (uint32_t i = 0; i + 1 < threads_count; i++) {
+    workers.emplace_back(&ThreadPool::workerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex);
+    stop = true;
+  }
+  wake.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+uint32_t ThreadPool::getThreadsCount() const noexcept {
+  return threads_count;
+}
+
+bool ThreadPool::popTask(uint32_t index, Task& task) {
+  assert(index < threads_count);
+  {
+    Queue& own = queues[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = own.tasks.back();
+      own.tasks.pop_back();
+      pending--;
+      return true;
+    }
+  }
+  for (uint32_t i = 1; i < threads_count; i++) {
+    Queue& victim = queues[(index + i) % threads_count];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = victim.tasks.front();
+      victim.tasks.pop_front();
+      pending--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::runTask(const Task& task) {
+  Job& job = *task.job;
+  const bool inside_task_prev = inside_task;
+  inside_task = true;
+  std::exception_ptr exception;
+  try {
+    job.f(task.begin, task.end);
+  } catch (...) {
+    exception = std::current_exception();
+  }
+  inside_task = inside_task_prev;
+  // The job lives on the stack of `parallelFor`, it must not be touched after the mutex is released
+  std::lock_guard<std::mutex> lock(job.mutex);
+  if (exception && !job.exception) {
+    job.exception = exception;
+  }
+  assert(job.remaining > 0);
+  if (--job.remaining == 0) {
+    job.done.notify_all();
+  }
+}
+
+void ThreadPool::workerLoop(uint32_t index) {
+  while (true) {
+    Task task;
+    if (popTask(index, task)) {
+      runTask(task);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    wake.wait(lock, [this]() { return stop || pending.load() > 0; });
+    if (stop) {
+      return;
+    }
+  }
+}
+
+void ThreadPool::parallelFor(uint32_t count, uint32_t chunk, const std::function<void(uint32_t, uint32_t)>& f) {
+  assert(chunk > 0);
+  if (count == 0) {
+    return;
+  }
+  const uint32_t chunks = (count - 1) / chunk + 1;
+  if (chunks == 1 || threads_count == 1 || inside_task) {
+    f(0, count);
+    return;
+  }
+  Job job(f, chunks);
+  // Every queue gets a contiguous range of chunks, so threads that don't steal keep locality
+  for (uint32_t q = 0; q < threads_count; q++) {
+    const uint32_t chunks_begin = static_cast<uint32_t>(static_cast<uint64_t>(chunks) * q / threads_count);
+    const uint32_t chunks_end = static_cast<uint32_t>(static_cast<uint64_t>(chunks) * (q + 1) / threads_count);
+    if (chunks_begin == chunks_end) {
+      continue;
+    }
+    Queue& queue = queues[q];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    for (uint32_t c = chunks_begin; c < chunks_end; c++) {
+      queue.tasks.push_back({ &job, c * chunk, std::min(count, (c + 1) * chunk) });
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex);
+    pending += chunks;
+  }
+  wake.notify_all();
+  Task task;
+  while (popTask(threads_count - 1, task)) {
+    runTask(task);
+  }
+  std::unique_lock<std::mutex> lock(job.mutex);
+  job.done.wait(lock, [&job]() { return job.remaining == 0; });
+  if (job.exception) {
+    std::rethrow_exception(job.exception);
+  }
+}
+
+bool ThreadPool::isInsideTask() noexcept {
+  return inside_task;
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::getShared() {
+  static std::mutex mutex;
+  static std::shared_ptr<ThreadPool> pool;
+  const uint32_t threads = myyuv::getThreadsCount();
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!pool || pool->getThreadsCount() != threads) {
+    pool = std::make_shared<ThreadPool>(threads);
+  }
+  return pool;
+}
+
+} // myyuv
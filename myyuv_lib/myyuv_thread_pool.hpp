@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace myyuv {
+
+/**
+* @brief Pool of worker threads with work stealing.
+* @details Every thread owns a deque of tasks. A thread takes tasks from the back of its own deque and steals from the front of other deques when its own is empty.
+* The thread that calls `parallelFor` runs tasks too, so the pool of `n` threads starts `n - 1` workers.
+*/
+class ThreadPool {
+public:
+  /**
+  * @brief Constructor.
+  * @param threads Threads count including the calling thread. `0` means hardware concurrency.
+  */
+  explicit ThreadPool(uint32_t threads);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+  * @brief Get threads count including the calling thread.
+  * @return Threads count (at least 1).
+  */
+  uint32_t getThreadsCount() const noexcept;
+
+  /**
+  * @brief Splits `[0, count)` into chunks of `chunk` items and runs `f(begin, end)` for each chunk in parallel. Returns when all chunks are finished.
+  * @note When there is nothing to run in parallel, `f` is called once with `[0, count)`.
+  * @note Calls from inside a task run in the calling thread, so nested loops don't oversubscribe.
+  * @note Exception thrown by any chunk is rethrown after all chunks are finished.
+  * @param count Amount of items.
+  * @param chunk Amount of items in a task.
+  * @param f Function that processes items `[begin, end)`.
+  */
+  void parallelFor(uint32_t count, uint32_t chunk, const std::function<void(uint32_t, uint32_t)>& f);
+
+  /**
+  * @brief Whether the current thread runs a task of any pool.
+  */
+  static bool isInsideTask() noexcept;
+
+  /**
+  * @brief Get the pool used by the library.
+  * @note The pool has `myyuv::getThreadsCount()` threads. It is recreated when that count changes, the previous pool is kept alive by its users.
+  * @return Shared pool.
+  */
+  static std::shared_ptr<ThreadPool> getShared();
+private:
+  struct Job;
+  struct Task {
+    Job* job;
+    uint32_t begin;
+    uint32_t end;
+  };
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool popTask(uint32_t index, Task& task);
+  void runTask(const Task& task);
+  void workerLoop(uint32_t index);
+
+  uint32_t threads_count;
+  // One queue per thread, the last one is shared by threads that call `parallelFor`
+  std::unique_ptr<Queue[]> queues;
+  std::vector<std::thread> workers;
+  std::mutex wake_mutex;
+  std::condition_variable wake;
+  // Amount of queued tasks, may be negative for a moment while tasks are pushed
+  std::atomic<int32_t> pending;
+  bool stop = false;
+};
+
+} // myyuv
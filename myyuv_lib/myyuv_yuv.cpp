@@ -1,65 +1,643 @@
 #include "myyuv_yuv.hpp"
 
+#include "myyuv_parallel.hpp"
 #include <exception>
 #include <fstream>
 #include <stdexcept>
 #include <cassert>
 #include <limits>
+#include <vector>
+#include <algorithm>
+#include <memory>
 
 namespace myyuvDCT {
 
-extern myyuv::YUV compress_DCT_planar(const myyuv::YUV& yuv, const std::array<uint8_t, 3>& params);
+extern myyuv::YUV compress_DCT_planar(const myyuv::ConstYUVView& src, const std::array<uint8_t, 3>& params);
+extern void compress_DCT_planar(const myyuv::ConstYUVView& src, const std::array<uint8_t, 3>& params, std::ostream& out);
 extern myyuv::YUV decompress_DCT_planar(const myyuv::YUV& yuv, const std::array<uint8_t, 3>& params);
+extern void decompress_DCT_planar(const myyuv::YUV& yuv, const std::array<uint8_t, 3>& params, const myyuv::YUVView& dst);
 
 } // myyuvDCT
 
+namespace myyuvConvert {
+
+extern void rgb_to_iyuv_rows(const uint8_t* rgb_top, const uint8_t* rgb_bottom, uint8_t* y_top, uint8_t* y_bottom, uint8_t* u, uint8_t* v, uint32_t width) noexcept;
+extern void rgb_to_iyuv_rows(const uint8_t* rgb_top, const uint8_t* rgb_bottom, uint16_t* y_top, uint16_t* y_bottom, uint16_t* u, uint16_t* v, uint32_t width, uint32_t bits, uint32_t shift) noexcept;
+extern void bgr_to_bgrx_row(const uint8_t* bgr, uint8_t* bgrx, uint32_t width) noexcept;
+extern void interleave_uv_row(const uint8_t* u, const uint8_t* v, uint8_t* uv, uint32_t width) noexcept;
+extern void interleave_uv_row(const uint16_t* u, const uint16_t* v, uint16_t* uv, uint32_t width) noexcept;
+extern void rgb_to_yuv422_row(const uint8_t* rgb, uint8_t* y, uint8_t* u, uint8_t* v, uint32_t width) noexcept;
+extern void rgb_to_yuv444_row(const uint8_t* rgb, uint8_t* y, uint8_t* u, uint8_t* v, uint32_t width) noexcept;
+extern void pack_yuv422_row(const uint8_t* y, const uint8_t* c0, const uint8_t* c1, uint8_t* packed, uint32_t width, bool chroma_first) noexcept;
+extern void unpack_yuv422_row(const uint8_t* packed, uint8_t* y, uint8_t* c0, uint8_t* c1, uint32_t width, bool chroma_first) noexcept;
+extern void unpack_yuv422_rows_to_420(const uint8_t* top, const uint8_t* bottom, uint8_t* y_top, uint8_t* y_bottom, uint8_t* c0, uint8_t* c1, uint32_t width, bool chroma_first) noexcept;
+extern void deinterleave_uv_row(const uint8_t* uv, uint8_t* u, uint8_t* v, uint32_t width) noexcept;
+extern void deinterleave_uv_row(const uint16_t* uv, uint16_t* u, uint16_t* v, uint32_t width) noexcept;
+extern void swap_uv_row(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept;
+extern void shift_samples_row(const uint16_t* src, uint16_t* dst, uint32_t count, int32_t shift) noexcept;
+extern void widen_samples_row(const uint8_t* src, uint16_t* dst, uint32_t count, uint32_t shift) noexcept;
+extern void narrow_samples_row(const uint16_t* src, uint8_t* dst, uint32_t count, uint32_t shift) noexcept;
+extern void average_rows(const uint8_t* a, const uint8_t* b, uint8_t* dst, uint32_t width) noexcept;
+extern void average_pairs_row(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept;
+extern void lerp_rows(const uint8_t* near, const uint8_t* far, uint8_t* dst, uint32_t width) noexcept;
+extern void upsample_pairs_row(const uint8_t* src, uint8_t* dst, uint32_t width) noexcept;
+
+} // myyuvConvert
+
 namespace {
 
-// https://stackoverflow.com/a/58568736
+template<typename T, typename U>
+inline static bool mapKeyExist(const std::unordered_map<T, U>& map, const T& key) noexcept {
+  return map.find(key) != map.end();
+}
+
+static constexpr std::array<uint8_t*, myyuv::YUV::max_planes> planes_const_cast(const std::array<const uint8_t*, myyuv::YUV::max_planes>& arr) {
+  std::array<uint8_t*, myyuv::YUV::max_planes> res{};
+  for (uint8_t i = 0; i < myyuv::YUV::max_planes; i++) {
+    res[i] = const_cast<uint8_t*>(arr[i]);
+  }
+  return res;
+}
+
+static std::array<uint8_t, 3> getDCTParams(const void* params, uint32_t params_size, const char* error) {
+  if (params_size != 3) {
+    throw std::runtime_error(error);
+  }
+  std::array<uint8_t, 3> p;
+  for (int i = 0; i < 3; i++) {
+    p[i] = reinterpret_cast<const uint8_t*>(params)[i];
+  }
+  return p;
+}
+
+// DCT handles every planar, semi-planar and packed format, so the same functions are registered for all of them
+
+static myyuv::YUV compressDCT(const myyuv::ConstYUVView& src, const void* params, uint32_t params_size) {
+  return myyuvDCT::compress_DCT_planar(src, getDCTParams(params, params_size, "Error compression: incorrect parameters count. 3 parameters required"));
+}
+
+static void compressDCTTo(const myyuv::ConstYUVView& src, const void* params, uint32_t params_size, std::ostream& out) {
+  myyuvDCT::compress_DCT_planar(src, getDCTParams(params, params_size, "Error compression: incorrect parameters count. 3 parameters required"), out);
+}
+
+static myyuv::YUV decompressDCT(const myyuv::YUV& yuv) {
+  assert(yuv.getCompression() == myyuv::YUV::Compressions::DCT);
+  return myyuvDCT::decompress_DCT_planar(yuv, getDCTParams(yuv.compression_params, yuv.header.compression_params_size, "Error decompression: incorrect parameters count. 3 parameters required"));
+}
+
+static void decompressDCTTo(const myyuv::YUV& yuv, const myyuv::YUVView& dst) {
+  assert(yuv.getCompression() == myyuv::YUV::Compressions::DCT);
+  myyuvDCT::decompress_DCT_planar(yuv, getDCTParams(yuv.compression_params, yuv.header.compression_params_size, "Error decompression: incorrect parameters count. 3 parameters required"), dst);
+}
+
+/**
+* Color rows of a BMP image for the conversion kernels.
+* Rows are read directly in their stored order (both bottom-up and top-down), only mirrored images (negative width) are read from a flipped copy.
+* Kernels take BGRX pixels, so 24-bit rows are expanded into a buffer of the caller.
+*/
+class BMPRows {
+public:
+  /**
+  * @throws std::runtime_error if the BMP image is neither 24-bit nor 32-bit.
+  */
+  explicit BMPRows(const myyuv::BMP& bmp) : bmp(bmp), stride(bmp.trueWidth() * bmp.header.bit_count / 8) {
+    assert(bmp.isValid());
+    if (bmp.header.bit_count != 32 && bmp.header.bit_count != 24) {
+      throw std::runtime_error("Error. Only 24-bit and 32-bit BMP images can be converted to YUV");
+    }
+    if (bmp.header.width < 0) {
+      mirrored.reset(bmp.colorData());
+    }
+  }
+
+  /**
+  * Bytes of a buffer `row` needs for a row, 0 if rows are read in place.
+  */
+  uint32_t bufferSize() const noexcept {
+    return bmp.header.bit_count == 24 ? bmp.trueWidth() * 4 : 0;
+  }
+
+  /**
+  * Gets BGRX pixels of row `y` counting from the top.
+  * @param buffer `bufferSize` bytes to expand a 24-bit row into, the row stays valid until the buffer is reused.
+  */
+  const uint8_t* row(uint32_t y, uint8_t* buffer) const {
+    const uint8_t* res = mirrored ? mirrored.get() + static_cast<size_t>(y) * stride : bmp.colorRow(y);
+    if (bmp.header.bit_count == 24) {
+      myyuvConvert::bgr_to_bgrx_row(res, buffer, bmp.trueWidth());
+      return buffer;
+    }
+    return res;
+  }
+
+private:
+  const myyuv::BMP& bmp;
+  std::unique_ptr<const uint8_t[]> mirrored;
+  uint32_t stride;
+};
+
+/**
+* Converts BMP into planar view with chroma subsampled `FractionX` times horizontally and `FractionY` times vertically.
+* Every subsampling has its own row loop and kernel, so 4:2:0 doesn't pay for the others.
+*/
+template <uint32_t FractionX, uint32_t FractionY>
+static void bmpToPlanar(const myyuv::BMP& bmp, const myyuv::YUVView& dst) {
+  static_assert((FractionX == 2 && FractionY == 2) || (FractionX == 2 && FractionY == 1) || (FractionX == 1 && FractionY == 1), "Only 4:2:0, 4:2:2 and 4:4:4 are supported");
+  const BMPRows rgb(bmp);
+  assert(myyuv::YUV::getFormatGroup(dst.fourcc_format) == myyuv::YUV::FormatGroup::PLANAR && dst.isValid());
+  assert(dst.pixel_strides[0] == 1 && dst.pixel_strides[1] == 1 && dst.pixel_strides[2] == 1);
+  const uint32_t width = bmp.trueWidth();
+  const uint32_t height = bmp.trueHeight();
+  assert(dst.width == width && dst.height == height);
+  assert(width % FractionX == 0 && height % FractionY == 0);
+  // Horizontal bands of rows that share chroma rows are independent
+  myyuvParallel::parallel_for_bands(height / FractionY, 16, [&](uint32_t begin, uint32_t end) {
+    std::vector<uint8_t> bgrx(rgb.bufferSize() * FractionY);
+    uint8_t* const buffers[2] = { bgrx.data(), bgrx.data() + rgb.bufferSize() };
+    for (uint32_t j = begin * FractionY; j < end * FractionY; j += FractionY) {
+      if constexpr (FractionY == 2) {
+        myyuvConvert::rgb_to_iyuv_rows(rgb.row(j, buffers[0]), rgb.row(j + 1, buffers[1]), dst.row(0, j), dst.row(0, j + 1), dst.row(1, j / 2), dst.row(2, j / 2), width);
+      } else if constexpr (FractionX == 2) {
+        myyuvConvert::rgb_to_yuv422_row(rgb.row(j, buffers[0]), dst.row(0, j), dst.row(1, j), dst.row(2, j), width);
+      } else {
+        myyuvConvert::rgb_to_yuv444_row(rgb.row(j, buffers[0]), dst.row(0, j), dst.row(1, j), dst.row(2, j), width);
+      }
+    }
+  });
+}
+
+/**
+* Converts BMP into 4:2:0 semi-planar view: rows of chroma planes are converted into temporary rows and interleaved.
+*/
+static void bmpToSemiPlanar420(const myyuv::BMP& bmp, const myyuv::YUVView& dst) {
+  const BMPRows rgb(bmp);
+  assert(myyuv::YUV::getFormatGroup(dst.fourcc_format) == myyuv::YUV::FormatGroup::SEMI_PLANAR && dst.isValid());
+  const uint32_t width = bmp.trueWidth();
+  const uint32_t height = bmp.trueHeight();
+  assert(dst.width == width && dst.height == height);
+  assert(width % 2 == 0 && height % 2 == 0);
+  assert(dst.pixel_strides[1] == 2 && dst.pixel_strides[2] == 2 && dst.strides[1] == dst.strides[2]);
+  // the first channel in a pair goes first to the kernel
+  const uint8_t first = dst.planes[1] < dst.planes[2] ? 1 : 2;
+  assert(dst.planes[3 - first] == dst.planes[first] + 1);
+  myyuvParallel::parallel_for_bands(height / 2, 16, [&](uint32_t begin, uint32_t end) {
+    std::vector<uint8_t> chroma(width);
+    uint8_t* const rows[3] = { nullptr, chroma.data(), chroma.data() + width / 2 };
+    std::vector<uint8_t> bgrx(rgb.bufferSize() * 2);
+    uint8_t* const buffers[2] = { bgrx.data(), bgrx.data() + rgb.bufferSize() };
+    for (uint32_t j = begin * 2; j < end * 2; j += 2) {
+      myyuvConvert::rgb_to_iyuv_rows(rgb.row(j, buffers[0]), rgb.row(j + 1, buffers[1]), dst.row(0, j), dst.row(0, j + 1), rows[1], rows[2], width);
+      myyuvConvert::interleave_uv_row(rows[first], rows[3 - first], dst.row(first, j / 2), width / 2);
+    }
+  });
+}
+
+/**
+* Converts BMP into 4:2:0 planar or semi-planar view of high bit depth samples.
+* Semi-planar chroma goes through temporary rows like `bmpToSemiPlanar420`.
+*/
+static void bmpToHighBitDepth420(const myyuv::BMP& bmp, const myyuv::YUVView& dst) {
+  const BMPRows rgb(bmp);
+  const auto format_group = myyuv::YUV::getFormatGroup(dst.fourcc_format);
+  assert((format_group == myyuv::YUV::FormatGroup::PLANAR || format_group == myyuv::YUV::FormatGroup::SEMI_PLANAR) && dst.isValid());
+  const auto sample_bits = myyuv::YUV::getSampleBits(dst.fourcc_format);
+  assert(sample_bits[0] > 8 && myyuv::YUV::getBytesPerSample(dst.fourcc_format) == 2);
+  const bool semi_planar = format_group == myyuv::YUV::FormatGroup::SEMI_PLANAR;
+  assert(dst.pixel_strides[0] == 2 && dst.pixel_strides[1] == (semi_planar ? 4 : 2) && dst.pixel_strides[2] == dst.pixel_strides[1]);
+  const uint32_t width = bmp.trueWidth();
+  const uint32_t height = bmp.trueHeight();
+  assert(dst.width == width && dst.height == height);
+  assert(width % 2 == 0 && height % 2 == 0);
+  const uint8_t first = dst.planes[1] < dst.planes[2] ? 1 : 2;
+  assert(!semi_planar || dst.planes[3 - first] == dst.planes[first] + 2);
+  auto row16 = [&dst](uint8_t channel, uint32_t y) {
+    return reinterpret_cast<uint16_t*>(dst.row(channel, y));
+  };
+  myyuvParallel::parallel_for_bands(height / 2, 16, [&](uint32_t begin, uint32_t end) {
+    std::vector<uint16_t> chroma(semi_planar ? width : 0);
+    uint16_t* const rows[3] = { nullptr, chroma.data(), chroma.data() + width / 2 };
+    std::vector<uint8_t> bgrx(rgb.bufferSize() * 2);
+    uint8_t* const buffers[2] = { bgrx.data(), bgrx.data() + rgb.bufferSize() };
+    for (uint32_t j = begin * 2; j < end * 2; j += 2) {
+      const uint8_t* rgb_top = rgb.row(j, buffers[0]);
+      const uint8_t* rgb_bottom = rgb.row(j + 1, buffers[1]);
+      if (semi_planar) {
+        myyuvConvert::rgb_to_iyuv_rows(rgb_top, rgb_bottom, row16(0, j), row16(0, j + 1), rows[1], rows[2], width, sample_bits[0], sample_bits[1]);
+        myyuvConvert::interleave_uv_row(rows[first], rows[3 - first], row16(first, j / 2), width / 2);
+      } else {
+        myyuvConvert::rgb_to_iyuv_rows(rgb_top, rgb_bottom, row16(0, j), row16(0, j + 1), row16(1, j / 2), row16(2, j / 2), width, sample_bits[0], sample_bits[1]);
+      }
+    }
+  });
+}
+
+/**
+* Macropixel rows of a packed 4:2:2 view start at `data`, `chroma[0]` and `chroma[1]` are the channels of the first and the second chroma in a macropixel.
+*/
 template <typename T>
-static T divide_roundnearest(T numer, T denom) noexcept {
-  static_assert(std::numeric_limits<T>::is_integer, "Only integer types are allowed");
+struct Packed422 {
+  T* data;
+  uint32_t stride;
+  bool chroma_first;
+  std::array<uint8_t, 2> chroma;
+};
+
+/**
+* Gets macropixels of a packed 4:2:2 view.
+* @throws std::runtime_error if planes of the view don't point into the same macropixels as the format describes.
+*/
+template <typename T>
+static Packed422<T> getPacked422(const myyuv::BasicYUVView<T>& view) {
+  const std::array<uint8_t, 4>& layout = myyuv::YUV::yuv_packed_layout_map.at(view.fourcc_format);
+  Packed422<T> res;
+  res.chroma_first = layout[0] != 0;
+  res.data = view.planes[0] - (res.chroma_first ? 1 : 0);
+  res.stride = view.strides[0];
+  res.chroma = { layout[res.chroma_first ? 0 : 1], layout[res.chroma_first ? 2 : 3] };
+  const auto pixel_strides = myyuv::YUV::getPixelStrides(view.fourcc_format);
+  std::array<uint8_t, 3> first = { 4, 4, 4 };
+  for (uint8_t i = 4; i > 0; i--) {
+    first[layout[i - 1]] = i - 1;
+  }
+  for (uint8_t c = 0; c < 3; c++) {
+    if (view.planes[c] != res.data + first[c] || view.strides[c] != res.stride || view.pixel_strides[c] != pixel_strides[c]) {
+      throw std::runtime_error("Error. Samples of packed YUV must be interleaved macropixels");
+    }
+  }
+  return res;
+}
+
+/**
+* Converts BMP into packed 4:2:2 view: every row is converted into temporary planar rows and packed.
+*/
+static void bmpToPacked422(const myyuv::BMP& bmp, const myyuv::YUVView& dst) {
+  const BMPRows rgb(bmp);
+  assert(myyuv::YUV::getFormatGroup(dst.fourcc_format) == myyuv::YUV::FormatGroup::PACKED && dst.isValid());
+  const uint32_t width = bmp.trueWidth();
+  const uint32_t height = bmp.trueHeight();
+  assert(dst.width == width && dst.height == height);
+  assert(width % 2 == 0);
+  const Packed422<uint8_t> packed = getPacked422(dst);
+  myyuvParallel::parallel_for_bands(height, 16, [&](uint32_t begin, uint32_t end) {
+    std::vector<uint8_t> planar(width * 2);
+    uint8_t* const rows[3] = { planar.data(), planar.data() + width, planar.data() + width * 3 / 2 };
+    std::vector<uint8_t> bgrx(rgb.bufferSize());
+    for (uint32_t j = begin; j < end; j++) {
+      myyuvConvert::rgb_to_yuv422_row(rgb.row(j, bgrx.data()), rows[0], rows[1], rows[2], width);
+      myyuvConvert::pack_yuv422_row(rows[0], rows[packed.chroma[0]], rows[packed.chroma[1]], packed.data + static_cast<size_t>(j) * packed.stride, width, packed.chroma_first);
+    }
+  });
+}
 
-  T result = ((numer) < 0) != ((denom) < 0) ?
-    ((numer) - ((denom)/2)) / (denom) :
-    ((numer) + ((denom)/2)) / (denom);
-  return result;
+/**
+* Allocates uncompressed YUV image of `format` and converts BMP into it with `YUV::bmp_to_yuv_view_map`.
+*/
+static myyuv::YUV bmpToNewYUV(myyuv::YUV::FourccFormat format, const myyuv::BMP& bmp) {
+  assert(bmp.isValid());
+  myyuv::YUV res = myyuv::YUV::allocate(format, bmp.trueWidth(), bmp.trueHeight());
+  myyuv::YUV::bmp_to_yuv_view_map.at(format)(bmp, res.view());
+  return res;
 }
 
-// https://stackoverflow.com/a/36835959
-static inline constexpr unsigned char operator"" _uchar(unsigned long long arg) noexcept {
-  return static_cast<unsigned char>(arg);
+/**
+* Interpolates chroma row `y` of 4:2:2 from chroma rows of planar 4:2:0 view: 3/4 of the nearest row and 1/4 of the next nearest one.
+* Edge rows are interpolated with themselves.
+*/
+static void lerpChromaRow420(const myyuv::ConstYUVView& src, uint8_t channel, uint32_t y, uint8_t* dst) {
+  const auto chroma_size = src.getWidthHeightChannel(channel);
+  const uint32_t k = y / 2;
+  const uint32_t far = y % 2 == 0 ? (k > 0 ? k - 1 : 0) : (k + 1 < chroma_size[1] ? k + 1 : k);
+  myyuvConvert::lerp_rows(src.row(channel, k), src.row(channel, far), dst, chroma_size[0]);
 }
 
-static inline void getYUV444FromRGB2x2(uint8_t yuv444[12], uint32_t i, uint32_t j, const uint8_t* rbg, uint32_t width, uint32_t pixel_bits) noexcept {
-  const uint32_t pixel_bytes = pixel_bits / 8;
-  const uint32_t loc = i + j * width;
-  const uint32_t loc_down = loc + width;
-  const uint32_t loc_ayuv = loc * pixel_bytes;
-  const uint32_t loc_down_ayuv = loc_down * pixel_bytes;
-  const uint32_t locs[4] = { loc_ayuv, loc_ayuv + pixel_bytes, loc_down_ayuv, loc_down_ayuv + pixel_bytes };
-  uint32_t jj = 0;
-  for (uint32_t ii = 0; ii < 12; ii += 3) {
-    const float B = static_cast<float>(rbg[locs[jj]]);
-    const float G = static_cast<float>(rbg[locs[jj] + 1]);
-    const float R = static_cast<float>(rbg[locs[jj] + 2]);
-    const float Y = 0.299f * R + 0.587f * G + 0.114f * B;
-    yuv444[ii] = static_cast<uint8_t>(Y); // Y
-    yuv444[ii + 1] = static_cast<uint8_t>((B - Y) * 0.564f) + 128; // Cb
-    yuv444[ii + 2] = static_cast<uint8_t>((R - Y) * 0.713f) + 128; // Cr
-    jj++;
+/**
+* Converts planar 4:2:0 view into packed 4:2:2 view: chroma rows are interpolated like `planar420ToPlanar422` into temporary rows and packed.
+*/
+static void planar420ToPacked422(const myyuv::ConstYUVView& src, const myyuv::YUVView& dst) {
+  assert(src.pixel_strides[0] == 1 && src.pixel_strides[1] == 1 && src.pixel_strides[2] == 1);
+  if (src.height % 2 != 0) {
+    throw std::runtime_error("Error. height % 2 must be 0");
   }
+  const Packed422<uint8_t> packed = getPacked422(dst);
+  const uint32_t chroma_width = src.getWidthHeightChannel(1)[0];
+  myyuvParallel::parallel_for_bands(src.height / 2, 16, [&](uint32_t begin, uint32_t end) {
+    std::vector<uint8_t> chroma(chroma_width * 2);
+    uint8_t* const rows[3] = { nullptr, chroma.data(), chroma.data() + chroma_width };
+    for (uint32_t j = begin * 2; j < end * 2; j++) {
+      lerpChromaRow420(src, 1, j, rows[1]);
+      lerpChromaRow420(src, 2, j, rows[2]);
+      myyuvConvert::pack_yuv422_row(src.row(0, j), rows[packed.chroma[0]], rows[packed.chroma[1]], packed.data + static_cast<size_t>(j) * packed.stride, src.width, packed.chroma_first);
+    }
+  });
 }
 
-template<typename T, typename U>
-inline static bool mapKeyExist(const std::unordered_map<T, U>& map, const T& key) noexcept {
-  return map.find(key) != map.end();
+/**
+* Converts packed 4:2:2 view into planar 4:2:0 view, chroma of every two rows is averaged.
+*/
+static void packed422ToPlanar420(const myyuv::ConstYUVView& src, const myyuv::YUVView& dst) {
+  assert(dst.pixel_strides[0] == 1 && dst.pixel_strides[1] == 1 && dst.pixel_strides[2] == 1);
+  if (src.height % 2 != 0) {
+    throw std::runtime_error("Error. height % 2 must be 0");
+  }
+  const Packed422<const uint8_t> packed = getPacked422(src);
+  myyuvParallel::parallel_for_bands(src.height / 2, 16, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t j = begin * 2; j < end * 2; j += 2) {
+      const uint8_t* top = packed.data + static_cast<size_t>(j) * packed.stride;
+      myyuvConvert::unpack_yuv422_rows_to_420(top, top + packed.stride, dst.row(0, j), dst.row(0, j + 1), dst.row(packed.chroma[0], j / 2), dst.row(packed.chroma[1], j / 2), src.width, packed.chroma_first);
+    }
+  });
 }
 
-static constexpr std::array<uint8_t*, myyuv::YUV::max_planes> planes_const_cast(const std::array<const uint8_t*, myyuv::YUV::max_planes>& arr) {
-  std::array<uint8_t*, myyuv::YUV::max_planes> res{};
+/**
+* Converts packed 4:2:2 view into packed 4:2:2 view with another order of macropixel bytes through temporary planar rows.
+*/
+static void packed422ToPacked422(const myyuv::ConstYUVView& src, const myyuv::YUVView& dst) {
+  const Packed422<const uint8_t> src_packed = getPacked422(src);
+  const Packed422<uint8_t> dst_packed = getPacked422(dst);
+  const uint32_t width = src.width;
+  myyuvParallel::parallel_for_bands(src.height, 16, [&](uint32_t begin, uint32_t end) {
+    std::vector<uint8_t> planar(width * 2);
+    uint8_t* const rows[3] = { planar.data(), planar.data() + width, planar.data() + width * 3 / 2 };
+    for (uint32_t j = begin; j < end; j++) {
+      myyuvConvert::unpack_yuv422_row(src_packed.data + static_cast<size_t>(j) * src_packed.stride, rows[0], rows[src_packed.chroma[0]], rows[src_packed.chroma[1]], width, src_packed.chroma_first);
+      myyuvConvert::pack_yuv422_row(rows[0], rows[dst_packed.chroma[0]], rows[dst_packed.chroma[1]], dst_packed.data + static_cast<size_t>(j) * dst_packed.stride, width, dst_packed.chroma_first);
+    }
+  });
+}
+
+/**
+* Copies samples of a view into a view of the same format, rows of planes are copied at once.
+*/
+static void copyView(const myyuv::ConstYUVView& src, const myyuv::YUVView& dst) {
+  assert(src.fourcc_format == dst.fourcc_format && src.width == dst.width && src.height == dst.height);
+  const uint32_t sample_bytes = myyuv::YUV::getBytesPerSample(src.fourcc_format);
   for (uint8_t i = 0; i < myyuv::YUV::max_planes; i++) {
-    res[i] = const_cast<uint8_t*>(arr[i]);
+    const auto width_height = src.getWidthHeightChannel(i);
+    for (uint32_t j = 0; j < width_height[1]; j++) {
+      if (src.pixel_strides[i] == sample_bytes && dst.pixel_strides[i] == sample_bytes) {
+        std::copy(src.row(i, j), src.row(i, j) + width_height[0] * sample_bytes, dst.row(i, j));
+      } else {
+        for (uint32_t x = 0; x < width_height[0]; x++) {
+          std::copy_n(src.sample(i, x, j), sample_bytes, dst.sample(i, x, j));
+        }
+      }
+    }
+  }
+}
+
+/**
+* Chroma of a planar or semi-planar view: `semi_planar` if both chroma are interleaved pairs of one plane, `first` is the channel that goes first in memory.
+*/
+struct ChromaLayout {
+  bool semi_planar;
+  uint8_t first;
+};
+
+/**
+* Gets chroma layout of a planar or semi-planar view.
+* @throws std::runtime_error if samples are neither planes nor interleaved pairs.
+*/
+static ChromaLayout getChromaLayout(const myyuv::ConstYUVView& view) {
+  const uint32_t sample_bytes = myyuv::YUV::getBytesPerSample(view.fourcc_format);
+  ChromaLayout res;
+  res.semi_planar = view.pixel_strides[1] == 2 * sample_bytes;
+  res.first = view.planes[1] < view.planes[2] ? 1 : 2;
+  if (view.pixel_strides[0] != sample_bytes || view.pixel_strides[1] != view.pixel_strides[2] || (!res.semi_planar && view.pixel_strides[1] != sample_bytes) ||
+    (res.semi_planar && (view.planes[3 - res.first] != view.planes[res.first] + sample_bytes || view.strides[1] != view.strides[2]))) {
+    throw std::runtime_error("Error. Chroma samples must be planes or interleaved pairs");
+  }
+  return res;
+}
+
+/**
+* Copies planes into a view with the same subsampling and sample size: reorders planes, interleaves, deinterleaves or swaps chroma pairs,
+* and moves high bit depth samples between low and high bits.
+*/
+static void copyPlanes(const myyuv::ConstYUVView& src, const myyuv::YUVView& dst) {
+  const uint32_t sample_bytes = myyuv::YUV::getBytesPerSample(src.fourcc_format);
+  assert(sample_bytes == myyuv::YUV::getBytesPerSample(dst.fourcc_format));
+  assert(myyuv::YUV::yuv_resolution_fraction_map.at(src.fourcc_format) == myyuv::YUV::yuv_resolution_fraction_map.at(dst.fourcc_format));
+  const ChromaLayout src_chroma = getChromaLayout(src);
+  const ChromaLayout dst_chroma = getChromaLayout(dst);
+  const int32_t shift = static_cast<int32_t>(myyuv::YUV::getSampleBits(dst.fourcc_format)[1]) - myyuv::YUV::getSampleBits(src.fourcc_format)[1];
+  if (sample_bytes != 1 && src_chroma.semi_planar && dst_chroma.semi_planar && src_chroma.first != dst_chroma.first) {
+    throw std::runtime_error("Error. Swapping high bit depth chroma pairs is unimplemented");
+  }
+  auto row16 = [](const uint8_t* row) {
+    return reinterpret_cast<uint16_t*>(const_cast<uint8_t*>(row));
+  };
+  auto copy_row = [&](const uint8_t* from, uint8_t* to, uint32_t count) {
+    if (shift == 0) {
+      std::copy(from, from + static_cast<size_t>(count) * sample_bytes, to);
+    } else {
+      myyuvConvert::shift_samples_row(row16(from), row16(to), count, shift);
+    }
+  };
+  auto shift_row = [&](uint8_t* row, uint32_t count) {
+    if (shift != 0) {
+      myyuvConvert::shift_samples_row(row16(row), row16(row), count, shift);
+    }
+  };
+  const auto chroma_size = src.getWidthHeightChannel(1);
+  const uint32_t luma_rows = src.height / chroma_size[1];
+  // Bands of chroma rows with their luma rows are independent
+  myyuvParallel::parallel_for_bands(chroma_size[1], 16, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t j = begin * luma_rows; j < end * luma_rows; j++) {
+      copy_row(src.row(0, j), dst.row(0, j), src.width);
+    }
+    const uint32_t width = chroma_size[0];
+    for (uint32_t j = begin; j < end; j++) {
+      if (!src_chroma.semi_planar && !dst_chroma.semi_planar) {
+        copy_row(src.row(1, j), dst.row(1, j), width);
+        copy_row(src.row(2, j), dst.row(2, j), width);
+      } else if (src_chroma.semi_planar && dst_chroma.semi_planar) {
+        if (src_chroma.first == dst_chroma.first) {
+          copy_row(src.row(src_chroma.first, j), dst.row(dst_chroma.first, j), 2 * width);
+        } else {
+          myyuvConvert::swap_uv_row(src.row(src_chroma.first, j), dst.row(dst_chroma.first, j), width);
+        }
+      } else if (src_chroma.semi_planar) {
+        const uint8_t first = src_chroma.first;
+        if (sample_bytes == 1) {
+          myyuvConvert::deinterleave_uv_row(src.row(first, j), dst.row(first, j), dst.row(3 - first, j), width);
+        } else {
+          myyuvConvert::deinterleave_uv_row(row16(src.row(first, j)), row16(dst.row(first, j)), row16(dst.row(3 - first, j)), width);
+        }
+        shift_row(dst.row(1, j), width);
+        shift_row(dst.row(2, j), width);
+      } else {
+        const uint8_t first = dst_chroma.first;
+        if (sample_bytes == 1) {
+          myyuvConvert::interleave_uv_row(src.row(first, j), src.row(3 - first, j), dst.row(first, j), width);
+        } else {
+          myyuvConvert::interleave_uv_row(row16(src.row(first, j)), row16(src.row(3 - first, j)), row16(dst.row(first, j)), width);
+        }
+        shift_row(dst.row(first, j), 2 * width);
+      }
+    }
+  });
+}
+
+/**
+* Converts planar view into planar view with the same subsampling and another bit depth, one of them has 8-bit samples.
+* 8-bit samples are widened into high bits of the bit depth, high bit depth samples are narrowed by truncating the extra bits.
+*/
+static void planarToBitDepth(const myyuv::ConstYUVView& src, const myyuv::YUVView& dst) {
+  const auto src_bits = myyuv::YUV::getSampleBits(src.fourcc_format);
+  const auto dst_bits = myyuv::YUV::getSampleBits(dst.fourcc_format);
+  const bool widen = src_bits[0] == 8;
+  assert(widen != (dst_bits[0] == 8));
+  assert(myyuv::YUV::yuv_resolution_fraction_map.at(src.fourcc_format) == myyuv::YUV::yuv_resolution_fraction_map.at(dst.fourcc_format));
+  const auto& high_bits = widen ? dst_bits : src_bits;
+  const uint32_t shift = high_bits[0] - 8u + high_bits[1];
+  for (uint8_t c = 0; c < 3; c++) {
+    if (src.pixel_strides[c] != myyuv::YUV::getBytesPerSample(src.fourcc_format) || dst.pixel_strides[c] != myyuv::YUV::getBytesPerSample(dst.fourcc_format)) {
+      throw std::runtime_error("Error. Samples of planar YUV must be planes");
+    }
+  }
+  const auto chroma_size = src.getWidthHeightChannel(1);
+  const uint32_t luma_rows = src.height / chroma_size[1];
+  auto convert_row = [&](uint8_t channel, uint32_t y, uint32_t count) {
+    if (widen) {
+      myyuvConvert::widen_samples_row(src.row(channel, y), reinterpret_cast<uint16_t*>(dst.row(channel, y)), count, shift);
+    } else {
+      myyuvConvert::narrow_samples_row(reinterpret_cast<const uint16_t*>(src.row(channel, y)), dst.row(channel, y), count, shift);
+    }
+  };
+  // Bands of chroma rows with their luma rows are independent
+  myyuvParallel::parallel_for_bands(chroma_size[1], 16, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t j = begin * luma_rows; j < end * luma_rows; j++) {
+      convert_row(0, j, src.width);
+    }
+    for (uint32_t j = begin; j < end; j++) {
+      convert_row(1, j, chroma_size[0]);
+      convert_row(2, j, chroma_size[0]);
+    }
+  });
+}
+
+// Chroma resampling between 8-bit planar views, luma is copied
+
+/**
+* Converts planar 4:2:0 view into planar 4:2:2 view: every chroma row is interpolated with the nearest row above or below.
+*/
+static void planar420ToPlanar422(const myyuv::ConstYUVView& src, const myyuv::YUVView& dst) {
+  assert(src.pixel_strides[0] == 1 && src.pixel_strides[1] == 1 && src.pixel_strides[2] == 1);
+  assert(dst.pixel_strides[0] == 1 && dst.pixel_strides[1] == 1 && dst.pixel_strides[2] == 1);
+  if (src.height % 2 != 0) {
+    throw std::runtime_error("Error. height % 2 must be 0");
+  }
+  myyuvParallel::parallel_for_bands(src.height / 2, 16, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t j = begin * 2; j < end * 2; j++) {
+      std::copy(src.row(0, j), src.row(0, j) + src.width, dst.row(0, j));
+      lerpChromaRow420(src, 1, j, dst.row(1, j));
+      lerpChromaRow420(src, 2, j, dst.row(2, j));
+    }
+  });
+}
+
+/**
+* Converts planar 4:2:2 view into planar 4:2:0 view: every two chroma rows are averaged.
+*/
+static void planar422ToPlanar420(const myyuv::ConstYUVView& src, const myyuv::YUVView& dst) {
+  assert(src.pixel_strides[0] == 1 && src.pixel_strides[1] == 1 && src.pixel_strides[2] == 1);
+  assert(dst.pixel_strides[0] == 1 && dst.pixel_strides[1] == 1 && dst.pixel_strides[2] == 1);
+  if (src.height % 2 != 0) {
+    throw std::runtime_error("Error. height % 2 must be 0");
+  }
+  const auto chroma_size = dst.getWidthHeightChannel(1);
+  myyuvParallel::parallel_for_bands(chroma_size[1], 16, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t k = begin; k < end; k++) {
+      std::copy(src.row(0, 2 * k), src.row(0, 2 * k) + src.width, dst.row(0, 2 * k));
+      std::copy(src.row(0, 2 * k + 1), src.row(0, 2 * k + 1) + src.width, dst.row(0, 2 * k + 1));
+      for (uint8_t c = 1; c < 3; c++) {
+        myyuvConvert::average_rows(src.row(c, 2 * k), src.row(c, 2 * k + 1), dst.row(c, k), chroma_size[0]);
+      }
+    }
+  });
+}
+
+/**
+* Converts planar 4:2:2 view into planar 4:4:4 view: every chroma sample is interpolated with its left and right neighbour.
+*/
+static void planar422ToPlanar444(const myyuv::ConstYUVView& src, const myyuv::YUVView& dst) {
+  assert(src.pixel_strides[0] == 1 && src.pixel_strides[1] == 1 && src.pixel_strides[2] == 1);
+  assert(dst.pixel_strides[0] == 1 && dst.pixel_strides[1] == 1 && dst.pixel_strides[2] == 1);
+  const uint32_t chroma_width = src.getWidthHeightChannel(1)[0];
+  myyuvParallel::parallel_for_bands(src.height, 16, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t j = begin; j < end; j++) {
+      std::copy(src.row(0, j), src.row(0, j) + src.width, dst.row(0, j));
+      myyuvConvert::upsample_pairs_row(src.row(1, j), dst.row(1, j), chroma_width);
+      myyuvConvert::upsample_pairs_row(src.row(2, j), dst.row(2, j), chroma_width);
+    }
+  });
+}
+
+/**
+* Converts planar 4:4:4 view into planar 4:2:2 view: every two chroma samples of a row are averaged.
+*/
+static void planar444ToPlanar422(const myyuv::ConstYUVView& src, const myyuv::YUVView& dst) {
+  assert(src.pixel_strides[0] == 1 && src.pixel_strides[1] == 1 && src.pixel_strides[2] == 1);
+  assert(dst.pixel_strides[0] == 1 && dst.pixel_strides[1] == 1 && dst.pixel_strides[2] == 1);
+  if (src.width % 2 != 0) {
+    throw std::runtime_error("Error. width % 2 must be 0");
+  }
+  const uint32_t chroma_width = dst.getWidthHeightChannel(1)[0];
+  myyuvParallel::parallel_for_bands(src.height, 16, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t j = begin; j < end; j++) {
+      std::copy(src.row(0, j), src.row(0, j) + src.width, dst.row(0, j));
+      myyuvConvert::average_pairs_row(src.row(1, j), dst.row(1, j), chroma_width);
+      myyuvConvert::average_pairs_row(src.row(2, j), dst.row(2, j), chroma_width);
+    }
+  });
+}
+
+/**
+* Converts planar 4:2:2 view into packed 4:2:2 view, samples are only moved.
+*/
+static void planar422ToPacked422(const myyuv::ConstYUVView& src, const myyuv::YUVView& dst) {
+  assert(src.pixel_strides[0] == 1 && src.pixel_strides[1] == 1 && src.pixel_strides[2] == 1);
+  const Packed422<uint8_t> packed = getPacked422(dst);
+  myyuvParallel::parallel_for_bands(src.height, 16, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t j = begin; j < end; j++) {
+      myyuvConvert::pack_yuv422_row(src.row(0, j), src.row(packed.chroma[0], j), src.row(packed.chroma[1], j), packed.data + static_cast<size_t>(j) * packed.stride, src.width, packed.chroma_first);
+    }
+  });
+}
+
+/**
+* Converts packed 4:2:2 view into planar 4:2:2 view, samples are only moved.
+*/
+static void packed422ToPlanar422(const myyuv::ConstYUVView& src, const myyuv::YUVView& dst) {
+  assert(dst.pixel_strides[0] == 1 && dst.pixel_strides[1] == 1 && dst.pixel_strides[2] == 1);
+  const Packed422<const uint8_t> packed = getPacked422(src);
+  myyuvParallel::parallel_for_bands(src.height, 16, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t j = begin; j < end; j++) {
+      myyuvConvert::unpack_yuv422_row(packed.data + static_cast<size_t>(j) * packed.stride, dst.row(0, j), dst.row(packed.chroma[0], j), dst.row(packed.chroma[1], j), src.width, packed.chroma_first);
+    }
+  });
+}
+
+/**
+* Gets pixel of any uncompressed format with planes: chroma is taken from the sample that covers the pixel.
+* High bit depth samples are truncated to 8 bits.
+*/
+static std::array<uint8_t, myyuv::YUV::max_planes> getPixelFromView(const myyuv::YUV& yuv, uint32_t x, uint32_t y) {
+  const myyuv::ConstYUVView view = yuv.view();
+  const auto sample_bits = myyuv::YUV::getSampleBits(view.fourcc_format);
+  std::array<uint8_t, myyuv::YUV::max_planes> res{0};
+  for (uint8_t i = 0; i < myyuv::YUV::max_planes; i++) {
+    const auto width_height = view.getWidthHeightChannel(i);
+    if (width_height[0] != 0) {
+      const uint8_t* sample = view.sample(i, x / (view.width / width_height[0]), y / (view.height / width_height[1]));
+      if (sample_bits[0] > 8) {
+        // little endian
+        const uint32_t value = static_cast<uint32_t>(sample[0]) | static_cast<uint32_t>(sample[1]) << 8;
+        res[i] = static_cast<uint8_t>((value >> sample_bits[1]) >> (sample_bits[0] - 8));
+      } else {
+        res[i] = *sample;
+      }
+    }
   }
   return res;
 }
@@ -73,89 +651,136 @@ static_assert(YUV::no_plane >= YUV::max_planes, "no_plane can't be less than max
 
 std::unordered_map<YUV::FourccFormat, YUV::FormatGroup> YUV::yuv_format_group_map = {
   { FourccFormats::IYUV /* 0x56555949 */, FormatGroup::PLANAR },
+  { FourccFormats::NV12 /* 0x3231564E */, FormatGroup::SEMI_PLANAR },
+  { FourccFormats::NV21 /* 0x3132564E */, FormatGroup::SEMI_PLANAR },
+  { FourccFormats::I444 /* 0x34343449 */, FormatGroup::PLANAR },
+  { FourccFormats::I422 /* 0x32323449 */, FormatGroup::PLANAR },
+  { FourccFormats::YUY2 /* 0x32595559 */, FormatGroup::PACKED },
+  { FourccFormats::UYVY /* 0x59565955 */, FormatGroup::PACKED },
+  { FourccFormats::I010 /* 0x30313049 */, FormatGroup::PLANAR },
+  { FourccFormats::P010 /* 0x30313050 */, FormatGroup::SEMI_PLANAR },
+  { FourccFormats::YV12 /* 0x32315659 */, FormatGroup::PLANAR },
 };
 
 // Order of planes
 // Example: YUV -> 0, 1, 2 ; YVU -> 0, 2, 1
 std::unordered_map<YUV::FourccFormat, std::array<uint8_t, YUV::max_planes>> YUV::yuv_order_planes_map = {
   { FourccFormats::IYUV, { 0, 1, 2, no_plane } },
+  { FourccFormats::NV12, { 0, 1, 2, no_plane } },
+  { FourccFormats::NV21, { 0, 2, 1, no_plane } },
+  { FourccFormats::I444, { 0, 1, 2, no_plane } },
+  { FourccFormats::I422, { 0, 1, 2, no_plane } },
+  { FourccFormats::YUY2, { 0, 1, 2, no_plane } },
+  { FourccFormats::UYVY, { 1, 0, 2, no_plane } },
+  { FourccFormats::I010, { 0, 1, 2, no_plane } },
+  { FourccFormats::P010, { 0, 1, 2, no_plane } },
+  { FourccFormats::YV12, { 0, 2, 1, no_plane } },
+};
+
+// Channels of bytes of a macropixel (2 pixels)
+// Example: YUY2 (Y0 U Y1 V) -> 0, 1, 0, 2
+std::unordered_map<YUV::FourccFormat, std::array<uint8_t, 4>> YUV::yuv_packed_layout_map = {
+  { FourccFormats::YUY2, { 0, 1, 0, 2 } },
+  { FourccFormats::UYVY, { 1, 0, 2, 0 } },
 };
 
 std::unordered_map<YUV::FourccFormat, std::array<uint32_t, 2>> YUV::yuv_resolution_fraction_map = {
   { FourccFormats::IYUV, { 2, 2 } },
+  { FourccFormats::NV12, { 2, 2 } },
+  { FourccFormats::NV21, { 2, 2 } },
+  { FourccFormats::I444, { 1, 1 } },
+  { FourccFormats::I422, { 2, 1 } },
+  { FourccFormats::YUY2, { 2, 1 } },
+  { FourccFormats::UYVY, { 2, 1 } },
+  { FourccFormats::I010, { 2, 2 } },
+  { FourccFormats::P010, { 2, 2 } },
+  { FourccFormats::YV12, { 2, 2 } },
 };
 
-std::unordered_map<YUV::FourccFormat, std::function<YUV(const BMP&)>> YUV::bmp_to_yuv_map = {
-  { FourccFormats::IYUV, [](const BMP& bmp)->YUV {
-    constexpr const FourccFormat format = FourccFormats::IYUV;
-    assert(bmp.isValid());
-    assert(bmp.header.bit_count == 32); // TODO: test 24
-    YUV res;
-    res.header.fourcc_format = static_cast<uint32_t>(format);
-    //std::array<uint32_t, 3> data_size_bits = yuv_format_size_bits_map.at(format);
-    const uint32_t width = bmp.trueWidth();
-    const uint32_t height = bmp.trueHeight();
-    assert(width % 2 == 0 && height % 2 == 0);
-    uint8_t* data = bmp.colorData();
-    res.header.width = width;
-    res.header.height = height;
-    res.header.data_size = width * height * 3 / 2; // width * height + width * height / 2
-    res.header.data_pos = sizeof(YUVHeader);
-    res.data = new uint8_t[res.header.data_size];
-    uint8_t* y = res.data;
-    uint8_t* u = &(res.data[width * height]);
-    uint8_t* v = &(res.data[width * height * 5 / 4]);
-    for (uint32_t j = 0; j < height; j += 2) {
-      for (uint32_t i = 0; i < width; i += 2) {
-        const uint32_t loc = i + j * width;
-        const uint32_t loc_down = loc + width;
-        uint8_t yuv444[12];
-        getYUV444FromRGB2x2(yuv444, i, j, data, width, bmp.header.bit_count);
-        const uint8_t Cb = divide_roundnearest(yuv444[1], 4_uchar) + divide_roundnearest(yuv444[4], 4_uchar) + divide_roundnearest(yuv444[7], 4_uchar) + divide_roundnearest(yuv444[10], 4_uchar);
-        const uint8_t Cr = divide_roundnearest(yuv444[2], 4_uchar) + divide_roundnearest(yuv444[5], 4_uchar) + divide_roundnearest(yuv444[8], 4_uchar) + divide_roundnearest(yuv444[11], 4_uchar);
-        y[loc] = yuv444[0];
-        y[loc + 1] = yuv444[3];
-        y[loc_down] = yuv444[6];
-        y[loc_down + 1] = yuv444[9];
-        const uint32_t k = (i + j * width / 2) / 2;
-        u[k] = Cb;
-        v[k] = Cr;
-      }
-    }
-    delete[] data;
-    return res;
+std::unordered_map<YUV::FourccFormat, std::array<uint8_t, 2>> YUV::yuv_sample_bits_map = {
+  { FourccFormats::I010, { 10, 0 } },
+  { FourccFormats::P010, { 10, 6 } },
+};
+
+std::unordered_map<YUV::FourccFormat, std::function<void(const BMP&, const YUVView&)>> YUV::bmp_to_yuv_view_map = {
+  { FourccFormats::IYUV, bmpToPlanar<2, 2> },
+  { FourccFormats::I422, bmpToPlanar<2, 1> },
+  { FourccFormats::I444, bmpToPlanar<1, 1> },
+  { FourccFormats::NV12, bmpToSemiPlanar420 },
+  { FourccFormats::NV21, bmpToSemiPlanar420 },
+  { FourccFormats::YUY2, bmpToPacked422 },
+  { FourccFormats::UYVY, bmpToPacked422 },
+  { FourccFormats::I010, bmpToHighBitDepth420 },
+  { FourccFormats::P010, bmpToHighBitDepth420 },
+  { FourccFormats::YV12, bmpToPlanar<2, 2> },
+};
+
+std::unordered_map<YUV::FourccFormat, std::function<YUV(const BMP&)>> YUV::bmp_to_yuv_map = [] {
+  std::unordered_map<FourccFormat, std::function<YUV(const BMP&)>> res;
+  for (const auto& format_convert : bmp_to_yuv_view_map) {
+    const FourccFormat format = format_convert.first;
+    res.emplace(format, [format](const BMP& bmp) { return bmpToNewYUV(format, bmp); });
+  }
+  return res;
+}();
+
+std::unordered_map<YUV::Compression, std::unordered_map<YUV::FourccFormat, std::function<YUV(const ConstYUVView&, const void*, uint32_t)>>> YUV::compress_map = {
+  { Compressions::DCT, {
+    { FourccFormats::IYUV, compressDCT },
+    { FourccFormats::NV12, compressDCT },
+    { FourccFormats::NV21, compressDCT },
+    { FourccFormats::I444, compressDCT },
+    { FourccFormats::I422, compressDCT },
+    { FourccFormats::YUY2, compressDCT },
+    { FourccFormats::UYVY, compressDCT },
+    { FourccFormats::I010, compressDCT },
+    { FourccFormats::P010, compressDCT },
+    { FourccFormats::YV12, compressDCT },
   }},
 };
 
-std::unordered_map<YUV::Compression, std::unordered_map<YUV::FourccFormat, std::function<YUV(const YUV&, const void*, uint32_t)>>> YUV::compress_map = {
+std::unordered_map<YUV::Compression, std::unordered_map<YUV::FourccFormat, std::function<void(const ConstYUVView&, const void*, uint32_t, std::ostream&)>>> YUV::compress_to_map = {
   { Compressions::DCT, {
-    { FourccFormats::IYUV, [](const YUV& yuv, const void* params, uint32_t params_size)->YUV {
-      assert(yuv.getCompression() == Compressions::NONE);
-      if (params_size != 3) {
-        throw std::runtime_error("Error compression: incorrect parameters count. 3 parameters required");
-      }
-      std::array<uint8_t, 3> p;
-      for (int i = 0; i < 3; i++) {
-        p[i] = reinterpret_cast<const uint8_t*>(params)[i];
-      }
-      return myyuvDCT::compress_DCT_planar(yuv, p);
-    }}
+    { FourccFormats::IYUV, compressDCTTo },
+    { FourccFormats::NV12, compressDCTTo },
+    { FourccFormats::NV21, compressDCTTo },
+    { FourccFormats::I444, compressDCTTo },
+    { FourccFormats::I422, compressDCTTo },
+    { FourccFormats::YUY2, compressDCTTo },
+    { FourccFormats::UYVY, compressDCTTo },
+    { FourccFormats::I010, compressDCTTo },
+    { FourccFormats::P010, compressDCTTo },
+    { FourccFormats::YV12, compressDCTTo },
   }},
 };
 
 std::unordered_map<YUV::Compression, std::unordered_map<YUV::FourccFormat, std::function<YUV(const YUV&)>>> YUV::decompress_map = {
   { Compressions::DCT, {
-    { FourccFormats::IYUV, [](const YUV& yuv)->YUV{
-      assert(yuv.getCompression() == Compressions::DCT);
-      if (yuv.header.compression_params_size != 3) {
-        throw std::runtime_error("Error decompression: incorrect parameters count. 3 parameters required");
-      }
-      std::array<uint8_t, 3> p;
-      for (int i = 0; i < 3; i++) {
-        p[i] = reinterpret_cast<const uint8_t*>(yuv.compression_params)[i];
-      }
-      return myyuvDCT::decompress_DCT_planar(yuv, p);
-    }}
+    { FourccFormats::IYUV, decompressDCT },
+    { FourccFormats::NV12, decompressDCT },
+    { FourccFormats::NV21, decompressDCT },
+    { FourccFormats::I444, decompressDCT },
+    { FourccFormats::I422, decompressDCT },
+    { FourccFormats::YUY2, decompressDCT },
+    { FourccFormats::UYVY, decompressDCT },
+    { FourccFormats::I010, decompressDCT },
+    { FourccFormats::P010, decompressDCT },
+    { FourccFormats::YV12, decompressDCT },
+  }}
+};
+
+std::unordered_map<YUV::Compression, std::unordered_map<YUV::FourccFormat, std::function<void(const YUV&, const YUVView&)>>> YUV::decompress_to_map = {
+  { Compressions::DCT, {
+    { FourccFormats::IYUV, decompressDCTTo },
+    { FourccFormats::NV12, decompressDCTTo },
+    { FourccFormats::NV21, decompressDCTTo },
+    { FourccFormats::I444, decompressDCTTo },
+    { FourccFormats::I422, decompressDCTTo },
+    { FourccFormats::YUY2, decompressDCTTo },
+    { FourccFormats::UYVY, decompressDCTTo },
+    { FourccFormats::I010, decompressDCTTo },
+    { FourccFormats::P010, decompressDCTTo },
+    { FourccFormats::YV12, decompressDCTTo },
   }}
 };
 
@@ -176,11 +801,79 @@ std::unordered_map<YUV::FourccFormat, std::function<std::array<uint8_t, YUV::max
     res[1] = planes[1][uv_index];
     res[2] = planes[2][uv_index];
     return res;
-  }}
+  }},
+  { FourccFormats::NV12, getPixelFromView },
+  { FourccFormats::NV21, getPixelFromView },
+  { FourccFormats::I444, getPixelFromView },
+  { FourccFormats::I422, getPixelFromView },
+  { FourccFormats::YUY2, getPixelFromView },
+  { FourccFormats::UYVY, getPixelFromView },
+  { FourccFormats::I010, getPixelFromView },
+  { FourccFormats::P010, getPixelFromView },
+  { FourccFormats::YV12, getPixelFromView },
+};
+
+std::unordered_map<YUV::FourccFormat, std::unordered_map<YUV::FourccFormat, std::function<void(const ConstYUVView&, const YUVView&)>>> YUV::yuv_convert_map = {
+  { FourccFormats::IYUV, {
+    { FourccFormats::YV12, copyPlanes },
+    { FourccFormats::NV12, copyPlanes },
+    { FourccFormats::NV21, copyPlanes },
+    { FourccFormats::I422, planar420ToPlanar422 },
+    { FourccFormats::YUY2, planar420ToPacked422 },
+    { FourccFormats::UYVY, planar420ToPacked422 },
+    { FourccFormats::I010, planarToBitDepth },
+  }},
+  { FourccFormats::YV12, {
+    { FourccFormats::IYUV, copyPlanes },
+    { FourccFormats::NV12, copyPlanes },
+    { FourccFormats::NV21, copyPlanes },
+    { FourccFormats::I422, planar420ToPlanar422 },
+    { FourccFormats::YUY2, planar420ToPacked422 },
+    { FourccFormats::UYVY, planar420ToPacked422 },
+  }},
+  { FourccFormats::NV12, {
+    { FourccFormats::IYUV, copyPlanes },
+    { FourccFormats::YV12, copyPlanes },
+    { FourccFormats::NV21, copyPlanes },
+  }},
+  { FourccFormats::NV21, {
+    { FourccFormats::IYUV, copyPlanes },
+    { FourccFormats::YV12, copyPlanes },
+    { FourccFormats::NV12, copyPlanes },
+  }},
+  { FourccFormats::I422, {
+    { FourccFormats::IYUV, planar422ToPlanar420 },
+    { FourccFormats::YV12, planar422ToPlanar420 },
+    { FourccFormats::I444, planar422ToPlanar444 },
+    { FourccFormats::YUY2, planar422ToPacked422 },
+    { FourccFormats::UYVY, planar422ToPacked422 },
+  }},
+  { FourccFormats::I444, {
+    { FourccFormats::I422, planar444ToPlanar422 },
+  }},
+  { FourccFormats::YUY2, {
+    { FourccFormats::IYUV, packed422ToPlanar420 },
+    { FourccFormats::YV12, packed422ToPlanar420 },
+    { FourccFormats::I422, packed422ToPlanar422 },
+    { FourccFormats::UYVY, packed422ToPacked422 },
+  }},
+  { FourccFormats::UYVY, {
+    { FourccFormats::IYUV, packed422ToPlanar420 },
+    { FourccFormats::YV12, packed422ToPlanar420 },
+    { FourccFormats::I422, packed422ToPlanar422 },
+    { FourccFormats::YUY2, packed422ToPacked422 },
+  }},
+  { FourccFormats::I010, {
+    { FourccFormats::P010, copyPlanes },
+    { FourccFormats::IYUV, planarToBitDepth },
+  }},
+  { FourccFormats::P010, {
+    { FourccFormats::I010, copyPlanes },
+  }},
 };
 
-YUV::YUV(const std::string& path) : YUV() {
-  load(path);
+YUV::YUV(const std::string& path, LoadMode mode) : YUV() {
+  load(path, mode);
 }
 
 YUV::YUV(const BMP& bmp, FourccFormat format) : YUV() {
@@ -193,10 +886,10 @@ YUV::YUV(const YUV& yuv) {
 
 YUV& YUV::operator=(const YUV& yuv) {
   assert(yuv.isValidHeader());
-  auto copy_data_lambda = [](uint8_t* data, uint8_t*& new_data, const uint8_t* tmp_data, uint32_t data_size, uint32_t tmp_data_size) {
+  auto copy_data_lambda = [](uint8_t* data, uint8_t*& new_data, const uint8_t* tmp_data, uint32_t data_size, uint32_t tmp_data_size, auto allocate) {
     if (tmp_data != nullptr) {
       if (data == nullptr || tmp_data_size > data_size) {
-        new_data = new uint8_t[tmp_data_size];
+        new_data = allocate(tmp_data_size);
       } else {
         new_data = data;
       }
@@ -206,11 +899,12 @@ YUV& YUV::operator=(const YUV& yuv) {
   uint8_t* new_data = nullptr;
   uint8_t* new_compression_params = nullptr;
   try {
-    copy_data_lambda(data, new_data, yuv.data, header.data_size, yuv.header.data_size);
-    copy_data_lambda(compression_params, new_compression_params, yuv.compression_params, header.compression_params_size, yuv.header.compression_params_size);
+    // mapped data is never reused, the copy owns its data
+    copy_data_lambda(data_mapping ? nullptr : data, new_data, yuv.data, header.data_size, yuv.header.data_size, [](uint32_t size) { return allocateBuffer(size); });
+    copy_data_lambda(compression_params, new_compression_params, yuv.compression_params, header.compression_params_size, yuv.header.compression_params_size, [](uint32_t size) { return new uint8_t[size]; });
   } catch (...) {
     if (new_data != data) {
-      delete[] new_data;
+      freeBuffer(new_data);
     }
     if (new_compression_params != compression_params) {
       delete[] new_compression_params;
@@ -218,7 +912,7 @@ YUV& YUV::operator=(const YUV& yuv) {
     throw;
   }
   if (new_data != data || new_data == nullptr) {
-    delete[] data;
+    releaseData();
     data = new_data;
   }
   if (new_compression_params != compression_params || new_compression_params == nullptr) {
@@ -237,14 +931,38 @@ YUV& YUV::operator=(YUV&& yuv) noexcept {
   std::swap(header, yuv.header);
   std::swap(compression_params, yuv.compression_params);
   std::swap(data, yuv.data);
+  std::swap(data_mapping, yuv.data_mapping);
   return *this;
 }
 
 YUV::~YUV() {
-  delete[] data;
+  releaseData();
   delete[] compression_params;
 }
 
+void YUV::releaseData() noexcept {
+  if (data_mapping) {
+    data_mapping.reset();
+  } else {
+    freeBuffer(data);
+  }
+  data = nullptr;
+}
+
+bool YUV::isMapped() const noexcept {
+  return data_mapping != nullptr;
+}
+
+void YUV::materialize() {
+  if (!data_mapping) {
+    return;
+  }
+  uint8_t* new_data = allocateBuffer(header.data_size);
+  std::copy(data, data + header.data_size, new_data);
+  releaseData();
+  data = new_data;
+}
+
 bool YUV::isValid() const noexcept {
   return data != nullptr &&
   (header.compression_params_size > 0 && compression_params != nullptr ||
@@ -307,17 +1025,23 @@ std::array<uint32_t, 2> YUV::getResolutionFraction() const {
 }
 
 std::array<uint32_t, 2> YUV::getWidthHeightChannel(uint8_t channel) const {
-  auto order = getYUVPlanesOrder();
-  if (order[channel] != no_plane) {
+  return getWidthHeightChannel(getFourccFormat(), header.width, header.height, channel);
+}
+
+std::array<uint32_t, 2> YUV::getWidthHeightChannel(FourccFormat format, uint32_t width, uint32_t height, uint8_t channel) {
+  if (!isImplementedFormat(format, Compressions::NONE) || !mapKeyExist(yuv_order_planes_map, format)) {
+    throw std::runtime_error("Error. Unimplemented format.");
+  }
+  if (yuv_order_planes_map.at(format)[channel] != no_plane) {
     switch(channel) {
       case 1:
       case 2:
         {
-          auto fractions = getResolutionFraction();
-          return { header.width / fractions[0], header.height / fractions[1] };
+          auto fractions = yuv_resolution_fraction_map.at(format);
+          return { width / fractions[0], height / fractions[1] };
         }
       default:
-        return { header.width, header.height };
+        return { width, height };
     }
   } else {
     return { 0, 0 };
@@ -332,8 +1056,8 @@ std::array<uint32_t, YUV::max_planes> YUV::getFormatSizeBits() const {
   auto fractions = getResolutionFraction();
   auto order = getYUVPlanesOrder();
   uint32_t fraction = fractions[0] * fractions[1];
-  assert(8 % fraction == 0);
-  std::array<uint32_t, max_planes> bits = { 8, 8 / fraction, 8 / fraction, 8 };
+  const uint32_t sample_bits = 8 * getBytesPerSample(getFourccFormat());
+  std::array<uint32_t, max_planes> bits = { sample_bits, sample_bits / fraction, sample_bits / fraction, sample_bits };
   for (uint32_t i = 0; i < max_planes; i++) {
     if (order[i] == no_plane) {
       bits[i] = 0;
@@ -371,11 +1095,21 @@ std::array<uint8_t, YUV::max_planes> YUV::getYUVPlanesOrder() const {
   return order;
 }
 
+std::array<uint32_t, YUV::max_planes> YUV::getPlanesSizes() const {
+  std::array<uint32_t, max_planes> sizes{};
+  const uint32_t sample_bytes = getBytesPerSample(getFourccFormat());
+  for (uint8_t i = 0; i < max_planes; i++) {
+    const auto width_height = getWidthHeightChannel(i);
+    sizes[i] = width_height[0] * width_height[1] * sample_bytes;
+  }
+  return sizes;
+}
+
 uint32_t YUV::getImageSize() const {
-  auto bits = getFormatSizeBits();
+  auto sizes = getPlanesSizes();
   uint32_t sz = 0;
   for (uint32_t i = 0; i < max_planes; i++) {
-    sz += header.width * header.height * bits[i] / 8;
+    sz += sizes[i];
   }
   return sz;
 }
@@ -388,7 +1122,7 @@ std::array<const uint8_t*, YUV::max_planes> YUV::getYUVPlanes() const {
     throw std::runtime_error("Error. Planar type unimplemented (?)");
   }
   auto order = getYUVPlanesOrder();
-  auto bits = getFormatSizeBits();
+  auto sizes = getPlanesSizes();
   auto format_group = getFormatGroup();
   std::array<const uint8_t*, max_planes> res = { 0 };
   assert(order[0] != no_plane);
@@ -401,22 +1135,26 @@ std::array<const uint8_t*, YUV::max_planes> YUV::getYUVPlanes() const {
       o_offset++;
       continue;
     }
-    res[o] = res[o_prev] + header.width * header.height * bits[o_prev] / 8;
-    if (format_group == FormatGroup::PACKED) {
-      res[o] = data;
-    }
+    res[o] = res[o_prev] + sizes[o_prev];
   }
   for (uint32_t i = 0; i < max_planes; i++) {
     const uint32_t o = order[i];
-    if (o != no_plane && bits[o] == 0) {
+    if (o != no_plane && sizes[o] == 0) {
       res[o] = nullptr;
     }
   }
   if (format_group == FormatGroup::SEMI_PLANAR) {
-    if (res[1] != nullptr) {
-      res[2] = res[1];
-    } else if (res[2] != nullptr) {
-      res[1] = res[2];
+    // chroma pairs are stored where the first chroma plane would be, the second channel is the next sample
+    assert(order[1] != no_plane && order[2] != no_plane);
+    res[order[2]] = res[order[1]] + getBytesPerSample(getFourccFormat());
+  } else if (format_group == FormatGroup::PACKED) {
+    // every channel starts at its first byte in the first macropixel
+    if (!mapKeyExist(yuv_packed_layout_map, getFourccFormat())) {
+      throw std::runtime_error("Error. Packed type unimplemented (?)");
+    }
+    const auto& layout = yuv_packed_layout_map.at(getFourccFormat());
+    for (uint8_t i = 4; i > 0; i--) {
+      res[layout[i - 1]] = data + i - 1;
     }
   }
   return res;
@@ -426,6 +1164,58 @@ std::array<uint8_t*, YUV::max_planes> YUV::getYUVPlanes() {
   return planes_const_cast(reinterpret_cast<const YUV*>(this)->getYUVPlanes());
 }
 
+YUVView YUV::view() {
+  const ConstYUVView res = reinterpret_cast<const YUV*>(this)->view();
+  return YUVView(res.fourcc_format, res.width, res.height, planes_const_cast(res.planes), res.strides, res.pixel_strides);
+}
+
+ConstYUVView YUV::view() const {
+  if (isCompressed()) {
+    throw std::runtime_error("Cannot get view of compressed image. Decompress first.");
+  }
+  const auto pixel_strides = getPixelStrides(getFourccFormat());
+  std::array<uint32_t, max_planes> strides{};
+  for (uint8_t i = 0; i < max_planes; i++) {
+    strides[i] = getWidthHeightChannel(i)[0] * pixel_strides[i];
+  }
+  return ConstYUVView(getFourccFormat(), header.width, header.height, getYUVPlanes(), strides, pixel_strides);
+}
+
+std::array<uint32_t, YUV::max_planes> YUV::getPixelStrides(FourccFormat format) noexcept {
+  std::array<uint32_t, max_planes> res = { 1, 1, 1, 1 };
+  if (getFormatGroup(format) == FormatGroup::SEMI_PLANAR) {
+    res[1] = 2;
+    res[2] = 2;
+  } else if (getFormatGroup(format) == FormatGroup::PACKED && mapKeyExist(yuv_packed_layout_map, format)) {
+    // a channel that has n bytes in a macropixel has a sample every 4 / n bytes
+    std::array<uint32_t, max_planes> counts{};
+    for (uint8_t c : yuv_packed_layout_map.at(format)) {
+      counts[c]++;
+    }
+    for (uint8_t i = 0; i < max_planes; i++) {
+      if (counts[i] != 0) {
+        res[i] = 4 / counts[i];
+      }
+    }
+  }
+  const uint32_t sample_bytes = getBytesPerSample(format);
+  for (uint8_t i = 0; i < max_planes; i++) {
+    res[i] *= sample_bytes;
+  }
+  return res;
+}
+
+std::array<uint8_t, 2> YUV::getSampleBits(FourccFormat format) noexcept {
+  if (mapKeyExist(yuv_sample_bits_map, format)) {
+    return yuv_sample_bits_map.at(format);
+  }
+  return { 8, 0 };
+}
+
+uint32_t YUV::getBytesPerSample(FourccFormat format) noexcept {
+  return getSampleBits(format)[0] > 8 ? 2 : 1;
+}
+
 YUV::FormatGroup YUV::getFormatGroup() const noexcept {
   return getFormatGroup(getFourccFormat());
 }
@@ -455,15 +1245,37 @@ YUV YUV::compress(Compression compression, const void* params, uint32_t params_s
   if (getCompression() != Compressions::NONE) {
     throw std::runtime_error("Error already compressed");
   }
+  return compress(view(), compression, params, params_size);
+}
+
+YUV YUV::compress(const ConstYUVView& src, Compression compression, const void* params, uint32_t params_size) {
+  if (!src.isValid()) {
+    throw std::runtime_error("Error view is invalid");
+  }
   if (!mapKeyExist(compress_map, compression)) {
     throw std::runtime_error("Error this compression is unimplemented");
   }
   const auto& comp = compress_map.at(compression);
-  FourccFormat format = getFourccFormat();
-  if (!mapKeyExist(comp, format)) {
+  if (!mapKeyExist(comp, src.fourcc_format)) {
     throw std::runtime_error("Error compression for this format is unimplemented");
   }
-  return comp.at(format)(*this, params, params_size);
+  return comp.at(src.fourcc_format)(src, params, params_size);
+}
+
+void YUV::compressTo(const std::string& path, Compression compression, const void* params, uint32_t params_size) const {
+  if (getCompression() != Compressions::NONE) {
+    throw std::runtime_error("Error already compressed");
+  }
+  const FourccFormat format = getFourccFormat();
+  if (!mapKeyExist(compress_to_map, compression) || !mapKeyExist(compress_to_map.at(compression), format)) {
+    compress(compression, params, params_size).dump(path);
+    return;
+  }
+  std::ofstream f(path, std::ios::binary);
+  if (!f) {
+    throw std::runtime_error("Error opening file to write " + path);
+  }
+  compress_to_map.at(compression).at(format)(view(), params, params_size, f);
 }
 
 YUV YUV::decompress() const {
@@ -482,7 +1294,56 @@ YUV YUV::decompress() const {
   return comp.at(format)(*this);
 }
 
-void YUV::load(const std::string& path) {
+void YUV::decompressTo(const YUVView& dst) const {
+  if (!dst.isValid() || dst.fourcc_format != getFourccFormat() || dst.width != getWidth() || dst.height != getHeight()) {
+    throw std::runtime_error("Error view does not match the image");
+  }
+  Compression compression = getCompression();
+  if (compression == Compressions::NONE) {
+    copyView(view(), dst);
+    return;
+  }
+  if (!mapKeyExist(decompress_to_map, compression) || !mapKeyExist(decompress_to_map.at(compression), getFourccFormat())) {
+    throw std::runtime_error("Error decompression for this format is unimplemented");
+  }
+  decompress_to_map.at(compression).at(getFourccFormat())(*this, dst);
+}
+
+void YUV::load(const std::string& path, LoadMode mode) {
+  if (mode != LoadMode::READ && MappedFile::isSupported()) {
+    YUV res;
+    res.data_mapping.reset(new MappedFile(path, mode == LoadMode::MAP_RANDOM ? MappedFile::Access::RANDOM : MappedFile::Access::SEQUENTIAL));
+    const uint8_t* file = res.data_mapping->getData();
+    const uint64_t file_size = res.data_mapping->getSize();
+    if (file_size < sizeof(res.header)) {
+      throw std::runtime_error("Error bad header " + path);
+    }
+    std::copy(file, file + sizeof(res.header), reinterpret_cast<uint8_t*>(&res.header));
+    if (!res.isValidHeader()) {
+      throw std::runtime_error("Error bad header " + path);
+    }
+    if (res.header.compression_params_size > 0) {
+      if (static_cast<uint64_t>(res.header.compression_params_pos) + res.header.compression_params_size > file_size) {
+        throw std::runtime_error("Error file is too small " + path);
+      }
+      res.compression_params = new uint8_t[res.header.compression_params_size];
+      std::copy(file + res.header.compression_params_pos, file + res.header.compression_params_pos + res.header.compression_params_size, res.compression_params);
+    }
+    const uint32_t data_pos = res.header.data_pos;
+    res.header.compression_params_pos = sizeof(res.header);
+    res.header.data_pos = res.header.compression_params_pos + res.header.compression_params_size;
+    if (res.getCompression() == Compressions::NONE) {
+      res.header.data_size = res.getImageSize();
+    }
+    // Reading past the end of a mapping is a crash instead of a short read
+    if (static_cast<uint64_t>(data_pos) + res.header.data_size > file_size) {
+      throw std::runtime_error("Error file is too small " + path);
+    }
+    res.data = res.data_mapping->getData() + data_pos;
+    assert(res.isValid());
+    std::swap(*this, res);
+    return;
+  }
   YUV res;
   std::ifstream f(path, std::ios::binary);
   if (!f) {
@@ -503,7 +1364,7 @@ void YUV::load(const std::string& path) {
   if (res.getCompression() == Compressions::NONE) {
     res.header.data_size = res.getImageSize();
   }
-  res.data = new uint8_t[res.header.data_size];
+  res.data = allocateBuffer(res.header.data_size);
   f.read(reinterpret_cast<char*>(res.data), res.header.data_size);
   assert(res.isValid());
   std::swap(*this, res);
@@ -522,6 +1383,124 @@ void YUV::load(const BMP& bmp, FourccFormat format) {
   }
 }
 
+void YUV::convertBMP(const BMP& bmp, const YUVView& dst) {
+  if (!bmp.isValid()) {
+    throw std::runtime_error("BMP is invalid");
+  }
+  if (!dst.isValid() || dst.width != bmp.trueWidth() || dst.height != bmp.trueHeight()) {
+    throw std::runtime_error("Error view does not match the image");
+  }
+  if (!mapKeyExist(bmp_to_yuv_view_map, dst.fourcc_format)) {
+    throw std::runtime_error("Incorrect format");
+  }
+  bmp_to_yuv_view_map.at(dst.fourcc_format)(bmp, dst);
+}
+
+YUV YUV::convert(FourccFormat format) const {
+  if (isCompressed()) {
+    throw std::runtime_error("Cannot convert compressed image. Decompress first.");
+  }
+  if (format == getFourccFormat()) {
+    return *this;
+  }
+  YUV res = allocate(format, header.width, header.height);
+  convert(view(), res.view());
+  return res;
+}
+
+void YUV::convert(const ConstYUVView& src, const YUVView& dst) {
+  if (!src.isValid() || !dst.isValid() || src.width != dst.width || src.height != dst.height) {
+    throw std::runtime_error("Error view does not match the image");
+  }
+  if (src.fourcc_format == dst.fourcc_format) {
+    copyView(src, dst);
+    return;
+  }
+  if (mapKeyExist(yuv_convert_map, src.fourcc_format) && mapKeyExist(yuv_convert_map.at(src.fourcc_format), dst.fourcc_format)) {
+    yuv_convert_map.at(src.fourcc_format).at(dst.fourcc_format)(src, dst);
+    return;
+  }
+  const std::vector<FourccFormat> path = getConvertPath(src.fourcc_format, dst.fourcc_format);
+  if (path.size() < 2) {
+    throw std::runtime_error("Error conversion between these formats is unimplemented");
+  }
+  // Every step reads the image of the previous step, plane reorders only relabel the view
+  YUV intermediate;
+  ConstYUVView from = src;
+  for (size_t i = 1; i + 1 < path.size(); i++) {
+    if (isPlaneReorder(from.fourcc_format, path[i])) {
+      from = from.as(path[i]);
+      continue;
+    }
+    YUV next = allocate(path[i], src.width, src.height);
+    yuv_convert_map.at(from.fourcc_format).at(path[i])(from, next.view());
+    intermediate = std::move(next);
+    from = intermediate.view();
+  }
+  yuv_convert_map.at(from.fourcc_format).at(dst.fourcc_format)(from, dst);
+}
+
+std::vector<YUV::FourccFormat> YUV::getConvertPath(FourccFormat src, FourccFormat dst) {
+  if (src == dst) {
+    return { src };
+  }
+  // Breadth-first search, the previous format of every reached format
+  std::unordered_map<FourccFormat, FourccFormat> previous = { { src, src } };
+  std::vector<FourccFormat> queue = { src };
+  for (size_t i = 0; i < queue.size(); i++) {
+    if (!mapKeyExist(yuv_convert_map, queue[i])) {
+      continue;
+    }
+    // Formats are visited in ascending order, so the path doesn't depend on hashing
+    std::vector<FourccFormat> next;
+    for (const auto& it : yuv_convert_map.at(queue[i])) {
+      next.push_back(it.first);
+    }
+    std::sort(next.begin(), next.end());
+    for (FourccFormat format : next) {
+      if (mapKeyExist(previous, format)) {
+        continue;
+      }
+      previous[format] = queue[i];
+      if (format == dst) {
+        std::vector<FourccFormat> path = { dst };
+        while (path.back() != src) {
+          path.push_back(previous.at(path.back()));
+        }
+        std::reverse(path.begin(), path.end());
+        return path;
+      }
+      queue.push_back(format);
+    }
+  }
+  return {};
+}
+
+bool YUV::isPlaneReorder(FourccFormat src, FourccFormat dst) noexcept {
+  if (!isImplementedFormat(src) || !isImplementedFormat(dst) || !mapKeyExist(yuv_order_planes_map, src) || !mapKeyExist(yuv_order_planes_map, dst)) {
+    return false;
+  }
+  const auto& src_order = yuv_order_planes_map.at(src);
+  const auto& dst_order = yuv_order_planes_map.at(dst);
+  return getFormatGroup(src) == FormatGroup::PLANAR && getFormatGroup(dst) == FormatGroup::PLANAR &&
+    yuv_resolution_fraction_map.at(src) == yuv_resolution_fraction_map.at(dst) && getSampleBits(src) == getSampleBits(dst) &&
+    std::is_permutation(src_order.begin(), src_order.end(), dst_order.begin());
+}
+
+YUV YUV::allocate(FourccFormat format, uint32_t width, uint32_t height) {
+  if (!isImplementedFormat(format, Compressions::NONE)) {
+    throw std::runtime_error("Error. Unimplemented format.");
+  }
+  YUV res;
+  res.header.fourcc_format = format;
+  res.header.width = width;
+  res.header.height = height;
+  res.header.data_pos = sizeof(YUVHeader);
+  res.header.data_size = res.getImageSize();
+  res.data = allocateBuffer(res.header.data_size);
+  return res;
+}
+
 void YUV::dump(const std::string& path) const {
   assert(isValid());
   std::ofstream f(path, std::ios::binary);
@@ -1,15 +1,38 @@
 #pragma once
 
 #include "myyuv_bmp.hpp"
+#include "myyuv_mapped_file.hpp"
+#include "myyuv_allocator.hpp"
 
 #include <string>
 #include <unordered_map>
 #include <functional>
+#include <ostream>
 #include <array>
 #include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <stdexcept>
+#include <vector>
 
 namespace myyuv {
 
+template <typename T>
+struct BasicYUVView;
+
+/**
+* @brief Non-owning view of writable YUV planes.
+* @see BasicYUVView
+*/
+using YUVView = BasicYUVView<uint8_t>;
+
+/**
+* @brief Non-owning view of read-only YUV planes.
+* @see BasicYUVView
+*/
+using ConstYUVView = BasicYUVView<const uint8_t>;
+
 #pragma pack(push, 1)
 /**
 * @brief Header of `myyuv` file.
@@ -32,7 +55,7 @@ struct YUVHeader {
 * @brief Class that represents YUV image.
 * @var header YUV file header.
 * @var compression_params Compression parameters data.
-* @var data Image data.
+* @var data Image data. Either allocated with `allocateBuffer` and owned by the image or points into a file mapping, see `LoadMode`.
 */
 class YUV {
 public:
@@ -56,6 +79,24 @@ public:
   struct FourccFormats {
     static constexpr const FourccFormat UNKNOWN = 0;
     static constexpr const FourccFormat IYUV = 0x56555949;
+    static constexpr const FourccFormat NV12 = 0x3231564E;
+    static constexpr const FourccFormat NV21 = 0x3132564E;
+    static constexpr const FourccFormat I444 = 0x34343449;
+    static constexpr const FourccFormat I422 = 0x32323449;
+    static constexpr const FourccFormat YUY2 = 0x32595559;
+    static constexpr const FourccFormat UYVY = 0x59565955;
+    static constexpr const FourccFormat I010 = 0x30313049;
+    static constexpr const FourccFormat P010 = 0x30313050;
+    static constexpr const FourccFormat YV12 = 0x32315659;
+  };
+
+  /**
+  * @brief How `load` reads image data from file.
+  */
+  enum class LoadMode {
+    READ = 0, /// Read the data into memory owned by the image.
+    MAP_SEQUENTIAL, /// Map the file, the data is read lazily and is going to be read from start to end (decompression, conversion).
+    MAP_RANDOM, /// Map the file, the data is read lazily and only parts of it are going to be read (metadata, `getPixel`).
   };
 
   /**
@@ -81,6 +122,12 @@ public:
   */
   static constexpr const uint8_t no_plane = 0xff;
 
+  /**
+  * @brief Maximum bit depth of samples of high bit depth formats.
+  * @note DCT coefficients of 8x8 blocks of such samples still fit in 16 bits.
+  */
+  static constexpr const uint8_t max_bit_depth = 12;
+
   /**
   * @brief Map for identifying YUV format group.
   * @see FormatGroup
@@ -90,36 +137,80 @@ public:
   /**
   * @brief Map for YUV order for planes for planar group.
   * @note Use `no_pane` if plane is unused.
+  * @note For semi-planar group chroma is stored as pairs, the order of chroma channels is their order in a pair.
+  * @note For packed group it's the order of the first samples of channels in a macropixel.
   * @example YUV -> [0, 1, 2] ; YVU -> [0, 2, 1]
   */
   static std::unordered_map<FourccFormat, std::array<uint8_t, max_planes>> yuv_order_planes_map;
 
+  /**
+  * @brief Map for channels of the bytes of a macropixel (2 pixels of 4:2:2) for packed group.
+  * @example YUY2 -> [0, 1, 0, 2] ; UYVY -> [1, 0, 2, 0]
+  */
+  static std::unordered_map<FourccFormat, std::array<uint8_t, 4>> yuv_packed_layout_map;
+
   /**
   * @brief Map for fraction of width and height for chroma subsampling.
   * @example IYUV -> [2, 2] // because IYUV is 4:2:0 (has half width and half height)
   */
   static std::unordered_map<FourccFormat, std::array<uint32_t, 2>> yuv_resolution_fraction_map;
 
+  /**
+  * @brief Map for bit depth and shift of samples of high bit depth formats: a sample takes 2 bytes (little endian) and its value is `bit depth` bits after shifting it right by `shift`.
+  * @note Bit depth is from 9 to `max_bit_depth`. Formats that are not here have 8-bit samples of 1 byte.
+  * @example I010 -> [10, 0] // 10 low bits ; P010 -> [10, 6] // 10 high bits
+  */
+  static std::unordered_map<FourccFormat, std::array<uint8_t, 2>> yuv_sample_bits_map;
+
   /**
   * @brief Map for converting BMP RGB image to YUV image.
   */
   static std::unordered_map<FourccFormat, std::function<YUV(const BMP&)>> bmp_to_yuv_map;
 
+  /**
+  * @brief Map for converting BMP RGB image into YUV planes of a view.
+  * @note The view has the requested format and the same width and height as the BMP image.
+  * @see convertBMP
+  */
+  static std::unordered_map<FourccFormat, std::function<void(const BMP&, const YUVView&)>> bmp_to_yuv_view_map;
+
   /**
   * @brief Map for compressing YUV image.
   */
-  static std::unordered_map<Compression, std::unordered_map<FourccFormat, std::function<YUV(const YUV&, const void*, uint32_t)>>> compress_map;
+  static std::unordered_map<Compression, std::unordered_map<FourccFormat, std::function<YUV(const ConstYUVView&, const void*, uint32_t)>>> compress_map;
+
+  /**
+  * @brief Map for compressing YUV image straight to a stream as image file, without building compressed image in memory.
+  * @note Optional, `compressTo` falls back to `compress_map` for compressions that are not here.
+  */
+  static std::unordered_map<Compression, std::unordered_map<FourccFormat, std::function<void(const ConstYUVView&, const void*, uint32_t, std::ostream&)>>> compress_to_map;
 
   /**
   * @brief Map for decompressing YUV image.
   */
   static std::unordered_map<Compression, std::unordered_map<FourccFormat, std::function<YUV(const YUV&)>>> decompress_map;
 
+  /**
+  * @brief Map for decompressing YUV image into planes of a view.
+  * @note The view has the same format, width and height as the image.
+  * @see decompressTo
+  */
+  static std::unordered_map<Compression, std::unordered_map<FourccFormat, std::function<void(const YUV&, const YUVView&)>>> decompress_to_map;
+
   /**
   * @brief Map for getting a pixel value from `x` and `y` coordinates.
+  * @note Samples of high bit depth formats are scaled down to 8 bits.
   */
   static std::unordered_map<FourccFormat, std::function<std::array<uint8_t, max_planes>(const YUV&, uint32_t, uint32_t)>> yuv_get_pixel_map;
 
+  /**
+  * @brief Map for converting YUV planes of a view into planes of a view with another format.
+  * @details Every entry is a direct conversion: plane reorder, chroma interleave, chroma up/downsampling or bit depth change. Conversions between formats without a direct entry go through the shortest chain of entries.
+  * @note Views have the same width and height. The first key is the source format, the second is the destination format.
+  * @see getConvertPath
+  */
+  static std::unordered_map<FourccFormat, std::unordered_map<FourccFormat, std::function<void(const ConstYUVView&, const YUVView&)>>> yuv_convert_map;
+
   /**
   * @brief Default empty constructor.
   * @warning If left as it is, consideres invalid.
@@ -130,9 +221,10 @@ public:
   /**
   * @brief Constructor that loads YUV image from file.
   * @param path Image file path.
+  * @param mode How to read image data.
   * @see load
   */
-  explicit YUV(const std::string& path);
+  explicit YUV(const std::string& path, LoadMode mode = LoadMode::READ);
 
   /**
   * @brief Constructor that converts BMP RGB(A) image to YUV image.
@@ -241,13 +333,34 @@ public:
   */
   std::array<uint32_t, 2> getWidthHeightChannel(uint8_t channel) const;
 
+  /**
+  * @brief Get width and height for specific color channel of an image with specified format and size.
+  * @see getWidthHeightChannel
+  * @param format Fourcc format.
+  * @param width Image width.
+  * @param height Image height.
+  * @param channel Color channel.
+  * @return Array of 2 numbers: width and height.
+  */
+  static std::array<uint32_t, 2> getWidthHeightChannel(FourccFormat format, uint32_t width, uint32_t height, uint8_t channel);
+
   /**
   * @brief Bits for plane per pixel.
   * @note Order of planes is YUV(A).
+  * @note Rounded down if a plane takes a fraction of a bit per pixel, use `getPlanesSizes` for sizes.
   * @return Array of `max_planes` numbers: bits for each plane.
   */
   std::array<uint32_t, max_planes> getFormatSizeBits() const;
 
+  /**
+  * @brief Get size of samples of every plane in bytes from its width and height.
+  * @note Order of planes is YUV(A). Unused planes have size 0.
+  * @example IYUV 4x4 -> [16, 4, 4, 0] ; I422 4x4 -> [16, 8, 8, 0] ; I010 4x4 -> [32, 8, 8, 0]
+  * @return Array of `max_planes` sizes.
+  * @see getWidthHeightChannel
+  */
+  std::array<uint32_t, max_planes> getPlanesSizes() const;
+
   /**
   * @brief YUV order for planes for planar group.
   * @example YUV -> [0, 1, 2] ; YVU -> [0, 2, 1]
@@ -257,6 +370,30 @@ public:
   */
   std::array<uint8_t, max_planes> getYUVPlanesOrder() const;
 
+  /**
+  * @brief Get distance in bytes between adjacent samples in a row of every plane.
+  * @param format Fourcc format.
+  * @example IYUV -> [1, 1, 1, 1] ; NV12 -> [1, 2, 2, 1] // chroma samples are interleaved pairs ; YUY2 -> [2, 4, 4, 1] ; P010 -> [2, 4, 4, 2]
+  * @return Array of `max_planes` numbers in YUV(A) order.
+  */
+  static std::array<uint32_t, max_planes> getPixelStrides(FourccFormat format) noexcept;
+
+  /**
+  * @brief Get bit depth and shift of samples.
+  * @param format Fourcc format.
+  * @return Array of 2 numbers: bit depth and shift, `[8, 0]` for formats with 8-bit samples.
+  * @see yuv_sample_bits_map
+  */
+  static std::array<uint8_t, 2> getSampleBits(FourccFormat format) noexcept;
+
+  /**
+  * @brief Get size of a sample in bytes: 1 for 8-bit samples, 2 for high bit depth samples.
+  * @param format Fourcc format.
+  * @return Sample size in bytes.
+  * @see yuv_sample_bits_map
+  */
+  static uint32_t getBytesPerSample(FourccFormat format) noexcept;
+
   /**
   * @brief Calculates real image size.
   * @note Ignores `data_size` from header.
@@ -266,6 +403,7 @@ public:
 
   /**
   * @brief Get pointers to YUV planes in `data`.
+  * @note For semi-planar and packed groups pointers point to the first samples of their channels in the interleaved data.
   * @return Array of pointers to `data`.
   */
   std::array<const uint8_t*, max_planes> getYUVPlanes() const;
@@ -276,6 +414,21 @@ public:
   */
   std::array<uint8_t*, max_planes> getYUVPlanes();
 
+  /**
+  * @brief Get view of image planes in `data`.
+  * @note Rows of planes are tightly packed, so strides are widths of planes multiplied by pixel strides.
+  * @warning The image must not be compressed. The view is invalidated when `data` changes.
+  * @return View of the image.
+  */
+  YUVView view();
+
+  /**
+  * @brief Get read-only view of image planes in `data`.
+  * @see view
+  * @return View of the image.
+  */
+  ConstYUVView view() const;
+
   /**
   * @brief Get format group for image: either packed or planar.
   * @return Format group.
@@ -293,6 +446,7 @@ public:
 
   /**
   * @brief Get pixel value in `x` and `y` coordinates.
+  * @note Samples of high bit depth formats are scaled down to 8 bits.
   * @warning Slow.
   * @param x x coordinate.
   * @param y y coordinate.
@@ -312,6 +466,29 @@ public:
   */
   YUV compress(Compression compression, const void* params, uint32_t params_size) const;
 
+  /**
+  * @brief Compresses YUV planes of a view, which may be externally owned and have padded rows.
+  * @param src View of the image to compress.
+  * @param compression Requested compression.
+  * @param params Compression params data.
+  * @param params_size Compression params data size in bytes.
+  * @return New compressed YUV image.
+  * @see compress
+  */
+  static YUV compress(const ConstYUVView& src, Compression compression, const void* params, uint32_t params_size);
+
+  /**
+  * @brief Compresses YUV image and dumps it to file.
+  * @note Result is the same as `compress(...).dump(path)`, but compressed data may be written straight to the file.
+  * @param path Path to dump.
+  * @param compression Requested compression.
+  * @param params Compression params data.
+  * @param params_size Compression params data size in bytes.
+  * @see compress
+  * @see compress_to_map
+  */
+  void compressTo(const std::string& path, Compression compression, const void* params, uint32_t params_size) const;
+
   /**
   * @brief Decompresses YUV image.
   * @note If image is not compressed, returns the copy of the image.
@@ -320,6 +497,13 @@ public:
   */
   YUV decompress() const;
 
+  /**
+  * @brief Decompresses YUV image into planes of a view, which may be externally owned and have padded rows.
+  * @param dst View with the same format, width and height as the image.
+  * @see decompress_to_map
+  */
+  void decompressTo(const YUVView& dst) const;
+
   /**
   * @brief Checks if image is compressed.
   * @return `true` if image is compressed, `false` otherwise.
@@ -329,9 +513,24 @@ public:
   /**
   * @brief Loads YUV image from file.
   * @note The object won't be modifed on exception (exception safe).
+  * @note Mapped data is copy-on-write: writing to `data` never changes the file. Mapping falls back to reading when the platform does not support it.
   * @param path Image file path.
+  * @param mode How to read image data.
+  * @see materialize
+  */
+  void load(const std::string& path, LoadMode mode = LoadMode::READ);
+
+  /**
+  * @brief Checks if image data points into a file mapping.
+  * @return `true` if image data is mapped, `false` otherwise.
+  */
+  bool isMapped() const noexcept;
+
+  /**
+  * @brief Copies mapped image data into memory owned by the image and unmaps the file.
+  * @note Does nothing if the data is not mapped. Useful before heavy writes or to release the file.
   */
-  void load(const std::string& path);
+  void materialize();
 
   /**
   * @brief Converts BMP RGB(A) image to YUV image.
@@ -342,11 +541,184 @@ public:
   */
   void load(const BMP& bmp, FourccFormat format);
 
+  /**
+  * @brief Converts BMP RGB(A) image into YUV planes of a view, which may be externally owned and have padded rows.
+  * @param bmp BMP image.
+  * @param dst View with requested format and the same width and height as the BMP image.
+  * @see bmp_to_yuv_view_map
+  */
+  static void convertBMP(const BMP& bmp, const YUVView& dst);
+
+  /**
+  * @brief Converts image to another format without going through RGB.
+  * @note If the image already has the format, returns the copy of the image.
+  * @warning The image must not be compressed.
+  * @param format Requested fourcc format.
+  * @return New image.
+  * @see yuv_convert_map
+  */
+  YUV convert(FourccFormat format) const;
+
+  /**
+  * @brief Converts YUV planes of a view into planes of a view with another format, which may be externally owned and have padded rows.
+  * @note Formats without a direct conversion go through intermediate images of `getConvertPath`, plane reorders among them take no copy.
+  * @param src View of the image to convert.
+  * @param dst View with requested format and the same width and height as `src`.
+  * @see yuv_convert_map
+  */
+  static void convert(const ConstYUVView& src, const YUVView& dst);
+
+  /**
+  * @brief Get the shortest chain of direct conversions of `yuv_convert_map` from one format to another.
+  * @param src Source fourcc format.
+  * @param dst Destination fourcc format.
+  * @example IYUV -> NV12 : [IYUV, NV12] ; I444 -> NV12 : [I444, I422, IYUV, NV12]
+  * @return Formats from `src` to `dst` inclusive, empty if there is no chain.
+  */
+  static std::vector<FourccFormat> getConvertPath(FourccFormat src, FourccFormat dst);
+
+  /**
+  * @brief Check if a conversion only reorders planes: both formats keep every channel in its own plane with the same subsampling and samples.
+  * @note Such conversion needs no copy: a view of one format is a valid view of the other one.
+  * @example IYUV -> YV12 : true ; NV12 -> NV21 : false // pairs are interleaved in memory
+  * @see BasicYUVView::as
+  */
+  static bool isPlaneReorder(FourccFormat src, FourccFormat dst) noexcept;
+
+  /**
+  * @brief Creates uncompressed image with allocated, uninitialized data.
+  * @param format Fourcc format.
+  * @param width Image width.
+  * @param height Image height.
+  * @return New image.
+  */
+  static YUV allocate(FourccFormat format, uint32_t width, uint32_t height);
+
   /**
   * @brief Dumps image to file (including compressed images).
   * @param path Path to dump.
   */
   void dump(const std::string& path) const;
+private:
+  /**
+  * @brief Frees or unmaps `data`.
+  */
+  void releaseData() noexcept;
+
+  /// File mapping that `data` points into, `nullptr` if `data` is owned.
+  std::unique_ptr<MappedFile> data_mapping;
+};
+
+/**
+* @brief Non-owning view of uncompressed YUV image with a pointer and a stride for every plane.
+* @details Planes don't have to be in one buffer and rows may be padded, so buffers of decoders, textures or capture devices are used without copying.
+* @var fourcc_format Image fourcc format.
+* @var width Image width.
+* @var height Image height.
+* @var planes Pointers to planes in YUV(A) order, the same as `YUV::getYUVPlanes`. `nullptr` for unused planes.
+* @var strides Distance in bytes between starts of two adjacent rows of each plane.
+* @var pixel_strides Distance in bytes between adjacent samples in a row of each plane, `2` for interleaved chroma of semi-planar formats. Samples of high bit depth formats take 2 bytes, so their pixel strides are doubled.
+*/
+template <typename T>
+struct BasicYUVView {
+  YUV::FourccFormat fourcc_format = YUV::FourccFormats::UNKNOWN;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::array<T*, YUV::max_planes> planes{};
+  std::array<uint32_t, YUV::max_planes> strides{};
+  std::array<uint32_t, YUV::max_planes> pixel_strides{ 1, 1, 1, 1 };
+
+  /**
+  * @brief Default empty constructor.
+  * @warning If left as it is, consideres invalid.
+  */
+  BasicYUVView() {}
+
+  /**
+  * @brief Constructor.
+  * @param fourcc_format Image fourcc format.
+  * @param width Image width.
+  * @param height Image height.
+  * @param planes Pointers to planes in YUV(A) order.
+  * @param strides Distance in bytes between starts of two adjacent rows of each plane.
+  * @param pixel_strides Distance in bytes between adjacent samples in a row of each plane.
+  */
+  BasicYUVView(YUV::FourccFormat fourcc_format, uint32_t width, uint32_t height, const std::array<T*, YUV::max_planes>& planes, const std::array<uint32_t, YUV::max_planes>& strides,
+    const std::array<uint32_t, YUV::max_planes>& pixel_strides = { 1, 1, 1, 1 })
+    : fourcc_format(fourcc_format), width(width), height(height), planes(planes), strides(strides), pixel_strides(pixel_strides) {}
+
+  /**
+  * @brief Converts writable view to read-only view.
+  */
+  template <typename U, typename = std::enable_if_t<std::is_convertible<U*, T*>::value>>
+  BasicYUVView(const BasicYUVView<U>& view) : fourcc_format(view.fourcc_format), width(view.width), height(view.height), strides(view.strides), pixel_strides(view.pixel_strides) {
+    for (uint32_t i = 0; i < YUV::max_planes; i++) {
+      planes[i] = view.planes[i];
+    }
+  }
+
+  /**
+  * @brief Check if the view is valid: the format is implemented, used planes are set and rows of planes fit in strides.
+  * @return `true` if view is valid, `false` otherwise.
+  */
+  bool isValid() const {
+    if (!YUV::isImplementedFormat(fourcc_format) || width == 0 || height == 0) {
+      return false;
+    }
+    const uint32_t sample_bytes = YUV::getBytesPerSample(fourcc_format);
+    for (uint8_t i = 0; i < YUV::max_planes; i++) {
+      const uint32_t plane_width = getWidthHeightChannel(i)[0];
+      if (plane_width != 0 && (planes[i] == nullptr || pixel_strides[i] < sample_bytes || strides[i] < (plane_width - 1) * pixel_strides[i] + sample_bytes)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+  * @brief Get width and height for specific color channel with appropriate subsampling.
+  * @see YUV::getWidthHeightChannel
+  */
+  std::array<uint32_t, 2> getWidthHeightChannel(uint8_t channel) const {
+    return YUV::getWidthHeightChannel(fourcc_format, width, height, channel);
+  }
+
+  /**
+  * @brief Get the same planes as a view of another format without copying.
+  * @param format Requested fourcc format.
+  * @return View with requested format.
+  * @throws std::runtime_error if the conversion is not a plane reorder.
+  * @see YUV::isPlaneReorder
+  */
+  BasicYUVView as(YUV::FourccFormat format) const {
+    if (!YUV::isPlaneReorder(fourcc_format, format)) {
+      throw std::runtime_error("Error. Conversion between these formats is not a plane reorder");
+    }
+    BasicYUVView res = *this;
+    res.fourcc_format = format;
+    return res;
+  }
+
+  /**
+  * @brief Get pointer to the row of a plane.
+  * @param channel Plane in YUV(A) order.
+  * @param y Row of the plane.
+  * @return Pointer to the first sample of the row.
+  */
+  T* row(uint8_t channel, uint32_t y) const noexcept {
+    return planes[channel] + static_cast<size_t>(y) * strides[channel];
+  }
+
+  /**
+  * @brief Get pointer to a sample of a plane.
+  * @param channel Plane in YUV(A) order.
+  * @param x Column of the plane.
+  * @param y Row of the plane.
+  * @return Pointer to the sample.
+  */
+  T* sample(uint8_t channel, uint32_t x, uint32_t y) const noexcept {
+    return row(channel, y) + static_cast<size_t>(x) * pixel_strides[channel];
+  }
 };
 
 } // myyuv
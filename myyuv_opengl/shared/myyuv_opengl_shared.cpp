@@ -2,35 +2,27 @@
 
 #include <iostream>
 #include <stdexcept>
-#include <fstream>
 #include <cassert>
+#include <algorithm>
 
 void glfw_error_callback(GLint error, const GLchar* desc) {
   //std::cout << "GLFW error " << error << ": " << desc << '\n';
   throw std::runtime_error("GLFW error " + std::to_string(error) + ": " + desc);
 }
 
-IMAGE_FORMAT figure_out_format_magic(const std::string& path) {
-  IMAGE_FORMAT format = IMAGE_FORMAT::UNKNOWN;
-  myyuv::BMPHeader bmp_header;
-  myyuv::YUVHeader yuv_header;
-  const uint32_t magic_size = std::max(sizeof(bmp_header.type), sizeof(yuv_header.type));
-  uint8_t magic[magic_size];
-  std::ifstream f(path, std::ios::binary);
-  if (!f) {
-    throw std::runtime_error("Error opening file to read " + path);
+IMAGE_FORMAT figure_out_format(const std::string& path) {
+  const myyuv::ImageInfo info = myyuv::probe(path);
+  if (info.type != myyuv::ImageInfo::Type::UNKNOWN && !info.valid) {
+    throw std::runtime_error("Error bad header " + path);
   }
-  f.read(reinterpret_cast<char*>(magic), sizeof(magic));
-  f.close();
-  int ret = 0;
-  if (std::equal(bmp_header.type, bmp_header.type + sizeof(bmp_header.type), magic)) {
-    format = IMAGE_FORMAT::BMP;
-  } else if (std::equal(yuv_header.type, yuv_header.type + sizeof(yuv_header.type), magic)) {
-    format = IMAGE_FORMAT::YUV;
-  } else {
-    format = IMAGE_FORMAT::UNKNOWN;
+  switch (info.type) {
+    case myyuv::ImageInfo::Type::BMP:
+      return IMAGE_FORMAT::BMP;
+    case myyuv::ImageInfo::Type::YUV:
+      return IMAGE_FORMAT::YUV;
+    default:
+      return IMAGE_FORMAT::UNKNOWN;
   }
-  return format;
 }
 
 int create_shader_program(GLuint& shader_program, const char* vertex_shader_src, const char* fragment_shader_src, bool use_program) {
@@ -106,7 +98,9 @@ GLuint create_bmp_texture(const myyuv::BMP& bmp, GLuint shader_program, const GL
   return texture;
 }
 
-static void create_yuv_plane_texture(GLuint shader_program, const GLuint unit, GLuint& tex, const uint8_t* data, const uint32_t width, const uint32_t height, const char* uniform) {
+// `format` is GL_RED for a plane, GL_RG for interleaved chroma pairs or luma of packed macropixels, GL_RGBA for chroma of packed macropixels,
+// `swizzle` picks the channel the shader reads as red, `sample_bytes` is 2 for high bit depth samples that are uploaded as 16-bit channels
+static void create_yuv_plane_texture(GLuint shader_program, const GLuint unit, GLuint& tex, const uint8_t* data, const uint32_t width, const uint32_t height, const uint32_t row_length, const char* uniform, GLenum format = GL_RED, GLint swizzle = GL_RED, uint32_t sample_bytes = 1) {
   assert(uniform);
   assert(data);
   glGenTextures(1, &tex);
@@ -115,7 +109,17 @@ static void create_yuv_plane_texture(GLuint shader_program, const GLuint unit, G
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, data);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, swizzle);
+  // Rows are uploaded straight from the plane, padding included
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
+  GLint internal_format = format == GL_RGBA ? GL_RGBA8 : (format == GL_RG ? GL_RG8 : GL_R8);
+  if (sample_bytes == 2) {
+    internal_format = format == GL_RGBA ? GL_RGBA16 : (format == GL_RG ? GL_RG16 : GL_R16);
+  }
+  glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, sample_bytes == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE, data);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
   glGenerateMipmap(GL_TEXTURE_2D);
   glUniform1i(glGetUniformLocation(shader_program, uniform), unit);
 }
@@ -125,21 +129,50 @@ std::vector<GLuint> create_yuv_texture(const myyuv::YUV& yuv, GLuint shader_prog
     throw std::runtime_error("YUV is invalid");
   }
   assert(!yuv.isCompressed());
+  return create_yuv_texture(yuv.view(), shader_program, uniforms, unit);
+}
+
+std::vector<GLuint> create_yuv_texture(const myyuv::ConstYUVView& view, GLuint shader_program, const std::vector<const GLchar*>& uniforms, GLuint unit) {
+  if (!view.isValid()) {
+    throw std::runtime_error("YUV view is invalid");
+  }
   assert(shader_program != 0);
   assert(uniforms.size() > 0);
-  if (yuv.getFormatGroup() != myyuv::YUV::FormatGroup::PLANAR) {
-    throw std::runtime_error("Only planar yuv group is supported");
+  const myyuv::YUV::FormatGroup format_group = myyuv::YUV::getFormatGroup(view.fourcc_format);
+  if (format_group != myyuv::YUV::FormatGroup::PLANAR && format_group != myyuv::YUV::FormatGroup::SEMI_PLANAR && format_group != myyuv::YUV::FormatGroup::PACKED) {
+    throw std::runtime_error("Only planar, semi-planar and packed yuv groups are supported");
   }
-  auto planes = yuv.getYUVPlanes();
+  // 16-bit channels are normalized by 65535, the shader scales them back to the range of `bits` bits
+  const auto sample_bits = myyuv::YUV::getSampleBits(view.fourcc_format);
+  const uint32_t sample_bytes = myyuv::YUV::getBytesPerSample(view.fourcc_format);
+  const float sample_scale = sample_bytes == 2 ? 65535.0f / (((1u << sample_bits[0]) - 1) << sample_bits[1]) : 1.0f;
+  glUniform1f(glGetUniformLocation(shader_program, "SampleScale"), sample_scale);
   std::vector<GLuint> texes;
   uint32_t j = 0;
-  for (uint32_t i = 0; i < planes.size(); i++) {
-    if (planes[i] != nullptr) {
+  for (uint32_t i = 0; i < view.planes.size(); i++) {
+    if (view.planes[i] != nullptr) {
       texes.push_back(0);
-      auto width_height = yuv.getWidthHeightChannel(i);
+      auto width_height = view.getWidthHeightChannel(i);
       assert(width_height[0] != 0 && width_height[1] != 0);
       try {
-        create_yuv_plane_texture(shader_program, unit + j, texes.at(j), planes[i], width_height[0], width_height[1], uniforms.at(j));
+        if (view.pixel_strides[i] == sample_bytes) {
+          if (view.strides[i] % sample_bytes != 0) {
+            throw std::runtime_error("Strides of high bit depth planes must be multiples of the sample size");
+          }
+          create_yuv_plane_texture(shader_program, unit + j, texes.at(j), view.planes[i], width_height[0], width_height[1], view.strides[i] / sample_bytes, uniforms.at(j), GL_RED, GL_RED, sample_bytes);
+        } else {
+          // Interleaved samples are uploaded as a texture with a channel per byte of a pixel stride for each plane, the swizzle picks the channel:
+          // chroma pairs of semi-planar formats are two channel texels, luma of packed macropixels is two channel and chroma is four channel texels
+          static constexpr const GLint swizzles[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
+          const uint8_t* base = format_group == myyuv::YUV::FormatGroup::PACKED ? std::min({ view.planes[0], view.planes[1], view.planes[2] }) : std::min(view.planes[1], view.planes[2]);
+          const uint32_t pixel_stride = view.pixel_strides[i];
+          const uint32_t channels = pixel_stride / sample_bytes;
+          if (format_group == myyuv::YUV::FormatGroup::PLANAR || (channels != 2 && channels != 4) || pixel_stride % sample_bytes != 0 || view.strides[i] % pixel_stride != 0 ||
+            view.planes[i] >= base + pixel_stride || (view.planes[i] - base) % sample_bytes != 0) {
+            throw std::runtime_error("Only interleaved chroma pairs and packed macropixels are supported");
+          }
+          create_yuv_plane_texture(shader_program, unit + j, texes.at(j), base, width_height[0], width_height[1], view.strides[i] / pixel_stride, uniforms.at(j), channels == 2 ? GL_RG : GL_RGBA, swizzles[(view.planes[i] - base) / sample_bytes], sample_bytes);
+        }
       } catch (...) {
         for (auto t : texes) {
           if (t != 0) {
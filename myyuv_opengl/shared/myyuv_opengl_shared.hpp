@@ -20,12 +20,13 @@ void glfw_error_callback(GLint error, const GLchar* desc);
 enum class IMAGE_FORMAT { UNKNOWN, BMP, YUV };
 
 /**
-* @brief Try to figure out image format based on first 2 bytes. If it's "BM" then it's `BMP`. If it's "YU" then it' `YUV`. Unknown otherwise (error case).
-* @note Does not check anything else in the header. Only first 2 bytes.
+* @brief Figure out image format with `myyuv::probe`. If the magic is "BM" then it's `BMP`. If it's "YU" then it' `YUV`. Unknown otherwise (error case).
+* @note Reads only the headers, the image is loaded later.
 * @param path Path to input image.
-* @return Image format based on first 2 bytes.
+* @return Image format based on the headers.
+* @throws std::runtime_error if the magic is known but the headers are invalid.
 */
-IMAGE_FORMAT figure_out_format_magic(const std::string& path);
+IMAGE_FORMAT figure_out_format(const std::string& path);
 
 /**
 * @brief Creates and compiles a shader program with vertex and fragment shaders.
@@ -57,3 +58,14 @@ GLuint create_bmp_texture(const myyuv::BMP& bmp, GLuint shader_program = 0, cons
 * @return Vector of texture handlers.
 */
 std::vector<GLuint> create_yuv_texture(const myyuv::YUV& yuv, GLuint shader_program, const std::vector<const GLchar*>& uniforms, GLuint unit = 0);
+
+/**
+* @brief Creates YUV textures for each plane from a view of YUV planes.
+* @note Rows are uploaded with `GL_UNPACK_ROW_LENGTH`, so planes with padded rows are not copied.
+* @param view Requested YUV planes.
+* @param shader_program Shader program to be used in.
+* @param uniforms Uniforms for each plane.
+* @param unit Texture unit for first plane.
+* @return Vector of texture handlers.
+*/
+std::vector<GLuint> create_yuv_texture(const myyuv::ConstYUVView& view, GLuint shader_program, const std::vector<const GLchar*>& uniforms, GLuint unit = 0);
@@ -73,7 +73,7 @@ int main(int argc, char* argv[]) {
     throw;
   }
   const std::string path = args[1];
-  IMAGE_FORMAT format = figure_out_format_magic(path);
+  IMAGE_FORMAT format = figure_out_format(path);
   switch(format) {
     case IMAGE_FORMAT::BMP:
       ret = main_bmp(myyuv::BMP(path), force_cube, flip_w_h, shapes_count);
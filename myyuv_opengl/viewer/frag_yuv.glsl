@@ -8,6 +8,7 @@ out vec4 FragColor;
 uniform sampler2D YTex;
 uniform sampler2D UTex;
 uniform sampler2D VTex;
+uniform float SampleScale; // scales 16-bit high bit depth samples back to [0..1]
 
 void main() {
   float nx, ny, r, g, b, y, u, v;
@@ -15,9 +16,9 @@ void main() {
   nx = TexCoord.x;
   ny = 1.0f - TexCoord.y; // flip
 
-  y = texture(YTex, vec2(nx, ny)).x;
-  u = texture(UTex, vec2(nx, ny)).x - 0.5f;
-  v = texture(VTex, vec2(nx, ny)).x - 0.5f;
+  y = texture(YTex, vec2(nx, ny)).x * SampleScale;
+  u = texture(UTex, vec2(nx, ny)).x * SampleScale - 0.5f;
+  v = texture(VTex, vec2(nx, ny)).x * SampleScale - 0.5f;
 
   r = y + 1.403f * v;
   g = y - 0.714f * v - 0.344f * u;
@@ -13,7 +13,7 @@ int main(int argc, char* argv[]) {
   }
   int ret = 0;
   const std::string path = argv[1];
-  IMAGE_FORMAT format = figure_out_format_magic(path);
+  IMAGE_FORMAT format = figure_out_format(path);
   switch(format) {
     case IMAGE_FORMAT::BMP:
       ret = main_bmp(myyuv::BMP(path));
@@ -2,56 +2,77 @@
 #include <SDL3/SDL.h>
 #include <iostream>
 #include <cassert>
-#include <fstream>
+#include <algorithm>
 
-SDL_Surface* create_surface_from_path(const std::string& path, uint8_t*& surface_data) {
-  surface_data = nullptr;
-  myyuv::BMPHeader bmp_header;
-  myyuv::YUVHeader yuv_header;
-  const uint32_t magic_size = std::max(sizeof(bmp_header.type), sizeof(yuv_header.type));
-  uint8_t magic[magic_size];
-  std::ifstream f(path, std::ios::binary);
-  if (!f) {
-    throw std::runtime_error("Error opening file to read " + path);
+SDL_Texture* create_bmp_texture(SDL_Renderer* renderer, const std::string& path) {
+  myyuv::BMP bmp(path);
+  assert(bmp.header.width > 0 && bmp.header.height > 0);
+  if (!bmp.isValid()) {
+    throw std::runtime_error("Invalid bmp");
   }
-  f.read(reinterpret_cast<char*>(magic), sizeof(magic));
-  f.close();
+  uint8_t* data = bmp.colorData();
   SDL_Surface* surf = nullptr;
-  if (std::equal(bmp_header.type, bmp_header.type + sizeof(bmp_header.type), magic)) {
-    static myyuv::BMP bmp(path);
-    assert(bmp.header.width > 0 && bmp.header.height > 0);
-    if (!bmp.isValid()) {
-      throw std::runtime_error("Invalid bmp");
+  if (bmp.header.bit_count == 24) {
+    surf = SDL_CreateSurfaceFrom(bmp.trueWidth(), bmp.trueHeight(), SDL_PIXELFORMAT_RGB24, data, 3*bmp.trueWidth());
+  } else if (bmp.header.bit_count == 32) {
+    SDL_PixelFormat format;
+    if (bmp.color_header.alpha_mask == 0) {
+      format = SDL_PIXELFORMAT_XRGB8888;
+    } else {
+      format = SDL_PIXELFORMAT_ARGB8888;
     }
-    uint8_t* data = bmp.colorData();
-    surface_data = data;
-    if (bmp.header.bit_count == 24) {
-      surf = SDL_CreateSurfaceFrom(bmp.trueWidth(), bmp.trueHeight(), SDL_PIXELFORMAT_RGB24, data, 3*bmp.trueWidth());
-    } else if (bmp.header.bit_count == 32) {
-      SDL_PixelFormat format;
-      if (bmp.color_header.alpha_mask == 0) {
-        format = SDL_PIXELFORMAT_XRGB8888;
-      } else {
-        format = SDL_PIXELFORMAT_ARGB8888;
-      }
-      surf = SDL_CreateSurfaceFrom(bmp.trueWidth(), bmp.trueHeight(), format, data, 4*bmp.trueWidth());
-    }
-  } else if (std::equal(yuv_header.type, yuv_header.type + sizeof(yuv_header.type), magic)) {
-    static myyuv::YUV yuv(path);
+    surf = SDL_CreateSurfaceFrom(bmp.trueWidth(), bmp.trueHeight(), format, data, 4*bmp.trueWidth());
+  }
+  if (surf == nullptr) {
+    delete[] data;
+    return nullptr;
+  }
+  SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surf);
+  SDL_DestroySurface(surf);
+  delete[] data;
+  return texture;
+}
+
+SDL_Texture* create_yuv_texture(SDL_Renderer* renderer, const myyuv::ConstYUVView& view) {
+  const myyuv::YUV::FormatGroup format_group = myyuv::YUV::getFormatGroup(view.fourcc_format);
+  if (!view.isValid() || format_group != myyuv::YUV::FormatGroup::PLANAR && format_group != myyuv::YUV::FormatGroup::SEMI_PLANAR && format_group != myyuv::YUV::FormatGroup::PACKED) {
+    throw std::runtime_error("Invalid yuv");
+  }
+  SDL_Texture* texture = SDL_CreateTexture(renderer, static_cast<SDL_PixelFormat>(view.fourcc_format), SDL_TEXTUREACCESS_STATIC, view.width, view.height);
+  if (texture == nullptr) {
+    return nullptr;
+  }
+  // Planes are uploaded straight from the view with their strides, interleaved chroma as one plane of pairs, packed macropixels as one plane
+  bool updated = false;
+  if (format_group == myyuv::YUV::FormatGroup::PACKED) {
+    updated = SDL_UpdateTexture(texture, nullptr, std::min({ view.planes[0], view.planes[1], view.planes[2] }), view.strides[0]);
+  } else if (format_group == myyuv::YUV::FormatGroup::SEMI_PLANAR) {
+    updated = SDL_UpdateNVTexture(texture, nullptr, view.planes[0], view.strides[0], std::min(view.planes[1], view.planes[2]), view.strides[1]);
+  } else {
+    updated = SDL_UpdateYUVTexture(texture, nullptr, view.planes[0], view.strides[0], view.planes[1], view.strides[1], view.planes[2], view.strides[2]);
+  }
+  if (!updated) {
+    SDL_DestroyTexture(texture);
+    return nullptr;
+  }
+  return texture;
+}
+
+SDL_Texture* create_texture_from_path(SDL_Renderer* renderer, const std::string& path, const myyuv::ImageInfo& info) {
+  if (info.type == myyuv::ImageInfo::Type::BMP) {
+    return create_bmp_texture(renderer, path);
+  } else if (info.type == myyuv::ImageInfo::Type::YUV) {
+    myyuv::YUV yuv(path, myyuv::YUV::LoadMode::MAP_SEQUENTIAL);
     if (yuv.isCompressed()) {
       yuv = yuv.decompress();
     }
     if (!yuv.isValid()) {
       throw std::runtime_error("Invalid yuv");
     }
-    uint32_t yuv_data_size = yuv.getDataSize();
-    surface_data = new uint8_t[yuv_data_size];
-    std::copy(yuv.data, yuv.data + yuv_data_size, surface_data);
-    surf = SDL_CreateSurfaceFrom(yuv.header.width, yuv.header.height, static_cast<SDL_PixelFormat>(yuv.header.fourcc_format), surface_data, yuv.header.width);
+    return create_yuv_texture(renderer, yuv.view());
   } else {
     throw std::runtime_error("Unknown image format (magic) " + path);
   }
-  return surf;
 }
 
 int main(int argc, char* argv[]) {
@@ -65,19 +86,20 @@ int main(int argc, char* argv[]) {
     std::cout << "Error initializing SDL: " << SDL_GetError() << '\n';
     return 1;
   }
-  uint8_t* surface_data;
-  SDL_Surface* surf = create_surface_from_path(argv[1], surface_data);
-  if (surf == nullptr) {
-    std::cout << "Error creating surface" << '\n';
-    return 1;
+  const std::string path = argv[1];
+  // The window is sized from the headers before the image is loaded
+  const myyuv::ImageInfo info = myyuv::probe(path);
+  if (info.type != myyuv::ImageInfo::Type::UNKNOWN && !info.valid) {
+    throw std::runtime_error("Error bad header " + path);
   }
-  SDL_Window* win = SDL_CreateWindow("YUV SDL3 Viewer", surf->w, surf->h, 0);
+  SDL_Window* win = SDL_CreateWindow("YUV SDL3 Viewer", info.width, info.height, 0);
   SDL_Renderer* renderer = SDL_CreateRenderer(win, nullptr);
   assert(renderer);
-  SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surf);
-  SDL_DestroySurface(surf);
-  delete[] surface_data;
-  assert(texture);
+  SDL_Texture* texture = create_texture_from_path(renderer, path, info);
+  if (texture == nullptr) {
+    std::cout << "Error creating texture: " << SDL_GetError() << '\n';
+    return 1;
+  }
   SDL_RenderClear(renderer);
   SDL_RenderTexture(renderer, texture, nullptr, nullptr);
   SDL_RenderPresent(renderer);